@@ -0,0 +1,129 @@
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <iostream>
+#include <mutex>
+#include <thread>
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	typedef staticdb::memory_storage const shared_storage;
+
+	expr::expression make_find_equals()
+	{
+		expr::lambda element_equals_key(
+		    Si::make_unique<expr::expression>(expr::equals(Si::make_unique<expr::expression>(expr::argument()),
+		                                                   Si::make_unique<expr::expression>(expr::bound()))),
+		    Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 1)));
+		return expr::filter(
+		    Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+		    Si::make_unique<expr::expression>(std::move(element_equals_key)));
+	}
+
+	double measure_gets_per_second(staticdb::basic_plan<shared_storage> const &plan, shared_storage &storage,
+	                               unsigned thread_count, std::chrono::milliseconds duration)
+	{
+		std::atomic<bool> running(true);
+		std::atomic<std::uint64_t> total_gets(0);
+		std::mutex error_mutex;
+		std::exception_ptr error;
+		std::vector<std::thread> threads;
+		for (unsigned t = 0; t < thread_count; ++t)
+		{
+			threads.emplace_back([&plan, &storage, &running, &total_gets, &error_mutex, &error, t]()
+			                     {
+				                     std::uint64_t gets = 0;
+				                     std::uint8_t key = static_cast<std::uint8_t>(t);
+				                     try
+				                     {
+					                     while (running.load(std::memory_order_relaxed))
+					                     {
+						                     Si::optional<values::value> const found = plan.gets[0](
+						                         storage, values::value(values::make_unsigned_integer(key)));
+						                     if (!found)
+						                     {
+							                     throw std::logic_error("get failed");
+						                     }
+						                     ++key;
+						                     ++gets;
+					                     }
+				                     }
+				                     catch (...)
+				                     {
+					                     // an exception leaving the thread would terminate the process
+					                     std::lock_guard<std::mutex> lock(error_mutex);
+					                     if (!error)
+					                     {
+						                     error = std::current_exception();
+					                     }
+					                     running = false;
+				                     }
+				                     total_gets += gets;
+				                 });
+		}
+		auto const started = std::chrono::steady_clock::now();
+		std::this_thread::sleep_for(duration);
+		running = false;
+		for (std::thread &thread : threads)
+		{
+			thread.join();
+		}
+		if (error)
+		{
+			std::rethrow_exception(error);
+		}
+		std::chrono::duration<double> const elapsed = std::chrono::steady_clock::now() - started;
+		return static_cast<double>(total_gets.load()) / elapsed.count();
+	}
+}
+
+int main()
+{
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	staticdb::memory_storage writable;
+	{
+		std::uint64_t const length = 4096;
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(writable.memory));
+		values::serialize(writer, values::value(values::make_unsigned_integer(length)));
+		for (std::uint64_t i = 0; i < length; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(static_cast<std::uint8_t>(i))));
+		}
+	}
+	shared_storage &storage = writable;
+
+	expr::expression const find_equals = make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::basic_plan<shared_storage> const plan = staticdb::make_plan<shared_storage>(root_type, gets, sets);
+
+	unsigned const cores = (std::max)(1u, std::thread::hardware_concurrency());
+	double single_threaded = 0;
+	for (unsigned thread_count = 1; thread_count <= cores; thread_count *= 2)
+	{
+		double throughput = 0;
+		try
+		{
+			throughput = measure_gets_per_second(plan, storage, thread_count, std::chrono::seconds(1));
+		}
+		catch (std::exception const &ex)
+		{
+			std::cerr << thread_count << " threads: " << ex.what() << '\n';
+			return 1;
+		}
+		if (thread_count == 1)
+		{
+			single_threaded = throughput;
+		}
+		std::cout << thread_count << " threads: " << throughput << " gets/s, speedup "
+		          << (throughput / single_threaded) << '\n';
+	}
+}
@@ -0,0 +1,149 @@
+#ifndef STATICDB_ARRAY_DELTA_HPP
+#define STATICDB_ARRAY_DELTA_HPP
+
+#include <staticdb/values.hpp>
+#include <staticdb/address.hpp>
+#include <algorithm>
+#include <memory>
+
+namespace staticdb
+{
+	// The changes at one position of a stored array: the elements inserted before the stored element and whether the
+	// stored element was replaced or erased.
+	struct array_change
+	{
+		address position;
+		std::vector<values::value> inserted;
+		Si::optional<values::value> replacement;
+		bool erased;
+
+		explicit array_change(address position)
+		    : position(position)
+		    , erased(false)
+		{
+		}
+
+		array_change copy() const
+		{
+			array_change result(position);
+			result.inserted = staticdb::copy(inserted);
+			if (replacement)
+			{
+				result.replacement = replacement->copy();
+			}
+			result.erased = erased;
+			return result;
+		}
+
+#if SILICIUM_COMPILER_GENERATES_MOVES
+		SILICIUM_DEFAULT_MOVE(array_change)
+#else
+		array_change(array_change &&other) BOOST_NOEXCEPT : position(other.position),
+		                                                    inserted(std::move(other.inserted)),
+		                                                    replacement(std::move(other.replacement)),
+		                                                    erased(other.erased)
+		{
+		}
+
+		array_change &operator=(array_change &&other) BOOST_NOEXCEPT
+		{
+			position = other.position;
+			inserted = std::move(other.inserted);
+			replacement = std::move(other.replacement);
+			erased = other.erased;
+			return *this;
+		}
+#endif
+		SILICIUM_DISABLE_COPY(array_change)
+	};
+
+	// An immutable set of changes to a stored array, sorted by position. Readers merge it with the stored elements.
+	// Finding the element at an index of the merged array costs O(log n) for n changes, so reading gets slower with
+	// the size of the delta, but not with the size of the array.
+	struct array_delta
+	{
+		// Where an element of the merged array comes from. value is null for an unchanged stored element.
+		struct location
+		{
+			address stored_index;
+			values::value const *value;
+		};
+
+		explicit array_delta(std::vector<array_change> changes)
+		    : m_changes(std::move(changes))
+		    , m_inserted(0)
+		    , m_erased(0)
+		{
+			m_logical_begins.reserve(m_changes.size());
+			for (array_change const &change : m_changes)
+			{
+				m_logical_begins.emplace_back(change.position + m_inserted - m_erased);
+				m_inserted += change.inserted.size();
+				m_erased += change.erased ? 1u : 0u;
+			}
+		}
+
+		SILICIUM_DISABLE_COPY(array_delta)
+
+		std::vector<array_change> const &changes() const
+		{
+			return m_changes;
+		}
+
+		address length(address stored_length) const
+		{
+			return stored_length + m_inserted - m_erased;
+		}
+
+		// The first change at or after a stored index.
+		std::vector<array_change>::const_iterator first_change(address stored_index) const
+		{
+			return std::lower_bound(m_changes.begin(), m_changes.end(), stored_index,
+			                        [](array_change const &change, address index)
+			                        {
+				                        return change.position < index;
+				                    });
+		}
+
+		location locate(address logical_index) const
+		{
+			auto const after = std::upper_bound(m_logical_begins.begin(), m_logical_begins.end(), logical_index);
+			if (after == m_logical_begins.begin())
+			{
+				return location{logical_index, nullptr};
+			}
+			std::size_t const found = static_cast<std::size_t>((after - m_logical_begins.begin()) - 1);
+			array_change const &change = m_changes[found];
+			address offset = logical_index - m_logical_begins[found];
+			if (offset < change.inserted.size())
+			{
+				return location{change.position, &change.inserted[static_cast<std::size_t>(offset)]};
+			}
+			offset -= change.inserted.size();
+			if (change.erased)
+			{
+				return location{change.position + 1u + offset, nullptr};
+			}
+			if ((offset == 0) && change.replacement)
+			{
+				return location{change.position, &*change.replacement};
+			}
+			return location{change.position + offset, nullptr};
+		}
+
+	private:
+		std::vector<array_change> m_changes;
+		std::vector<address> m_logical_begins;
+		address m_inserted;
+		address m_erased;
+	};
+
+	// Storages can have deltas for the arrays they contain. An array starts at the bit address where.
+	template <class Storage>
+	std::shared_ptr<array_delta const> find_delta(Storage const &, address)
+	{
+		return nullptr;
+	}
+}
+
+#endif
@@ -0,0 +1,335 @@
+#ifndef STATICDB_ASYNC_PLAN_HPP
+#define STATICDB_ASYNC_PLAN_HPP
+
+#include <staticdb/plan.hpp>
+#include <boost/coroutine/asymmetric_coroutine.hpp>
+#include <condition_variable>
+#include <deque>
+#include <future>
+#include <mutex>
+#include <thread>
+
+namespace staticdb
+{
+	// A read_span call of a suspended getter. An I/O thread fills in the result or the error.
+	struct pending_read
+	{
+		address where;
+		std::size_t length;
+		byte *scratch;
+		Si::iterator_range<byte const *> result;
+		std::exception_ptr error;
+
+		pending_read()
+		    : where(0)
+		    , length(0)
+		    , scratch(nullptr)
+		{
+		}
+	};
+
+	template <class Storage>
+	struct async_getter_executor;
+
+	// The storage that the getters of an async_getter_executor read from. Inside the executor read_span suspends the
+	// getter until an I/O thread has read the bytes, so the thread that ran the getter can run other getters in the
+	// meantime. Outside of an executor and in read_at it reads directly from the underlying storage.
+	template <class Storage>
+	struct suspending_storage
+	{
+		typedef boost::coroutines::asymmetric_coroutine<void>::push_type yield_type;
+
+		explicit suspending_storage(Storage &underlying)
+		    : m_underlying(&underlying)
+		    , m_yield(nullptr)
+		    , m_read(nullptr)
+		{
+		}
+
+		auto read_at(address where) const -> decltype(std::declval<Storage &>().read_at(where))
+		{
+			return m_underlying->read_at(where);
+		}
+
+		Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+		{
+			if (!m_yield)
+			{
+				return m_underlying->read_span(where, length, scratch);
+			}
+			m_read->where = where;
+			m_read->length = length;
+			m_read->scratch = scratch;
+			m_read->error = nullptr;
+			(*m_yield)();
+			if (m_read->error)
+			{
+				std::rethrow_exception(m_read->error);
+			}
+			return m_read->result;
+		}
+
+	private:
+		friend struct async_getter_executor<Storage>;
+
+		Storage *m_underlying;
+		yield_type *m_yield;
+		pending_read *m_read;
+	};
+
+	// Runs the planned gets of a shared plan as coroutines on a fixed set of threads. get() only queues the request.
+	// A getter that reads from the storage is suspended while one of the I/O threads does the read, and its thread
+	// continues with other getters, so many gets can be in flight on a few threads. A getter is always resumed on the
+	// thread that started it. The underlying storage has to allow reads from several threads at the same time, for
+	// example file_storage const or memory_storage const.
+	template <class Storage>
+	struct async_getter_executor
+	{
+		typedef suspending_storage<Storage> storage_type;
+		typedef Si::optional<values::value> result_type;
+
+		async_getter_executor(std::shared_ptr<basic_plan<storage_type> const> plan, Storage &storage,
+		                      std::size_t thread_count, std::size_t io_thread_count)
+		    : m_plan(std::move(plan))
+		    , m_underlying(&storage)
+		    , m_next_worker(0)
+		    , m_in_flight(0)
+		    , m_io_stopping(false)
+		{
+			if (!m_plan)
+			{
+				throw std::invalid_argument("async_getter_executor needs a plan");
+			}
+			if ((thread_count == 0) || (io_thread_count == 0))
+			{
+				throw std::invalid_argument("async_getter_executor needs at least one thread and one I/O thread");
+			}
+			for (std::size_t i = 0; i < thread_count; ++i)
+			{
+				m_workers.emplace_back(Si::make_unique<worker>());
+			}
+			for (std::size_t i = 0; i < thread_count; ++i)
+			{
+				worker &self = *m_workers[i];
+				self.thread = std::thread([this, &self]()
+				                          {
+					                          work(self);
+					                      });
+			}
+			for (std::size_t i = 0; i < io_thread_count; ++i)
+			{
+				m_io_threads.emplace_back([this]()
+				                          {
+					                          read();
+					                      });
+			}
+		}
+
+		// Waits for the gets in flight because a suspended getter cannot be destroyed safely.
+		~async_getter_executor()
+		{
+			{
+				std::unique_lock<std::mutex> lock(m_state_mutex);
+				m_idle.wait(lock, [this]()
+				            {
+					            return m_in_flight == 0;
+					        });
+			}
+			for (std::unique_ptr<worker> const &each : m_workers)
+			{
+				{
+					std::lock_guard<std::mutex> lock(each->mutex);
+					each->stopping = true;
+				}
+				each->wake.notify_all();
+				each->thread.join();
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_io_mutex);
+				m_io_stopping = true;
+			}
+			m_io_wake.notify_all();
+			for (std::thread &thread : m_io_threads)
+			{
+				thread.join();
+			}
+		}
+
+		SILICIUM_DISABLE_COPY(async_getter_executor)
+
+		std::future<result_type> get(std::size_t getter, values::value argument)
+		{
+			if (getter >= m_plan->gets.size())
+			{
+				throw std::invalid_argument("async_getter_executor::get: getter index out of range");
+			}
+			std::unique_ptr<request> queued = Si::make_unique<request>(getter, std::move(argument), *m_underlying);
+			std::future<result_type> result = queued->promise.get_future();
+			{
+				std::lock_guard<std::mutex> lock(m_state_mutex);
+				++m_in_flight;
+				queued->owner = m_next_worker;
+				m_next_worker = (m_next_worker + 1u) % m_workers.size();
+			}
+			make_ready(std::move(queued));
+			return result;
+		}
+
+	private:
+		typedef boost::coroutines::asymmetric_coroutine<void> coroutine;
+
+		struct request
+		{
+			std::size_t getter;
+			values::value argument;
+			std::promise<result_type> promise;
+			pending_read read;
+			storage_type storage;
+			std::size_t owner;
+			std::unique_ptr<coroutine::pull_type> resume;
+
+			request(std::size_t getter, values::value argument, Storage &underlying)
+			    : getter(getter)
+			    , argument(std::move(argument))
+			    , storage(underlying)
+			    , owner(0)
+			{
+			}
+		};
+
+		struct worker
+		{
+			std::mutex mutex;
+			std::condition_variable wake;
+			std::deque<std::unique_ptr<request>> ready;
+			bool stopping;
+			std::thread thread;
+
+			worker()
+			    : stopping(false)
+			{
+			}
+		};
+
+		std::shared_ptr<basic_plan<storage_type> const> m_plan;
+		Storage *m_underlying;
+		std::vector<std::unique_ptr<worker>> m_workers;
+		std::vector<std::thread> m_io_threads;
+		std::mutex m_state_mutex;
+		std::condition_variable m_idle;
+		std::size_t m_next_worker;
+		std::size_t m_in_flight;
+		std::mutex m_io_mutex;
+		std::condition_variable m_io_wake;
+		std::deque<std::unique_ptr<request>> m_reads;
+		bool m_io_stopping;
+
+		void make_ready(std::unique_ptr<request> resumed)
+		{
+			worker &owner = *m_workers[resumed->owner];
+			{
+				std::lock_guard<std::mutex> lock(owner.mutex);
+				owner.ready.emplace_back(std::move(resumed));
+			}
+			owner.wake.notify_one();
+		}
+
+		void run(request &current, coroutine::push_type &yield)
+		{
+			current.storage.m_yield = &yield;
+			current.storage.m_read = &current.read;
+			try
+			{
+				current.promise.set_value(m_plan->gets[current.getter](current.storage, current.argument));
+			}
+			catch (...)
+			{
+				current.promise.set_exception(std::current_exception());
+			}
+		}
+
+		void work(worker &self)
+		{
+			for (;;)
+			{
+				std::unique_ptr<request> current;
+				{
+					std::unique_lock<std::mutex> lock(self.mutex);
+					self.wake.wait(lock, [&self]()
+					               {
+						               return self.stopping || !self.ready.empty();
+						           });
+					if (self.ready.empty())
+					{
+						return;
+					}
+					current = std::move(self.ready.front());
+					self.ready.pop_front();
+				}
+				if (current->resume)
+				{
+					(*current->resume)();
+				}
+				else
+				{
+					request &started = *current;
+					current->resume = Si::make_unique<coroutine::pull_type>(
+					    [this, &started](coroutine::push_type &yield)
+					    {
+						    run(started, yield);
+						});
+				}
+				if (*current->resume)
+				{
+					// suspended in read_span
+					{
+						std::lock_guard<std::mutex> lock(m_io_mutex);
+						m_reads.emplace_back(std::move(current));
+					}
+					m_io_wake.notify_one();
+					continue;
+				}
+				current.reset();
+				std::lock_guard<std::mutex> lock(m_state_mutex);
+				--m_in_flight;
+				if (m_in_flight == 0)
+				{
+					m_idle.notify_all();
+				}
+			}
+		}
+
+		void read()
+		{
+			for (;;)
+			{
+				std::unique_ptr<request> current;
+				{
+					std::unique_lock<std::mutex> lock(m_io_mutex);
+					m_io_wake.wait(lock, [this]()
+					               {
+						               return m_io_stopping || !m_reads.empty();
+						           });
+					if (m_reads.empty())
+					{
+						return;
+					}
+					current = std::move(m_reads.front());
+					m_reads.pop_front();
+				}
+				pending_read &wanted = current->read;
+				try
+				{
+					wanted.result = m_underlying->read_span(wanted.where, wanted.length, wanted.scratch);
+				}
+				catch (...)
+				{
+					wanted.error = std::current_exception();
+				}
+				make_ready(std::move(current));
+			}
+		}
+	};
+}
+
+#endif
@@ -2,7 +2,10 @@
 #define STATICDB_BIT_SINK_HPP
 
 #include <silicium/sink/sink.hpp>
+#include <silicium/success.hpp>
 #include <staticdb/values.hpp>
+#include <staticdb/address.hpp>
+#include <staticdb/byte.hpp>
 
 namespace staticdb
 {
@@ -41,6 +44,20 @@ namespace staticdb
 			return m_buffered_bits;
 		}
 
+		error_type flush()
+		{
+			if (m_buffered_bits == 0)
+			{
+				return error_type();
+			}
+			error_type error = Si::append(m_bytes, static_cast<typename ByteSink::element_type>(m_next_byte));
+			if (!error)
+			{
+				m_buffered_bits = 0;
+			}
+			return error;
+		}
+
 	private:
 		ByteSink m_bytes;
 		std::uint8_t m_next_byte;
@@ -72,6 +89,160 @@ namespace staticdb
 		}
 	};
 
+	struct packing_bit_sink
+	{
+		typedef values::bit element_type;
+		typedef Si::success error_type;
+
+		packing_bit_sink()
+		    : m_packed(0)
+		    , m_length(0)
+		{
+		}
+
+		error_type append(Si::iterator_range<element_type const *> data)
+		{
+			for (element_type value : data)
+			{
+				if (m_length == 64)
+				{
+					throw std::invalid_argument("packing_bit_sink can hold at most 64 bits");
+				}
+				m_packed = (m_packed << 1u) | (value.is_set ? 1u : 0u);
+				++m_length;
+			}
+			return error_type();
+		}
+
+		std::uint64_t packed() const
+		{
+			return m_packed;
+		}
+
+		std::size_t length() const
+		{
+			return m_length;
+		}
+
+	private:
+		std::uint64_t m_packed;
+		std::size_t m_length;
+	};
+
+	// Collects bits in a byte vector in the same order as bits_to_byte_sink writes them. Whole words and other
+	// buffers can be appended at any bit offset.
+	struct bit_buffer
+	{
+		typedef values::bit element_type;
+		typedef Si::success error_type;
+
+		bit_buffer()
+		    : m_length(0)
+		{
+		}
+
+		error_type append(Si::iterator_range<element_type const *> data)
+		{
+			for (element_type value : data)
+			{
+				append_bits(value.is_set ? 1u : 0u, 1);
+			}
+			return error_type();
+		}
+
+		// Appends the lowest count bits of bits, the most significant one first.
+		void append_bits(std::uint64_t bits, std::size_t count)
+		{
+			assert(count <= 64);
+			while (count > 0)
+			{
+				std::size_t const used = static_cast<std::size_t>(m_length % 8u);
+				if (used == 0)
+				{
+					m_bytes.emplace_back(0);
+				}
+				std::size_t const taking = (std::min)(count, 8u - used);
+				std::uint64_t const piece = (bits >> (count - taking)) & ((1u << taking) - 1u);
+				m_bytes.back() = static_cast<byte>(m_bytes.back() | (piece << (8u - used - taking)));
+				count -= taking;
+				m_length += taking;
+			}
+		}
+
+		void append_buffer(bit_buffer const &other)
+		{
+			if ((m_length % 8u) == 0)
+			{
+				m_bytes.insert(m_bytes.end(), other.m_bytes.begin(), other.m_bytes.end());
+				m_length += other.m_length;
+				return;
+			}
+			address const whole_bytes = other.m_length / 8u;
+			for (address i = 0; i < whole_bytes; ++i)
+			{
+				append_bits(other.m_bytes[static_cast<std::size_t>(i)], 8);
+			}
+			std::size_t const rest = static_cast<std::size_t>(other.m_length % 8u);
+			if (rest > 0)
+			{
+				append_bits(static_cast<std::uint64_t>(other.m_bytes.back() >> (8u - rest)), rest);
+			}
+		}
+
+		address length() const
+		{
+			return m_length;
+		}
+
+		// Reads count bits beginning at the bit from. The first one becomes the most significant.
+		std::uint64_t read_bits(address from, std::size_t count) const
+		{
+			assert(count <= 64);
+			assert((from + count) <= m_length);
+			std::uint64_t result = 0;
+			for (address at = from; at < (from + count); ++at)
+			{
+				byte const piece = m_bytes[static_cast<std::size_t>(at / 8u)];
+				result = (result << 1u) | ((piece >> (7u - (at % 8u))) & 1u);
+			}
+			return result;
+		}
+
+		std::vector<byte> const &bytes() const
+		{
+			return m_bytes;
+		}
+
+		// Removes the bytes that are complete and returns them. At most one byte of a partial byte stays.
+		std::vector<byte> take_complete_bytes()
+		{
+			std::vector<byte> complete;
+			if ((m_length % 8u) == 0)
+			{
+				complete.swap(m_bytes);
+			}
+			else
+			{
+				byte const partial = m_bytes.back();
+				m_bytes.pop_back();
+				complete.swap(m_bytes);
+				m_bytes.emplace_back(partial);
+			}
+			m_length %= 8u;
+			return complete;
+		}
+
+		void clear()
+		{
+			m_bytes.clear();
+			m_length = 0;
+		}
+
+	private:
+		std::vector<byte> m_bytes;
+		address m_length;
+	};
+
 	template <class ByteSink>
 	auto make_bits_to_byte_sink(ByteSink &&bytes) -> bits_to_byte_sink<typename std::decay<ByteSink>::type>
 	{
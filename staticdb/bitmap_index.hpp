@@ -0,0 +1,459 @@
+#ifndef STATICDB_BITMAP_INDEX_HPP
+#define STATICDB_BITMAP_INDEX_HPP
+
+#include <staticdb/packed_key.hpp>
+#include <silicium/variant.hpp>
+#include <unordered_map>
+
+namespace staticdb
+{
+	namespace roaring
+	{
+		std::size_t const max_array_values = 4096;
+		std::size_t const bitmap_words = 1024;
+
+		// at most max_array_values ascending values
+		struct array_container
+		{
+			std::vector<std::uint16_t> values;
+		};
+
+		// one bit for each of the 2^16 values, the lowest value in the lowest bit of the first word
+		struct bitmap_container
+		{
+			std::vector<std::uint64_t> words;
+		};
+
+		// ascending runs of consecutive values, each as its first and its last value
+		struct run_container
+		{
+			std::vector<std::pair<std::uint16_t, std::uint16_t>> runs;
+		};
+
+		typedef Si::variant<array_container, bitmap_container, run_container> container;
+
+		template <class Visitor>
+		void for_each_value(container const &values, Visitor &&visit)
+		{
+			Si::visit<void>(values,
+			                [&visit](array_container const &array)
+			                {
+				                for (std::uint16_t value : array.values)
+				                {
+					                visit(value);
+				                }
+				            },
+			                [&visit](bitmap_container const &bitmap)
+			                {
+				                for (std::size_t i = 0; i < bitmap.words.size(); ++i)
+				                {
+					                for (std::uint64_t word = bitmap.words[i]; word != 0; word &= word - 1u)
+					                {
+						                visit(static_cast<std::uint16_t>((i * 64u) + execution::lowest_one(word)));
+					                }
+				                }
+				            },
+			                [&visit](run_container const &run)
+			                {
+				                for (std::pair<std::uint16_t, std::uint16_t> const &range : run.runs)
+				                {
+					                for (std::uint32_t value = range.first; value <= range.second; ++value)
+					                {
+						                visit(static_cast<std::uint16_t>(value));
+					                }
+				                }
+				            });
+		}
+
+		inline std::vector<std::uint64_t> to_words(container const &values)
+		{
+			bitmap_container const *const bitmap = Si::try_get_ptr<bitmap_container>(values);
+			if (bitmap)
+			{
+				return bitmap->words;
+			}
+			std::vector<std::uint64_t> words(bitmap_words);
+			for_each_value(values, [&words](std::uint16_t value)
+			               {
+				               words[value / 64u] |= std::uint64_t(1) << (value % 64u);
+				           });
+			return words;
+		}
+
+		// The smallest container for the values in bitmap words.
+		inline container from_words(std::vector<std::uint64_t> words)
+		{
+			assert(words.size() == bitmap_words);
+			std::size_t count = 0;
+			for (std::uint64_t word : words)
+			{
+				count += static_cast<std::size_t>(execution::count_ones(word));
+			}
+			run_container run;
+			array_container array;
+			for (std::size_t i = 0; i < words.size(); ++i)
+			{
+				for (std::uint64_t word = words[i]; word != 0; word &= word - 1u)
+				{
+					std::uint16_t const value = static_cast<std::uint16_t>((i * 64u) + execution::lowest_one(word));
+					if (count <= max_array_values)
+					{
+						array.values.emplace_back(value);
+					}
+					if (!run.runs.empty() && (run.runs.back().second + 1u == value))
+					{
+						run.runs.back().second = value;
+					}
+					else
+					{
+						run.runs.emplace_back(value, value);
+					}
+				}
+			}
+			std::size_t const run_bytes = run.runs.size() * 4u;
+			std::size_t const bitmap_bytes = bitmap_words * 8u;
+			if ((count <= max_array_values) && ((count * 2u) <= (std::min)(run_bytes, bitmap_bytes)))
+			{
+				return container(std::move(array));
+			}
+			if (run_bytes < bitmap_bytes)
+			{
+				return container(std::move(run));
+			}
+			return container(bitmap_container{std::move(words)});
+		}
+
+		inline address cardinality(container const &values)
+		{
+			address count = 0;
+			Si::visit<void>(values,
+			                [&count](array_container const &array)
+			                {
+				                count = array.values.size();
+				            },
+			                [&count](bitmap_container const &bitmap)
+			                {
+				                for (std::uint64_t word : bitmap.words)
+				                {
+					                count += execution::count_ones(word);
+				                }
+				            },
+			                [&count](run_container const &run)
+			                {
+				                for (std::pair<std::uint16_t, std::uint16_t> const &range : run.runs)
+				                {
+					                count += (range.second - range.first) + 1u;
+				                }
+				            });
+			return count;
+		}
+
+		inline bool contains(container const &values, std::uint16_t value)
+		{
+			return Si::visit<bool>(values,
+			                       [value](array_container const &array)
+			                       {
+				                       return std::binary_search(array.values.begin(), array.values.end(), value);
+				                   },
+			                       [value](bitmap_container const &bitmap)
+			                       {
+				                       return ((bitmap.words[value / 64u] >> (value % 64u)) & 1u) != 0;
+				                   },
+			                       [value](run_container const &run)
+			                       {
+				                       typedef std::pair<std::uint16_t, std::uint16_t> range_type;
+				                       auto const first_after = [](std::uint16_t wanted, range_type const &range)
+				                       {
+					                       return wanted < range.first;
+					                   };
+				                       auto const after =
+				                           std::upper_bound(run.runs.begin(), run.runs.end(), value, first_after);
+				                       return (after != run.runs.begin()) && ((after - 1)->second >= value);
+				                   });
+		}
+
+		inline std::size_t memory_in_bytes(container const &values)
+		{
+			return Si::visit<std::size_t>(values,
+			                              [](array_container const &array)
+			                              {
+				                              return array.values.capacity() * sizeof(std::uint16_t);
+				                          },
+			                              [](bitmap_container const &bitmap)
+			                              {
+				                              return bitmap.words.capacity() * sizeof(std::uint64_t);
+				                          },
+			                              [](run_container const &run)
+			                              {
+				                              return run.runs.capacity() *
+				                                     sizeof(std::pair<std::uint16_t, std::uint16_t>);
+				                          });
+		}
+	}
+
+	// A compressed set of array indices in the style of Roaring bitmaps. The indices are grouped by all but their
+	// lowest 16 bits and every group is stored as a sorted array, a bitmap or runs, whichever is the smallest.
+	struct roaring_bitmap
+	{
+		typedef std::vector<std::pair<address, roaring::container>> container_list;
+
+		roaring_bitmap()
+		{
+		}
+
+		explicit roaring_bitmap(container_list containers)
+		    : m_containers(std::move(containers))
+		{
+		}
+
+		// Adds an index that is larger than all indices added before. The containers are only compressed by
+		// optimize.
+		void push_back(address index)
+		{
+			address const key = index >> 16u;
+			std::uint16_t const low = static_cast<std::uint16_t>(index & 0xffffu);
+			if (!m_containers.empty() && (m_containers.back().first > key))
+			{
+				throw std::invalid_argument("roaring_bitmap::push_back needs ascending indices");
+			}
+			if (m_containers.empty() || (m_containers.back().first != key))
+			{
+				m_containers.emplace_back(key, roaring::container(roaring::array_container()));
+			}
+			roaring::container &last = m_containers.back().second;
+			roaring::array_container *const array = Si::try_get_ptr<roaring::array_container>(last);
+			if (array && (array->values.size() < roaring::max_array_values))
+			{
+				if (!array->values.empty() && (array->values.back() >= low))
+				{
+					throw std::invalid_argument("roaring_bitmap::push_back needs ascending indices");
+				}
+				array->values.emplace_back(low);
+				return;
+			}
+			if (!Si::try_get_ptr<roaring::bitmap_container>(last))
+			{
+				last = roaring::container(roaring::bitmap_container{roaring::to_words(last)});
+			}
+			std::vector<std::uint64_t> &words = Si::try_get_ptr<roaring::bitmap_container>(last)->words;
+			words[low / 64u] |= std::uint64_t(1) << (low % 64u);
+		}
+
+		// Converts every container into the smallest kind for its indices.
+		void optimize()
+		{
+			for (auto &entry : m_containers)
+			{
+				entry.second = roaring::from_words(roaring::to_words(entry.second));
+			}
+		}
+
+		address cardinality() const
+		{
+			address count = 0;
+			for (auto const &entry : m_containers)
+			{
+				count += roaring::cardinality(entry.second);
+			}
+			return count;
+		}
+
+		bool contains(address index) const
+		{
+			auto const found = std::lower_bound(
+			    m_containers.begin(), m_containers.end(), index >> 16u,
+			    [](std::pair<address, roaring::container> const &entry, address key)
+			    {
+				    return entry.first < key;
+				});
+			if ((found == m_containers.end()) || (found->first != (index >> 16u)))
+			{
+				return false;
+			}
+			return roaring::contains(found->second, static_cast<std::uint16_t>(index & 0xffffu));
+		}
+
+		// Calls visit with every index in [begin, end) in ascending order. Containers outside of the range are
+		// skipped.
+		template <class Visitor>
+		void for_each(address begin, address end, Visitor &&visit) const
+		{
+			for (auto const &entry : m_containers)
+			{
+				address const base = entry.first << 16u;
+				if ((base + 0xffffu) < begin)
+				{
+					continue;
+				}
+				if (base >= end)
+				{
+					break;
+				}
+				roaring::for_each_value(entry.second, [base, begin, end, &visit](std::uint16_t low)
+				                        {
+					                        address const index = base + low;
+					                        if ((index >= begin) && (index < end))
+					                        {
+						                        visit(index);
+					                        }
+					                    });
+			}
+		}
+
+		std::size_t memory_in_bytes() const
+		{
+			std::size_t bytes = m_containers.capacity() * sizeof(std::pair<address, roaring::container>);
+			for (auto const &entry : m_containers)
+			{
+				bytes += roaring::memory_in_bytes(entry.second);
+			}
+			return bytes;
+		}
+
+		container_list const &containers() const
+		{
+			return m_containers;
+		}
+
+	private:
+		container_list m_containers;
+	};
+
+	namespace roaring
+	{
+		// Combines the containers of two bitmaps with the same key. A key that only one of the bitmaps has is kept
+		// if keep_unmatched is set.
+		template <class Combine>
+		roaring_bitmap merge(roaring_bitmap const &left, roaring_bitmap const &right, bool keep_unmatched,
+		                     Combine &&combine)
+		{
+			roaring_bitmap::container_list result;
+			auto l = left.containers().begin();
+			auto r = right.containers().begin();
+			while ((l != left.containers().end()) || (r != right.containers().end()))
+			{
+				if ((r == right.containers().end()) || ((l != left.containers().end()) && (l->first < r->first)))
+				{
+					if (keep_unmatched)
+					{
+						result.emplace_back(l->first, l->second);
+					}
+					++l;
+					continue;
+				}
+				if ((l == left.containers().end()) || (r->first < l->first))
+				{
+					if (keep_unmatched)
+					{
+						result.emplace_back(r->first, r->second);
+					}
+					++r;
+					continue;
+				}
+				std::vector<std::uint64_t> words = to_words(l->second);
+				std::vector<std::uint64_t> const other = to_words(r->second);
+				bool any = false;
+				for (std::size_t i = 0; i < bitmap_words; ++i)
+				{
+					words[i] = combine(words[i], other[i]);
+					any = any || (words[i] != 0);
+				}
+				if (any)
+				{
+					result.emplace_back(l->first, from_words(std::move(words)));
+				}
+				++l;
+				++r;
+			}
+			return roaring_bitmap(std::move(result));
+		}
+	}
+
+	inline roaring_bitmap intersect(roaring_bitmap const &left, roaring_bitmap const &right)
+	{
+		return roaring::merge(left, right, false, [](std::uint64_t l, std::uint64_t r)
+		                      {
+			                      return l & r;
+			                  });
+	}
+
+	inline roaring_bitmap unite(roaring_bitmap const &left, roaring_bitmap const &right)
+	{
+		return roaring::merge(left, right, true, [](std::uint64_t l, std::uint64_t r)
+		                      {
+			                      return l | r;
+			                  });
+	}
+
+	// The indices of the elements of an array by the value of a field, one bitmap for every distinct value. The
+	// field is a list of bit ranges of an element like the ones find_key_bits finds for a key, and the value is
+	// read like read_key_bits does.
+	struct bitmap_index
+	{
+		std::vector<execution::bit_range> field;
+		std::unordered_map<std::uint64_t, roaring_bitmap> bitmaps;
+
+		// The number of elements that were indexed. An array of a different length is scanned instead.
+		address length;
+
+		explicit bitmap_index(std::vector<execution::bit_range> field)
+		    : field(std::move(field))
+		    , length(0)
+		{
+		}
+
+		roaring_bitmap const *find(std::uint64_t value) const
+		{
+			auto const found = bitmaps.find(value);
+			return (found == bitmaps.end()) ? nullptr : &found->second;
+		}
+
+		std::size_t memory_in_bytes() const
+		{
+			std::size_t bytes = field.capacity() * sizeof(execution::bit_range);
+			bytes += bitmaps.bucket_count() * sizeof(void *);
+			for (auto const &entry : bitmaps)
+			{
+				bytes += sizeof(entry) + entry.second.memory_in_bytes();
+			}
+			return bytes;
+		}
+	};
+
+	// The bitmap indexes of the arrays of a storage by the bit address where an array begins. A filter that
+	// compares a field with a constant reads the elements that the bitmap of the constant lists instead of scanning.
+	struct bitmap_index_set
+	{
+		void add(address array_begin, std::shared_ptr<bitmap_index const> index)
+		{
+			m_indexes.emplace_back(array_begin, std::move(index));
+		}
+
+		bitmap_index const *find(address array_begin, std::vector<execution::bit_range> const &field) const
+		{
+			for (auto const &entry : m_indexes)
+			{
+				if ((entry.first == array_begin) && (entry.second->field == field))
+				{
+					return entry.second.get();
+				}
+			}
+			return nullptr;
+		}
+
+		std::size_t memory_in_bytes() const
+		{
+			std::size_t bytes = 0;
+			for (auto const &entry : m_indexes)
+			{
+				bytes += entry.second->memory_in_bytes();
+			}
+			return bytes;
+		}
+
+	private:
+		std::vector<std::pair<address, std::shared_ptr<bitmap_index const>>> m_indexes;
+	};
+}
+
+#endif
@@ -0,0 +1,310 @@
+#ifndef STATICDB_BULK_LOADER_HPP
+#define STATICDB_BULK_LOADER_HPP
+
+#include <staticdb/bit_sink.hpp>
+#include <staticdb/bitmap_index.hpp>
+#include <staticdb/layout.hpp>
+#include <staticdb/thread_pool.hpp>
+#include <staticdb/zone_map.hpp>
+#include <silicium/variant.hpp>
+
+namespace staticdb
+{
+	// Writes an array of elements of a fixed size, beginning at a byte address of a storage. The elements are
+	// collected into chunks; a batch of chunks is validated against the element type and encoded in parallel, then
+	// the encoded chunks are appended to the storage one after another. Only one batch is held in memory. The length
+	// of the array is written by finish(). Bitmap indexes and a zone map of fields of the elements are built from the
+	// encoded chunks on the way.
+	template <class Storage>
+	struct array_loader
+	{
+		array_loader(Storage &destination, address where, types::type element_type,
+		             std::shared_ptr<work_stealing_pool> pool, std::size_t chunk_size = std::size_t(1) << 14u)
+		    : m_destination(&destination)
+		    , m_header_at(where)
+		    , m_next_byte(where + 8u)
+		    , m_element_type(std::move(element_type))
+		    , m_element_layout(layouts::calculate(m_element_type))
+		    , m_element_bits(0)
+		    , m_pool(std::move(pool))
+		    , m_chunk_size(chunk_size)
+		    , m_count(0)
+		{
+			if (chunk_size == 0)
+			{
+				throw std::invalid_argument("array_loader needs a chunk size");
+			}
+			if (!layouts::has_fixed_size(m_element_layout))
+			{
+				throw std::invalid_argument("array_loader needs elements of a fixed size");
+			}
+			Si::overflow_or<address> const element_bits = layouts::layout_size_in_bits(m_element_layout);
+			if (element_bits.is_overflow())
+			{
+				throw std::invalid_argument("array_loader element is too large");
+			}
+			m_element_bits = *element_bits.value();
+			m_packable = (Si::try_get_ptr<layouts::bitset>(m_element_layout.as_variant()) != nullptr) &&
+			             (m_element_bits <= 64u);
+		}
+
+		SILICIUM_DISABLE_COPY(array_loader)
+
+		void add(values::value element)
+		{
+			if (!values::conforms_to_type(element, m_element_type))
+			{
+				throw std::invalid_argument("array_loader got an element of the wrong type");
+			}
+			m_pending.emplace_back(std::move(element));
+			flush_if_full();
+		}
+
+		// Adds an element whose layout is a bitset of at most 64 bits without building a value for it. The first bit
+		// of the element is the most significant of the lowest element_bits() bits.
+		void add_packed(std::uint64_t element)
+		{
+			if (!m_packable)
+			{
+				throw std::invalid_argument("array_loader::add_packed needs an element layout of at most 64 bits");
+			}
+			if ((m_element_bits < 64u) && ((element >> m_element_bits) != 0))
+			{
+				throw std::invalid_argument("array_loader::add_packed got more bits than the element has");
+			}
+			m_pending.emplace_back(element);
+			flush_if_full();
+		}
+
+		address element_bits() const
+		{
+			return m_element_bits;
+		}
+
+		// Builds a bitmap index of the bits of every element in field while the elements are added. Has to be called
+		// before the first element is added.
+		void add_bitmap_index(std::vector<execution::bit_range> field)
+		{
+			if ((m_count > 0) || !m_pending.empty())
+			{
+				throw std::invalid_argument("array_loader::add_bitmap_index has to be called before adding elements");
+			}
+			address field_bits = 0;
+			for (execution::bit_range const &range : field)
+			{
+				if ((range.offset > m_element_bits) || (range.length > (m_element_bits - range.offset)))
+				{
+					throw std::invalid_argument("array_loader::add_bitmap_index got a field outside of the element");
+				}
+				field_bits += range.length;
+			}
+			if (field_bits > 64)
+			{
+				throw std::invalid_argument("array_loader::add_bitmap_index got a field of more than 64 bits");
+			}
+			m_indexes.emplace_back(std::move(field));
+		}
+
+		// The indexes requested by add_bitmap_index, with their containers compressed. Call after finish().
+		std::vector<bitmap_index> take_bitmap_indexes()
+		{
+			for (bitmap_index &index : m_indexes)
+			{
+				index.length = m_count;
+				for (auto &entry : index.bitmaps)
+				{
+					entry.second.optimize();
+				}
+			}
+			std::vector<bitmap_index> taken;
+			taken.swap(m_indexes);
+			return taken;
+		}
+
+		// Builds the zones of every bitset field of the elements for each block of block_length elements. finish()
+		// writes the zone map to the bytes after the array. Has to be called before the first element is added.
+		void add_zone_map(address block_length = zone_map_block_length)
+		{
+			if ((m_count > 0) || !m_pending.empty())
+			{
+				throw std::invalid_argument("array_loader::add_zone_map has to be called before adding elements");
+			}
+			std::vector<execution::bit_range> fields;
+			find_zone_fields(m_element_layout, 0, fields);
+			m_zones = zone_map(block_length, std::move(fields));
+		}
+
+		// The byte address of the zone map that finish() wrote, if add_zone_map was called. Nothing else records where
+		// the zone map is, so the caller has to keep the address, or read the zone map with read_zone_map and store it
+		// in a database file with file_format::zone_map_content.
+		Si::optional<address> zone_map_address() const
+		{
+			return m_zone_map_at;
+		}
+
+		// Writes the remaining elements, the array length and the zone map. Returns the number of elements.
+		address finish()
+		{
+			flush();
+			if (m_stitched.length() > 0)
+			{
+				write(m_stitched.bytes());
+				m_stitched.clear();
+			}
+			if (m_zones)
+			{
+				bit_buffer zones;
+				serialize_zone_map(zones, *m_zones);
+				m_zone_map_at = m_next_byte;
+				write(zones.bytes());
+			}
+			bit_buffer header;
+			header.append_bits(m_count, 64);
+			byte const *const begin = header.bytes().data();
+			m_destination->write_at(m_header_at).append(Si::make_iterator_range(begin, begin + header.bytes().size()));
+			return m_count;
+		}
+
+	private:
+		typedef Si::non_copyable_variant<std::uint64_t, values::value> pending_element;
+
+		Storage *m_destination;
+		address m_header_at;
+		address m_next_byte;
+		types::type m_element_type;
+		layouts::layout m_element_layout;
+		address m_element_bits;
+		bool m_packable;
+		std::shared_ptr<work_stealing_pool> m_pool;
+		std::size_t m_chunk_size;
+		address m_count;
+		std::vector<pending_element> m_pending;
+		bit_buffer m_stitched;
+		std::vector<bitmap_index> m_indexes;
+		Si::optional<zone_map> m_zones;
+		Si::optional<address> m_zone_map_at;
+
+		std::size_t batch_size() const
+		{
+			return m_chunk_size * (m_pool ? (m_pool->thread_count() + 1u) : 1u);
+		}
+
+		void flush_if_full()
+		{
+			if (m_pending.size() >= batch_size())
+			{
+				flush();
+			}
+		}
+
+		void encode(std::size_t first, std::size_t end, bit_buffer &encoded) const
+		{
+			for (std::size_t i = first; i < end; ++i)
+			{
+				Si::visit<void>(m_pending[i],
+				                [this, &encoded](std::uint64_t packed)
+				                {
+					                encoded.append_bits(packed, static_cast<std::size_t>(m_element_bits));
+					            },
+				                [this, &encoded](values::value const &element)
+				                {
+					                layouts::serialize(encoded, element, m_element_layout);
+					            });
+			}
+		}
+
+		void flush()
+		{
+			std::size_t const chunk_count = (m_pending.size() + m_chunk_size - 1u) / m_chunk_size;
+			std::vector<bit_buffer> chunks(chunk_count);
+			std::function<void(std::size_t)> const encode_chunk = [this, &chunks](std::size_t chunk)
+			{
+				encode(chunk * m_chunk_size, (std::min)(m_pending.size(), (chunk + 1u) * m_chunk_size), chunks[chunk]);
+			};
+			try
+			{
+				if (!m_pool || (chunk_count < 2) || !m_pool->try_run(chunk_count, encode_chunk))
+				{
+					for (std::size_t i = 0; i < chunk_count; ++i)
+					{
+						encode_chunk(i);
+					}
+				}
+			}
+			catch (...)
+			{
+				// the batch is dropped so that the loader stays usable
+				m_pending.clear();
+				throw;
+			}
+			for (std::size_t i = 0; i < chunk_count; ++i)
+			{
+				index_chunk(chunks[i], m_count + (i * m_chunk_size));
+				zone_chunk(chunks[i]);
+			}
+			for (bit_buffer const &chunk : chunks)
+			{
+				m_stitched.append_buffer(chunk);
+			}
+			m_count += m_pending.size();
+			m_pending.clear();
+			write(m_stitched.take_complete_bytes());
+		}
+
+		void index_chunk(bit_buffer const &chunk, address first_row)
+		{
+			if (m_indexes.empty() || (m_element_bits == 0))
+			{
+				return;
+			}
+			address const rows = chunk.length() / m_element_bits;
+			for (bitmap_index &index : m_indexes)
+			{
+				for (address row = 0; row < rows; ++row)
+				{
+					std::uint64_t value = 0;
+					for (execution::bit_range const &range : index.field)
+					{
+						std::uint64_t const part = chunk.read_bits((row * m_element_bits) + range.offset,
+						                                           static_cast<std::size_t>(range.length));
+						value = (range.length == 64) ? part : ((value << range.length) | part);
+					}
+					index.bitmaps[value].push_back(first_row + row);
+				}
+			}
+		}
+
+		void zone_chunk(bit_buffer const &chunk)
+		{
+			if (!m_zones || (m_element_bits == 0))
+			{
+				return;
+			}
+			address const rows = chunk.length() / m_element_bits;
+			std::vector<std::uint64_t> values(m_zones->fields.size());
+			for (address row = 0; row < rows; ++row)
+			{
+				for (std::size_t i = 0; i < values.size(); ++i)
+				{
+					execution::bit_range const field = m_zones->fields[i];
+					values[i] = chunk.read_bits((row * m_element_bits) + field.offset,
+					                            static_cast<std::size_t>(field.length));
+				}
+				m_zones->push_back(values.data());
+			}
+		}
+
+		void write(std::vector<byte> const &bytes)
+		{
+			if (bytes.empty())
+			{
+				return;
+			}
+			byte const *const begin = bytes.data();
+			m_destination->write_at(m_next_byte).append(Si::make_iterator_range(begin, begin + bytes.size()));
+			m_next_byte += bytes.size();
+		}
+	};
+}
+
+#endif
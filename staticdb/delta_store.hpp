@@ -0,0 +1,538 @@
+#ifndef STATICDB_DELTA_STORE_HPP
+#define STATICDB_DELTA_STORE_HPP
+
+#include <staticdb/execution.hpp>
+#include <future>
+#include <map>
+#include <mutex>
+
+namespace staticdb
+{
+	// A read-only version of the data in a delta_store: the stored bytes and the deltas of the arrays at the time
+	// it was taken. Plans read from it like from any other storage.
+	template <class Storage>
+	struct delta_view
+	{
+		typedef std::vector<std::pair<address, std::shared_ptr<array_delta const>>> delta_list;
+
+		delta_view(std::shared_ptr<Storage const> stored, delta_list deltas)
+		    : m_stored(std::move(stored))
+		    , m_deltas(std::move(deltas))
+		{
+		}
+
+		auto read_at(address where) const -> decltype(std::declval<Storage const &>().read_at(where))
+		{
+			return m_stored->read_at(where);
+		}
+
+		Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+		{
+			return m_stored->read_span(where, length, scratch);
+		}
+
+		std::shared_ptr<array_delta const> delta(address where) const
+		{
+			for (auto const &entry : m_deltas)
+			{
+				if (entry.first == where)
+				{
+					return entry.second;
+				}
+			}
+			return nullptr;
+		}
+
+		Storage const &stored() const
+		{
+			return *m_stored;
+		}
+
+	private:
+		std::shared_ptr<Storage const> m_stored;
+		delta_list m_deltas;
+	};
+
+	template <class Storage>
+	std::shared_ptr<array_delta const> find_delta(delta_view<Storage> const &view, address where)
+	{
+		return view.delta(where);
+	}
+
+	// Accepts inserts, updates and erases for the arrays of static data without rewriting them. The root of the data
+	// has to be an array or a tuple; the arrays are the root or the members of the root tuple. Every array has a
+	// sorted delta in memory, so a change costs time in the size of the delta, but not in the size of the array.
+	// Readers take a delta_view which merges the deltas at read time. compact() writes the merged data into a new
+	// storage, which becomes the next version of the stored data. Changes made while a compaction runs are logged
+	// and applied again on top of the new version.
+	template <class Storage>
+	struct delta_store
+	{
+		typedef delta_view<Storage> view;
+
+		delta_store(Storage stored, layouts::layout root)
+		    : m_stored(std::make_shared<Storage const>(std::move(stored)))
+		    , m_root(std::move(root))
+		    , m_members(member_count(m_root))
+		    , m_compacting(false)
+		{
+			layouts::tuple const *const root_tuple = Si::try_get_ptr<layouts::tuple>(m_root.as_variant());
+			for (std::size_t i = 0; i < m_members.size(); ++i)
+			{
+				member &current = m_members[i];
+				current.stored_layout = root_tuple ? &root_tuple->elements[i] : &m_root;
+				layouts::array const *const array_ =
+				    Si::try_get_ptr<layouts::array>(current.stored_layout->as_variant());
+				if (array_ && (array_->tags == layouts::variant_tags::in_elements) &&
+				    (array_->encoding == layouts::bitset_encoding::plain) && layouts::has_fixed_size(*array_->element))
+				{
+					Si::overflow_or<address> const element_bits = layouts::layout_size_in_bits(*array_->element);
+					if (!element_bits.is_overflow())
+					{
+						current.element_layout = array_->element.get();
+						current.element_bits = *element_bits.value();
+					}
+				}
+			}
+			locate_members();
+		}
+
+		SILICIUM_DISABLE_COPY(delta_store)
+
+		view read() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			typename view::delta_list deltas;
+			for (member const &current : m_members)
+			{
+				if (!current.changes.empty())
+				{
+					deltas.emplace_back(current.begin, publish(current));
+				}
+			}
+			return view(m_stored, std::move(deltas));
+		}
+
+		// The number of elements in an array including the changes.
+		address length(std::size_t array) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			member const &changed = array_member(array);
+			return changed.stored_length + changed.inserted - changed.erased;
+		}
+
+		// The number of elements that were inserted, replaced or erased since the last compaction.
+		address delta_size() const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			address size = 0;
+			for (member const &current : m_members)
+			{
+				for (auto const &entry : current.changes)
+				{
+					array_change const &existing = entry.second;
+					size += existing.inserted.size() + ((existing.replacement || existing.erased) ? 1u : 0u);
+				}
+			}
+			return size;
+		}
+
+		// Inserts an element so that it gets the index before. before can be the length of the array to append.
+		void insert(std::size_t array, address before, values::value element)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			change(operation{operation_kind::insert, array, before, std::move(element)});
+		}
+
+		void update(std::size_t array, address index, values::value element)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			change(operation{operation_kind::update, array, index, std::move(element)});
+		}
+
+		void erase(std::size_t array, address index)
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			change(operation{operation_kind::erase, array, index, values::value(values::unit())});
+		}
+
+		// Writes the data with all changes into destination, which has to be empty, and makes it the stored data.
+		// Readers and writers are blocked only at the beginning and at the end.
+		void compact(Storage destination)
+		{
+			std::lock_guard<std::mutex> compacting(m_compaction);
+			std::shared_ptr<Storage const> stored;
+			std::vector<std::shared_ptr<array_delta const>> deltas(m_members.size());
+			std::vector<member_position> positions(m_members.size());
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				stored = m_stored;
+				for (std::size_t i = 0; i < m_members.size(); ++i)
+				{
+					if (!m_members[i].changes.empty())
+					{
+						deltas[i] = publish(m_members[i]);
+					}
+					positions[i] = member_position{m_members[i].begin, m_members[i].end, m_members[i].stored_length};
+				}
+				m_compacting = true;
+			}
+			try
+			{
+				write_merged(*stored, deltas, positions, destination);
+			}
+			catch (...)
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				m_compacting = false;
+				m_log.clear();
+				throw;
+			}
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_stored = std::make_shared<Storage const>(std::move(destination));
+			m_compacting = false;
+			for (member &current : m_members)
+			{
+				current.changes.clear();
+				current.inserted = 0;
+				current.erased = 0;
+				current.published.reset();
+			}
+			locate_members();
+			std::vector<operation> const log = std::move(m_log);
+			m_log.clear();
+			for (operation const &logged : log)
+			{
+				change(logged.copy());
+			}
+		}
+
+		std::future<void> compact_in_background(Storage destination)
+		{
+			return std::async(std::launch::async, &delta_store::compact, this, std::move(destination));
+		}
+
+	private:
+		enum class operation_kind
+		{
+			insert,
+			update,
+			erase
+		};
+
+		struct operation
+		{
+			operation_kind kind;
+			std::size_t array;
+			address index;
+			values::value element;
+
+			operation copy() const
+			{
+				return operation{kind, array, index, element.copy()};
+			}
+		};
+
+		struct member
+		{
+			layouts::layout const *stored_layout;
+			layouts::layout const *element_layout;
+			address begin;
+			address end;
+			address stored_length;
+			Si::optional<address> element_bits;
+			std::map<address, array_change> changes;
+			address inserted;
+			address erased;
+			mutable std::shared_ptr<array_delta const> published;
+
+			member()
+			    : stored_layout(nullptr)
+			    , element_layout(nullptr)
+			    , begin(0)
+			    , end(0)
+			    , stored_length(0)
+			    , inserted(0)
+			    , erased(0)
+			{
+			}
+		};
+
+		struct member_position
+		{
+			address begin;
+			address end;
+			address stored_length;
+		};
+
+		// The element at an index of a changed array: either the stored element at position or the element at
+		// position in the list of elements inserted before the stored element at stored_position.
+		struct found_element
+		{
+			address stored_position;
+			Si::optional<std::size_t> inserted_position;
+		};
+
+		mutable std::mutex m_mutex;
+		std::mutex m_compaction;
+		std::shared_ptr<Storage const> m_stored;
+		layouts::layout m_root;
+		std::vector<member> m_members;
+		bool m_compacting;
+		std::vector<operation> m_log;
+
+		static std::size_t member_count(layouts::layout const &root)
+		{
+			if (Si::try_get_ptr<layouts::array>(root.as_variant()))
+			{
+				return 1;
+			}
+			layouts::tuple const *const root_tuple = Si::try_get_ptr<layouts::tuple>(root.as_variant());
+			if (!root_tuple)
+			{
+				throw std::invalid_argument("delta_store needs an array or a tuple as the root");
+			}
+			return root_tuple->elements.size();
+		}
+
+		void locate_members()
+		{
+			address where = 0;
+			for (member &current : m_members)
+			{
+				execution::storage_pointer<Storage const> const begin(*m_stored, where);
+				Si::overflow_or<address> const size = execution::stored_size_in_bits(begin, *current.stored_layout);
+				if (size.is_overflow())
+				{
+					throw std::invalid_argument("delta_store found data that exceeds the address space");
+				}
+				current.begin = where;
+				current.end = where + *size.value();
+				if (Si::try_get_ptr<layouts::array>(current.stored_layout->as_variant()))
+				{
+					current.stored_length = execution::array_length(begin);
+				}
+				where = current.end;
+			}
+		}
+
+		member const &array_member(std::size_t array) const
+		{
+			if ((array >= m_members.size()) || !m_members[array].element_bits)
+			{
+				throw std::invalid_argument(
+				    "delta_store can only change arrays with elements of a fixed size and no tag column");
+			}
+			return m_members[array];
+		}
+
+		std::shared_ptr<array_delta const> publish(member const &changed) const
+		{
+			if (!changed.published)
+			{
+				std::vector<array_change> changes;
+				changes.reserve(changed.changes.size());
+				for (auto const &entry : changed.changes)
+				{
+					changes.emplace_back(entry.second.copy());
+				}
+				changed.published = std::make_shared<array_delta const>(std::move(changes));
+			}
+			return changed.published;
+		}
+
+		found_element find(member const &changed, address index) const
+		{
+			address logical = 0;
+			address stored = 0;
+			for (auto const &entry : changed.changes)
+			{
+				array_change const &existing = entry.second;
+				if (index < (logical + (existing.position - stored)))
+				{
+					return found_element{stored + (index - logical), Si::none};
+				}
+				logical += existing.position - stored;
+				if (index < (logical + existing.inserted.size()))
+				{
+					return found_element{existing.position, static_cast<std::size_t>(index - logical)};
+				}
+				logical += existing.inserted.size();
+				if (!existing.erased)
+				{
+					if (index == logical)
+					{
+						return found_element{existing.position, Si::none};
+					}
+					++logical;
+				}
+				stored = existing.position + 1u;
+			}
+			return found_element{stored + (index - logical), Si::none};
+		}
+
+		void change(operation applied)
+		{
+			array_member(applied.array);
+			member &changed = m_members[applied.array];
+			address const length = changed.stored_length + changed.inserted - changed.erased;
+			if ((applied.kind == operation_kind::insert) ? (applied.index > length) : (applied.index >= length))
+			{
+				throw std::invalid_argument("delta_store got an index out of range");
+			}
+			if (applied.kind != operation_kind::erase)
+			{
+				bit_buffer encoded;
+				layouts::serialize(encoded, applied.element, *changed.element_layout);
+				if (encoded.length() != *changed.element_bits)
+				{
+					throw std::invalid_argument("delta_store got an element of the wrong size");
+				}
+			}
+			if (m_compacting)
+			{
+				m_log.emplace_back(applied.copy());
+			}
+			changed.published.reset();
+			found_element const found = find(changed, applied.index);
+			array_change &existing =
+			    changed.changes.emplace(found.stored_position, array_change(found.stored_position)).first->second;
+			switch (applied.kind)
+			{
+			case operation_kind::insert:
+			{
+				std::size_t const at = found.inserted_position ? *found.inserted_position : existing.inserted.size();
+				existing.inserted.insert(existing.inserted.begin() + static_cast<std::ptrdiff_t>(at),
+				                         std::move(applied.element));
+				++changed.inserted;
+				break;
+			}
+
+			case operation_kind::update:
+				if (found.inserted_position)
+				{
+					existing.inserted[*found.inserted_position] = std::move(applied.element);
+				}
+				else
+				{
+					existing.replacement = std::move(applied.element);
+				}
+				break;
+
+			case operation_kind::erase:
+				if (found.inserted_position)
+				{
+					existing.inserted.erase(existing.inserted.begin() +
+					                        static_cast<std::ptrdiff_t>(*found.inserted_position));
+					--changed.inserted;
+				}
+				else
+				{
+					existing.replacement = Si::none;
+					existing.erased = true;
+					++changed.erased;
+				}
+				break;
+			}
+			if (existing.inserted.empty() && !existing.replacement && !existing.erased)
+			{
+				changed.changes.erase(found.stored_position);
+			}
+		}
+
+		struct merged_writer
+		{
+			Storage *destination;
+			address next_byte;
+			bit_buffer pending;
+
+			void copy_bits(Storage const &stored, address where, address length)
+			{
+				for (address copied = 0; copied < length; copied += 64)
+				{
+					address const chunk = (std::min)(address(64), length - copied);
+					pending.append_bits(
+					    execution::read_packed_bits(execution::storage_pointer<Storage const>(stored, where + copied),
+					                                chunk),
+					    static_cast<std::size_t>(chunk));
+					if (pending.length() >= (address(1) << 16u))
+					{
+						flush();
+					}
+				}
+			}
+
+			void flush()
+			{
+				write(pending.take_complete_bytes());
+			}
+
+			void finish()
+			{
+				flush();
+				write(pending.bytes());
+				pending.clear();
+			}
+
+			void write(std::vector<byte> const &bytes)
+			{
+				if (bytes.empty())
+				{
+					return;
+				}
+				byte const *const begin = bytes.data();
+				destination->write_at(next_byte).append(Si::make_iterator_range(begin, begin + bytes.size()));
+				next_byte += bytes.size();
+			}
+		};
+
+		void write_merged(Storage const &stored, std::vector<std::shared_ptr<array_delta const>> const &deltas,
+		                  std::vector<member_position> const &positions, Storage &destination) const
+		{
+			merged_writer output{&destination, 0, bit_buffer()};
+			for (std::size_t i = 0; i < m_members.size(); ++i)
+			{
+				member_position const &position = positions[i];
+				array_delta const *const delta = deltas[i].get();
+				if (!delta)
+				{
+					output.copy_bits(stored, position.begin, position.end - position.begin);
+					continue;
+				}
+				address const element_bits = *m_members[i].element_bits;
+				layouts::layout const &element_layout = *m_members[i].element_layout;
+				address const elements_begin = position.begin + (execution::address_size_in_bytes * address(8));
+				output.pending.append_bits(delta->length(position.stored_length), 64);
+				address index = 0;
+				for (array_change const &existing : delta->changes())
+				{
+					output.copy_bits(stored, elements_begin + (index * element_bits),
+					                 (existing.position - index) * element_bits);
+					for (values::value const &inserted : existing.inserted)
+					{
+						layouts::serialize(output.pending, inserted, element_layout);
+					}
+					index = existing.position;
+					if (index == position.stored_length)
+					{
+						break;
+					}
+					if (existing.replacement)
+					{
+						layouts::serialize(output.pending, *existing.replacement, element_layout);
+					}
+					else if (!existing.erased)
+					{
+						output.copy_bits(stored, elements_begin + (index * element_bits), element_bits);
+					}
+					++index;
+				}
+				output.copy_bits(stored, elements_begin + (index * element_bits),
+				                 (position.stored_length - index) * element_bits);
+			}
+			output.finish();
+		}
+	};
+}
+
+#endif
@@ -2,10 +2,20 @@
 #define STATICDB_EXECUTION_HPP
 
 #include <staticdb/expressions.hpp>
+#include <staticdb/array_delta.hpp>
+#include <staticdb/bitmap_index.hpp>
 #include <staticdb/layout.hpp>
 #include <staticdb/storage.hpp>
+#include <staticdb/zone_map.hpp>
 #include <staticdb/bit_source.hpp>
+#include <staticdb/bit_sink.hpp>
 #include <staticdb/multiply.hpp>
+#include <staticdb/packed_key.hpp>
+#include <staticdb/packed_key_table.hpp>
+#include <staticdb/sort.hpp>
+#include <staticdb/thread_pool.hpp>
+#include <array>
+#include <unordered_map>
 
 namespace staticdb
 {
@@ -29,16 +39,25 @@ namespace staticdb
 		{
 			storage_pointer<Storage> begin;
 			layouts::layout element_layout;
+			std::shared_ptr<array_delta const> delta;
+			layouts::variant_tags tags;
+			layouts::bitset_encoding encoding;
 
-			explicit basic_array_accessor(storage_pointer<Storage> begin, layouts::layout element_layout)
+			explicit basic_array_accessor(storage_pointer<Storage> begin, layouts::layout element_layout,
+			                              std::shared_ptr<array_delta const> delta = nullptr,
+			                              layouts::variant_tags tags = layouts::variant_tags::in_elements,
+			                              layouts::bitset_encoding encoding = layouts::bitset_encoding::plain)
 			    : begin(begin)
 			    , element_layout(std::move(element_layout))
+			    , delta(std::move(delta))
+			    , tags(tags)
+			    , encoding(encoding)
 			{
 			}
 
 			basic_array_accessor copy() const
 			{
-				return basic_array_accessor(begin, element_layout.copy());
+				return basic_array_accessor(begin, element_layout.copy(), delta, tags, encoding);
 			}
 
 #if SILICIUM_COMPILER_GENERATES_MOVES
@@ -46,7 +65,10 @@ namespace staticdb
 #else
 			basic_array_accessor(basic_array_accessor &&other) BOOST_NOEXCEPT
 			    : begin(other.begin),
-			      element_layout(std::move(other.element_layout))
+			      element_layout(std::move(other.element_layout)),
+			      delta(std::move(other.delta)),
+			      tags(other.tags),
+			      encoding(other.encoding)
 			{
 			}
 
@@ -54,6 +76,9 @@ namespace staticdb
 			{
 				begin = other.begin;
 				element_layout = std::move(other.element_layout);
+				delta = std::move(other.delta);
+				tags = other.tags;
+				encoding = other.encoding;
 				return *this;
 			}
 #endif
@@ -256,13 +281,16 @@ namespace staticdb
 				});
 		}
 
+		template <class Storage>
+		values::value reduce_array(basic_array_accessor<Storage> const &array);
+
 		template <class Storage>
 		values::value reduce_value(pseudo_value<Storage> const &complex_value)
 		{
 			return Si::visit<values::value>(complex_value,
-			                                [](basic_array_accessor<Storage> const &) -> values::value
+			                                [](basic_array_accessor<Storage> const &array) -> values::value
 			                                {
-				                                throw std::logic_error("not implemented");
+				                                return reduce_array(array);
 				                            },
 			                                [](basic_tuple<pseudo_value<Storage>> const &tuple) -> values::value
 			                                {
@@ -293,143 +321,1877 @@ namespace staticdb
 			closure_type const *const is_closure = Si::try_get_ptr<closure_type>(maybe_closure);
 			if (!is_closure)
 			{
-				throw std::logic_error("not implemented");
+				throw std::logic_error("not implemented");
+			}
+			values::value const *const simple_argument = Si::try_get_ptr<values::value>(argument_);
+			if (!simple_argument)
+			{
+				throw std::logic_error("not implemented");
+			}
+			values::value const *const simple_bound = Si::try_get_ptr<values::value>(*is_closure->bound);
+			if (!simple_bound)
+			{
+				throw std::logic_error("not implemented");
+			}
+			return expressions::execute(*is_closure->body, *simple_argument, *simple_bound);
+		}
+
+		template <class Storage>
+		bool extract_bool(pseudo_value<Storage> const &boolean)
+		{
+			values::value const *const simple_value = Si::try_get_ptr<values::value>(boolean);
+			if (!simple_value)
+			{
+				throw std::logic_error("not implemented");
+			}
+			values::bit const *const bit = Si::try_get_ptr<values::bit>(simple_value->as_variant());
+			if (!bit)
+			{
+				throw std::logic_error("not implemented");
+			}
+			return bit->is_set;
+		}
+
+		const address address_size_in_bytes(8);
+
+		template <class Storage>
+		std::uint64_t read_packed_bits(storage_pointer<Storage> const &begin, address bit_count)
+		{
+			if (bit_count > 64)
+			{
+				throw std::invalid_argument("read_packed_bits can read at most 64 bits");
+			}
+			if (bit_count == 0)
+			{
+				return 0;
+			}
+			address const skip = begin.where % address(8);
+			std::size_t const byte_count = static_cast<std::size_t>((skip + bit_count + 7u) / 8u);
+			std::array<byte, 9> scratch;
+			Si::iterator_range<byte const *> const bytes =
+			    begin.storage->read_span(begin.where / address(8), byte_count, scratch.data());
+			if (static_cast<std::size_t>(bytes.size()) < byte_count)
+			{
+				throw std::invalid_argument("read_packed_bits needs more bytes");
+			}
+			std::uint64_t result = 0;
+			address available = address(8) - skip;
+			address remaining = bit_count;
+			for (byte const piece : bytes)
+			{
+				address const taking = (std::min)(available, remaining);
+				std::uint64_t const bits =
+				    (static_cast<std::uint64_t>(piece) >> (available - taking)) & ((std::uint64_t(1) << taking) - 1u);
+				result = (result << taking) | bits;
+				remaining -= taking;
+				available = 8;
+			}
+			return result;
+		}
+
+		// Overwrites bits.length() bits beginning at begin. Only the bytes at the boundaries are read to keep the bits
+		// around the written ones.
+		template <class Storage>
+		void write_packed_bits(storage_pointer<Storage> const &begin, bit_buffer const &bits)
+		{
+			if (bits.length() == 0)
+			{
+				return;
+			}
+			address const first_byte = begin.where / address(8);
+			std::size_t const skip = static_cast<std::size_t>(begin.where % address(8));
+			std::size_t const tail = static_cast<std::size_t>((begin.where + bits.length()) % address(8));
+			auto const read_byte = [&begin](address where) -> byte
+			{
+				byte scratch = 0;
+				Si::iterator_range<byte const *> const read = begin.storage->read_span(where, 1, &scratch);
+				if (read.empty())
+				{
+					throw std::invalid_argument("write_packed_bits needs the boundary bytes to exist");
+				}
+				return *read.begin();
+			};
+			bit_buffer merged;
+			bit_buffer const *written = &bits;
+			if ((skip != 0) || (tail != 0))
+			{
+				if (skip != 0)
+				{
+					merged.append_bits(static_cast<std::uint64_t>(read_byte(first_byte) >> (8u - skip)), skip);
+				}
+				merged.append_buffer(bits);
+				if (tail != 0)
+				{
+					byte const last = read_byte((begin.where + bits.length()) / address(8));
+					merged.append_bits(static_cast<std::uint64_t>(last & ((1u << (8u - tail)) - 1u)), 8u - tail);
+				}
+				written = &merged;
+			}
+			byte const *const bytes = written->bytes().data();
+			begin.storage->write_at(first_byte).append(Si::make_iterator_range(bytes, bytes + written->bytes().size()));
+		}
+
+		template <class Storage>
+		address deserialize_address(storage_pointer<Storage> const &begin)
+		{
+			return read_packed_bits(begin, address_size_in_bytes * address(8));
+		}
+
+		template <class Storage>
+		address array_length(storage_pointer<Storage> const &array_begin)
+		{
+			address length = deserialize_address(array_begin);
+			return length;
+		}
+
+		// Reads a zone map that serialize_zone_map wrote at begin. The counts are checked against the storage before
+		// anything is allocated for them.
+		template <class Storage>
+		zone_map read_zone_map(storage_pointer<Storage> const &begin)
+		{
+			address at = begin.where;
+			auto const read_word = [&begin, &at]() -> std::uint64_t
+			{
+				std::uint64_t const word = read_packed_bits(storage_pointer<Storage>(*begin.storage, at), 64);
+				at += 64u;
+				return word;
+			};
+			address const block_length = read_word();
+			address const length = read_word();
+			address const field_count = read_word();
+			if (block_length == 0)
+			{
+				throw std::invalid_argument("read_zone_map found a zone map without a block length");
+			}
+			address const block_count = (length / block_length) + (((length % block_length) == 0) ? 0u : 1u);
+			address const zone_bits = (2u + zone_bloom_words) * 64u;
+			Si::overflow_or<address> const end =
+			    (((Si::overflow_or<address>(block_count) * field_count) * zone_bits) +
+			     ((Si::overflow_or<address>(field_count) * 128u) + at)) +
+			    address(7);
+			byte last = 0;
+			if (end.is_overflow() ||
+			    begin.storage->read_span((*end.value() / address(8)) - 1u, 1, &last).empty())
+			{
+				throw std::invalid_argument("read_zone_map found a zone map beyond the end of the storage");
+			}
+			std::vector<bit_range> fields;
+			for (address i = 0; i < field_count; ++i)
+			{
+				address const offset = read_word();
+				address const field_length = read_word();
+				if (field_length > 64u)
+				{
+					throw std::invalid_argument("read_zone_map found a field of more than 64 bits");
+				}
+				fields.emplace_back(offset, field_length);
+			}
+			zone_map result(block_length, std::move(fields));
+			result.length = length;
+			result.zones.resize(static_cast<std::size_t>(result.block_count() * field_count));
+			for (zone &block : result.zones)
+			{
+				block.minimum = read_word();
+				block.maximum = read_word();
+				for (std::uint64_t &word : block.bloom)
+				{
+					word = read_word();
+				}
+			}
+			return result;
+		}
+
+		template <class Storage>
+		struct tag_column;
+
+		template <class Storage>
+		struct encoded_column;
+
+		// Finds an element of an array whose elements do not have a fixed size by reading its offset. The index can
+		// be the length of the array to find the end of the last element.
+		template <class Storage>
+		Si::optional<storage_pointer<Storage>> variable_element_pointer(storage_pointer<Storage> const &array_begin,
+		                                                                address index)
+		{
+			address const width_at = array_begin.where + (address_size_in_bytes * address(8));
+			address const width = read_packed_bits(storage_pointer<Storage>(*array_begin.storage, width_at), 8);
+			Si::overflow_or<address> const offset_at =
+			    (Si::overflow_or<address>(index) * width) + (width_at + address(8));
+			Si::overflow_or<address> const first_element =
+			    ((Si::overflow_or<address>(array_length(array_begin)) + address(1)) * width) + (width_at + address(8));
+			if (offset_at.is_overflow() || first_element.is_overflow() || (width > 64))
+			{
+				return Si::none;
+			}
+			address const offset =
+			    read_packed_bits(storage_pointer<Storage>(*array_begin.storage, *offset_at.value()), width);
+			Si::overflow_or<address> const wanted = Si::overflow_or<address>(offset) + *first_element.value();
+			if (wanted.is_overflow())
+			{
+				return Si::none;
+			}
+			return storage_pointer<Storage>(*array_begin.storage, *wanted.value());
+		}
+
+		template <class Storage>
+		Si::overflow_or<address> stored_size_in_bits(storage_pointer<Storage> const &begin, layouts::layout const &stored)
+		{
+			return Si::visit<Si::overflow_or<address>>(
+			    stored.as_variant(),
+			    [](layouts::unit) -> Si::overflow_or<address>
+			    {
+				    return address(0);
+				},
+			    [&begin](layouts::tuple const &tuple_) -> Si::overflow_or<address>
+			    {
+				    Si::overflow_or<address> sum = address(0);
+				    for (layouts::layout const &element : tuple_.elements)
+				    {
+					    if (sum.is_overflow())
+					    {
+						    return sum;
+					    }
+					    sum += stored_size_in_bits(storage_pointer<Storage>(*begin.storage, begin.where + *sum.value()),
+					                               element);
+				    }
+				    return sum;
+				},
+			    [&begin](layouts::array const &array_) -> Si::overflow_or<address>
+			    {
+				    if (array_.encoding != layouts::bitset_encoding::plain)
+				    {
+					    Si::overflow_or<address> const end =
+					        encoded_column<Storage>(layouts::encoded_element(array_), begin, array_.encoding).end();
+					    return end.is_overflow() ? end : Si::overflow_or<address>(*end.value() - begin.where);
+				    }
+				    if (array_.tags != layouts::variant_tags::in_elements)
+				    {
+					    Si::overflow_or<address> const end =
+					        tag_column<Storage>(layouts::tagged_element(array_), begin, array_.tags).end();
+					    return end.is_overflow() ? end : Si::overflow_or<address>(*end.value() - begin.where);
+				    }
+				    if (!layouts::has_fixed_size(*array_.element))
+				    {
+					    address const length = array_length(begin);
+					    Si::optional<storage_pointer<Storage>> const end = variable_element_pointer(begin, length);
+					    if (!end)
+					    {
+						    return Si::overflow;
+					    }
+					    return end->where - begin.where;
+				    }
+				    Si::overflow_or<address> const elements =
+				        layouts::layout_size_in_bits(*array_.element) * array_length(begin);
+				    return elements + (address_size_in_bytes * address(8));
+				},
+			    [](layouts::bitset const &bitset_) -> Si::overflow_or<address>
+			    {
+				    return bitset_.length;
+				},
+			    [&stored](layouts::variant const &) -> Si::overflow_or<address>
+			    {
+				    return layouts::layout_size_in_bits(stored);
+				});
+		}
+
+		template <class Storage>
+		pseudo_value<Storage> access_value(storage_pointer<Storage> const &element_begin,
+		                                   layouts::layout const &element_layout)
+		{
+			return Si::visit<pseudo_value<Storage>>(
+			    element_layout.as_variant(),
+			    [](layouts::unit) -> pseudo_value<Storage>
+			    {
+				    return pseudo_value<Storage>(values::value(values::unit()));
+				},
+			    [&element_begin](layouts::tuple const &tuple_) -> pseudo_value<Storage>
+			    {
+				    basic_tuple<pseudo_value<Storage>> result;
+				    result.elements.reserve(tuple_.elements.size());
+				    address where = element_begin.where;
+				    for (layouts::layout const &element : tuple_.elements)
+				    {
+					    storage_pointer<Storage> const member(*element_begin.storage, where);
+					    result.elements.emplace_back(access_value(member, element));
+					    Si::overflow_or<address> const next =
+					        Si::overflow_or<address>(where) + stored_size_in_bits(member, element);
+					    if (next.is_overflow())
+					    {
+						    throw std::invalid_argument("access_value found a tuple that exceeds the address space");
+					    }
+					    where = *next.value();
+				    }
+				    return pseudo_value<Storage>(std::move(result));
+				},
+			    [&element_begin](layouts::array const &array_) -> pseudo_value<Storage>
+			    {
+				    return pseudo_value<Storage>(basic_array_accessor<Storage>(
+				        element_begin, array_.element->copy(), find_delta(*element_begin.storage, element_begin.where),
+				        array_.tags, array_.encoding));
+				},
+			    [&element_begin](layouts::bitset const &bitset_) -> pseudo_value<Storage>
+			    {
+				    std::vector<values::value> bits;
+				    bits.reserve(bitset_.length);
+				    for (address i = 0; i < bitset_.length; i += 64)
+				    {
+					    address const chunk = (std::min)(address(64), bitset_.length - i);
+					    storage_pointer<Storage> const piece(*element_begin.storage, element_begin.where + i);
+					    std::uint64_t const packed = read_packed_bits(piece, chunk);
+					    for (address j = chunk; j > 0; --j)
+					    {
+						    bits.emplace_back(values::bit(((packed >> (j - 1u)) & 1u) != 0));
+					    }
+				    }
+				    return pseudo_value<Storage>(values::value(values::tuple(std::move(bits))));
+				},
+			    [&element_begin](layouts::variant const &variant_) -> pseudo_value<Storage>
+			    {
+				    address const tag_bits = layouts::variant_tag_bits(variant_);
+				    std::uint64_t const leaf = read_packed_bits(element_begin, tag_bits);
+				    if (leaf >= variant_.leaves.size())
+				    {
+					    throw std::invalid_argument("access_value found a variant with an invalid index");
+				    }
+				    std::size_t const chosen = static_cast<std::size_t>(leaf);
+				    pseudo_value<Storage> const content =
+				        access_value(storage_pointer<Storage>(*element_begin.storage, element_begin.where + tag_bits),
+				                     layouts::leaf_layout(variant_, chosen));
+				    return pseudo_value<Storage>(layouts::make_leaf_value(variant_, chosen, reduce_value(content)));
+				});
+		}
+
+		template <class Storage>
+		pseudo_value<Storage> access_root(Storage &storage, layouts::layout const &root,
+		                                  std::vector<address> const &member_offsets)
+		{
+			layouts::tuple const *const members = Si::try_get_ptr<layouts::tuple>(root.as_variant());
+			if (!members || (member_offsets.size() != members->elements.size()))
+			{
+				return access_value(storage_pointer<Storage>(storage, 0), root);
+			}
+			basic_tuple<pseudo_value<Storage>> result;
+			result.elements.reserve(members->elements.size());
+			for (std::size_t i = 0; i < member_offsets.size(); ++i)
+			{
+				result.elements.emplace_back(
+				    access_value(storage_pointer<Storage>(storage, member_offsets[i]), members->elements[i]));
+			}
+			return pseudo_value<Storage>(std::move(result));
+		}
+
+		template <class Storage>
+		Si::optional<storage_pointer<Storage>> element_pointer(storage_pointer<Storage> const &array_begin, address index,
+		                                                       Si::overflow_or<address> element_size_in_bits)
+		{
+			Si::overflow_or<address> first_element = array_begin.where + (address_size_in_bytes * address(8));
+			Si::overflow_or<address> wanted_element = first_element + (element_size_in_bits * index);
+			if (wanted_element.is_overflow())
+			{
+				return Si::none;
+			}
+			return storage_pointer<Storage>(*array_begin.storage, *wanted_element.value());
+		}
+
+		template <class Storage>
+		Si::optional<pseudo_value<Storage>> array_get(storage_pointer<Storage> const &array_begin, address index,
+		                                              layouts::layout const &element)
+		{
+			Si::optional<storage_pointer<Storage>> const wanted_element =
+			    layouts::has_fixed_size(element) ? element_pointer(array_begin, index, layout_size_in_bits(element))
+			                                     : variable_element_pointer(array_begin, index);
+			if (!wanted_element)
+			{
+				return Si::none;
+			}
+			return access_value(*wanted_element, element);
+		}
+
+		// The parts of an array of variants that stores the tags in a column: the tags of all elements, then the
+		// padded contents of all elements and, if the array is indexed, the entries of every leaf. A sparse column
+		// has the rank directory between the tags and the contents, which are only stored for present elements.
+		template <class Storage>
+		struct tag_column
+		{
+			layouts::variant const *element;
+			storage_pointer<Storage> tags;
+			storage_pointer<Storage> directory;
+			storage_pointer<Storage> contents;
+			storage_pointer<Storage> index;
+			address length;
+			address tag_bits;
+			address content_bits;
+			bool indexed;
+			bool sparse;
+
+			tag_column(layouts::variant const &element, storage_pointer<Storage> const &array_begin,
+			           layouts::variant_tags kind)
+			    : element(&element)
+			    , tags(*array_begin.storage, array_begin.where + (address_size_in_bytes * address(8)))
+			    , directory(tags)
+			    , contents(tags)
+			    , index(tags)
+			    , length(array_length(array_begin))
+			    , tag_bits(layouts::variant_tag_bits(element))
+			    , content_bits(0)
+			    , indexed(kind == layouts::variant_tags::indexed_column)
+			    , sparse(kind == layouts::variant_tags::sparse_column)
+			{
+				Si::overflow_or<address> const content_size = layouts::variant_content_bits(element);
+				if (content_size.is_overflow())
+				{
+					throw std::invalid_argument("tag_column found a variant that exceeds the address space");
+				}
+				content_bits = *content_size.value();
+				Si::overflow_or<address> const directory_begin =
+				    (Si::overflow_or<address>(length) * tag_bits) + tags.where;
+				if (directory_begin.is_overflow())
+				{
+					throw std::invalid_argument("tag_column found an array that exceeds the address space");
+				}
+				directory.where = *directory_begin.value();
+				contents.where = directory.where;
+				if (sparse)
+				{
+					address const blocks = (length + layouts::sparse_block_bits - 1u) / layouts::sparse_block_bits;
+					contents.where += blocks * address_size_in_bytes * address(8);
+				}
+				Si::overflow_or<address> const index_begin =
+				    (Si::overflow_or<address>(sparse ? rank(length) : length) * content_bits) + contents.where;
+				if (index_begin.is_overflow())
+				{
+					throw std::invalid_argument("tag_column found an array that exceeds the address space");
+				}
+				index.where = *index_begin.value();
+			}
+
+			storage_pointer<Storage> tag_at(address element_index) const
+			{
+				return storage_pointer<Storage>(*tags.storage, tags.where + (element_index * tag_bits));
+			}
+
+			// The number of present elements before an element of a sparse column. The directory has the number for
+			// the beginning of the block, so at most a block of presence bits has to be counted.
+			address rank(address element_index) const
+			{
+				assert(sparse);
+				if (element_index == 0)
+				{
+					return 0;
+				}
+				address const block = (element_index - 1u) / layouts::sparse_block_bits;
+				address const entry_bits = address_size_in_bytes * address(8);
+				address counted = read_packed_bits(
+				    storage_pointer<Storage>(*directory.storage, directory.where + (block * entry_bits)), entry_bits);
+				for (address at = block * layouts::sparse_block_bits; at < element_index;)
+				{
+					address const taking = (std::min)(address(64), element_index - at);
+					counted += count_ones(read_packed_bits(tag_at(at), taking));
+					at += taking;
+				}
+				return counted;
+			}
+
+			storage_pointer<Storage> content_at(address element_index) const
+			{
+				address const position = sparse ? rank(element_index) : element_index;
+				return storage_pointer<Storage>(*contents.storage, contents.where + (position * content_bits));
+			}
+
+			pseudo_value<Storage> get(address element_index) const
+			{
+				std::uint64_t const leaf = read_packed_bits(tag_at(element_index), tag_bits);
+				if (leaf >= element->leaves.size())
+				{
+					throw std::invalid_argument("tag_column found a variant with an invalid index");
+				}
+				std::size_t const chosen = static_cast<std::size_t>(leaf);
+				// the absent leaf of a sparse column is empty, so there is no need to rank
+				pseudo_value<Storage> const content =
+				    access_value((sparse && (chosen == 0)) ? contents : content_at(element_index),
+				                 layouts::leaf_layout(*element, chosen));
+				return pseudo_value<Storage>(layouts::make_leaf_value(*element, chosen, reduce_value(content)));
+			}
+
+			// The present element at a position in the contents of a sparse column.
+			pseudo_value<Storage> get_present(address position) const
+			{
+				assert(sparse);
+				storage_pointer<Storage> const content_begin(*contents.storage,
+				                                             contents.where + (position * content_bits));
+				pseudo_value<Storage> const content = access_value(content_begin, layouts::leaf_layout(*element, 1));
+				return pseudo_value<Storage>(layouts::make_leaf_value(*element, 1, reduce_value(content)));
+			}
+
+			// The position of the first entry of a leaf in the index, or the number of entries for the last leaf + 1.
+			address leaf_entries_begin(std::size_t leaf) const
+			{
+				assert(indexed);
+				assert(leaf <= element->leaves.size());
+				address const entry_bits = address_size_in_bytes * address(8);
+				return read_packed_bits(storage_pointer<Storage>(*index.storage, index.where + (leaf * entry_bits)),
+				                        entry_bits);
+			}
+
+			address entry(address position) const
+			{
+				assert(indexed);
+				address const entry_bits = address_size_in_bytes * address(8);
+				address const entries_begin = index.where + ((element->leaves.size() + 1u) * entry_bits);
+				return read_packed_bits(
+				    storage_pointer<Storage>(*index.storage, entries_begin + (position * entry_bits)), entry_bits);
+			}
+
+			// The bit after the last one of the array.
+			Si::overflow_or<address> end() const
+			{
+				if (!indexed)
+				{
+					return index.where;
+				}
+				address const entry_bits = address_size_in_bytes * address(8);
+				Si::overflow_or<address> const entries =
+				    Si::overflow_or<address>(length) + address(element->leaves.size() + 1u);
+				return (entries * entry_bits) + index.where;
+			}
+		};
+
+		template <class Storage>
+		Si::optional<tag_column<Storage>> find_tag_column(basic_array_accessor<Storage> const &array)
+		{
+			if (array.tags == layouts::variant_tags::in_elements)
+			{
+				return Si::none;
+			}
+			return tag_column<Storage>(layouts::tagged_element(array.element_layout, array.tags), array.begin,
+			                           array.tags);
+		}
+
+		inline values::value make_bitset_value(std::uint64_t packed, address length)
+		{
+			std::vector<values::value> bits;
+			bits.reserve(static_cast<std::size_t>(length));
+			for (address j = length; j > 0; --j)
+			{
+				bits.emplace_back(values::bit(((packed >> (j - 1u)) & 1u) != 0));
+			}
+			return values::value(values::tuple(std::move(bits)));
+		}
+
+		// The parts of an array of bitsets with an encoding other than plain. Every element has a code of code_bits
+		// bits: the difference to the reference, the difference to the previous element, the position in the
+		// dictionary or the low bits of the difference to the reference.
+		template <class Storage>
+		struct encoded_column
+		{
+			layouts::bitset_encoding encoding;
+			address element_bits;
+			address length;
+			std::uint64_t reference;
+			storage_pointer<Storage> samples;
+			storage_pointer<Storage> dictionary;
+			address dictionary_length;
+			storage_pointer<Storage> codes;
+			address code_bits;
+			storage_pointer<Storage> zero_samples;
+			storage_pointer<Storage> high;
+			address high_length;
+
+			encoded_column(layouts::bitset element, storage_pointer<Storage> const &array_begin,
+			               layouts::bitset_encoding encoding)
+			    : encoding(encoding)
+			    , element_bits(element.length)
+			    , length(array_length(array_begin))
+			    , reference(0)
+			    , samples(*array_begin.storage, array_begin.where + (address_size_in_bytes * address(8)))
+			    , dictionary(samples)
+			    , dictionary_length(0)
+			    , codes(samples)
+			    , code_bits(0)
+			    , zero_samples(samples)
+			    , high(samples)
+			    , high_length(0)
+			{
+				assert(encoding != layouts::bitset_encoding::plain);
+				address const word_bits = address_size_in_bytes * address(8);
+				address where = samples.where;
+				switch (encoding)
+				{
+				case layouts::bitset_encoding::plain:
+					break;
+
+				case layouts::bitset_encoding::frame_of_reference:
+					reference = read_packed_bits(samples, word_bits);
+					code_bits = read_packed_bits(storage_pointer<Storage>(*samples.storage, where + word_bits), 8);
+					where += word_bits + 8u;
+					break;
+
+				case layouts::bitset_encoding::delta:
+				{
+					code_bits = read_packed_bits(samples, 8);
+					samples.where += 8u;
+					Si::overflow_or<address> const codes_begin =
+					    (Si::overflow_or<address>(block_count()) * word_bits) + samples.where;
+					if (codes_begin.is_overflow())
+					{
+						throw std::invalid_argument("encoded_column found an array that exceeds the address space");
+					}
+					where = *codes_begin.value();
+					break;
+				}
+
+				case layouts::bitset_encoding::dictionary:
+				{
+					dictionary_length = read_packed_bits(dictionary, word_bits);
+					dictionary.where += word_bits;
+					Si::overflow_or<address> const widths_at =
+					    (Si::overflow_or<address>(dictionary_length) * element_bits) + dictionary.where;
+					if (widths_at.is_overflow())
+					{
+						throw std::invalid_argument("encoded_column found an array that exceeds the address space");
+					}
+					code_bits = read_packed_bits(storage_pointer<Storage>(*samples.storage, *widths_at.value()), 8);
+					where = *widths_at.value() + 8u;
+					break;
+				}
+
+				case layouts::bitset_encoding::elias_fano:
+				{
+					reference = read_packed_bits(samples, word_bits);
+					code_bits = read_packed_bits(storage_pointer<Storage>(*samples.storage, where + word_bits), 8);
+					high_length =
+					    read_packed_bits(storage_pointer<Storage>(*samples.storage, where + word_bits + 8u), word_bits);
+					if (high_length < length)
+					{
+						throw std::invalid_argument("encoded_column found too few high bits");
+					}
+					samples.where += word_bits + 8u + word_bits;
+					zero_samples.where = samples.where + (sample_count(length) * word_bits);
+					Si::overflow_or<address> const codes_begin =
+					    (Si::overflow_or<address>(sample_count(high_length - length)) * word_bits) + zero_samples.where;
+					Si::overflow_or<address> const high_begin =
+					    (Si::overflow_or<address>(length) * code_bits) + codes_begin;
+					if (high_begin.is_overflow())
+					{
+						throw std::invalid_argument("encoded_column found an array that exceeds the address space");
+					}
+					where = *codes_begin.value();
+					high.where = *high_begin.value();
+					break;
+				}
+				}
+				if (code_bits > 64)
+				{
+					throw std::invalid_argument("encoded_column found codes of more than 64 bits");
+				}
+				codes.where = where;
+			}
+
+			static address sample_count(address sampled)
+			{
+				return (sampled + layouts::elias_fano_sample_interval - 1u) / layouts::elias_fano_sample_interval;
+			}
+
+			address block_count() const
+			{
+				return (length + layouts::delta_block_length - 1u) / layouts::delta_block_length;
+			}
+
+			std::uint64_t dictionary_entry(address position) const
+			{
+				return read_packed_bits(
+				    storage_pointer<Storage>(*dictionary.storage, dictionary.where + (position * element_bits)),
+				    element_bits);
+			}
+
+			std::uint64_t code_at(address element_index) const
+			{
+				return read_packed_bits(
+				    storage_pointer<Storage>(*codes.storage, codes.where + (element_index * code_bits)), code_bits);
+			}
+
+			// The element that a code stands for. Delta codes also need the previous element.
+			std::uint64_t decode(address element_index, std::uint64_t code, std::uint64_t previous) const
+			{
+				address const word_bits = address_size_in_bytes * address(8);
+				switch (encoding)
+				{
+				case layouts::bitset_encoding::plain:
+				case layouts::bitset_encoding::frame_of_reference:
+				case layouts::bitset_encoding::elias_fano:
+					break;
+
+				case layouts::bitset_encoding::delta:
+					if ((element_index % layouts::delta_block_length) == 0)
+					{
+						address const block = element_index / layouts::delta_block_length;
+						return read_packed_bits(
+						    storage_pointer<Storage>(*samples.storage, samples.where + (block * word_bits)), word_bits);
+					}
+					return previous + code;
+
+				case layouts::bitset_encoding::dictionary:
+					return dictionary_entry(code);
+				}
+				return reference + code;
+			}
+
+			// Calls visit with the index and the code of every element in [begin, end). As many codes as fit into 64
+			// bits are read at once.
+			template <class Visitor>
+			void for_each_code(address begin, address end, Visitor &&visit) const
+			{
+				if (code_bits == 0)
+				{
+					for (address index = begin; index < end; ++index)
+					{
+						visit(index, std::uint64_t(0));
+					}
+					return;
+				}
+				address const codes_per_read = address(64) / code_bits;
+				std::uint64_t const mask =
+				    (code_bits == 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << code_bits) - 1u);
+				for (address index = begin; index < end;)
+				{
+					address const count = (std::min)(codes_per_read, end - index);
+					std::uint64_t const read = read_packed_bits(
+					    storage_pointer<Storage>(*codes.storage, codes.where + (index * code_bits)), count * code_bits);
+					for (address i = 0; i < count; ++i)
+					{
+						visit(index + i, (read >> ((count - 1u - i) * code_bits)) & mask);
+					}
+					index += count;
+				}
+			}
+
+			// The position in the high bits of the one of an element, or with ones being false the position of the
+			// zero that ends a bucket. The scan begins at the closest sample.
+			address select(bool ones, address rank) const
+			{
+				address const word_bits = address_size_in_bytes * address(8);
+				storage_pointer<Storage> const &sampled = ones ? samples : zero_samples;
+				address const sample = rank / layouts::elias_fano_sample_interval;
+				address at = read_packed_bits(
+				    storage_pointer<Storage>(*sampled.storage, sampled.where + (sample * word_bits)), word_bits);
+				address remaining = rank - (sample * layouts::elias_fano_sample_interval);
+				for (;;)
+				{
+					if (at >= high_length)
+					{
+						throw std::invalid_argument("encoded_column found too few high bits");
+					}
+					address const taking = (std::min)(address(64), high_length - at);
+					std::uint64_t word =
+					    read_packed_bits(storage_pointer<Storage>(*high.storage, high.where + at), taking);
+					if (!ones)
+					{
+						word = ~word & ((taking == 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << taking) - 1u));
+					}
+					address const found = count_ones(word);
+					if (remaining >= found)
+					{
+						remaining -= found;
+						at += taking;
+						continue;
+					}
+					for (address j = 0;; ++j)
+					{
+						if (((word >> (taking - 1u - j)) & 1u) == 0)
+						{
+							continue;
+						}
+						if (remaining == 0)
+						{
+							return at + j;
+						}
+						--remaining;
+					}
+				}
+			}
+
+			// Calls visit with the index and the value of the elements of an Elias-Fano array from begin on until
+			// end or until visit returns false. The high bits are read 64 at a time.
+			template <class Visitor>
+			void scan_elias_fano(address begin, address end, Visitor &&visit) const
+			{
+				if (begin >= end)
+				{
+					return;
+				}
+				address index = begin;
+				for (address at = select(true, begin); index < end;)
+				{
+					if (at >= high_length)
+					{
+						throw std::invalid_argument("encoded_column found too few high bits");
+					}
+					address const taking = (std::min)(address(64), high_length - at);
+					std::uint64_t const word =
+					    read_packed_bits(storage_pointer<Storage>(*high.storage, high.where + at), taking);
+					for (address j = 0; (j < taking) && (index < end); ++j)
+					{
+						if (((word >> (taking - 1u - j)) & 1u) == 0)
+						{
+							continue;
+						}
+						std::uint64_t const high_part = (at + j) - index;
+						if (!visit(index, reference + ((high_part << code_bits) | code_at(index))))
+						{
+							return;
+						}
+						++index;
+					}
+					at += taking;
+				}
+			}
+
+			// The index of the first element that is not less than wanted, or the length if there is none. Only the
+			// elements in the bucket of wanted are decoded.
+			address lower_bound(std::uint64_t wanted) const
+			{
+				assert(encoding == layouts::bitset_encoding::elias_fano);
+				if ((length == 0) || (wanted <= reference))
+				{
+					return 0;
+				}
+				address const bucket = (code_bits == 64) ? 0 : ((wanted - reference) >> code_bits);
+				if (bucket >= (high_length - length))
+				{
+					return length;
+				}
+				address const first = (bucket == 0) ? 0 : (select(false, bucket - 1u) + 1u - bucket);
+				address found = length;
+				scan_elias_fano(first, length, [wanted, &found](address index, std::uint64_t element)
+				                {
+					                if (element < wanted)
+					                {
+						                return true;
+					                }
+					                found = index;
+					                return false;
+					            });
+				return found;
+			}
+
+			// Appends the elements in [begin, end) to decoded. Delta codes are summed from the beginning of the block.
+			void decode_range(address begin, address end, std::vector<std::uint64_t> &decoded) const
+			{
+				if (encoding == layouts::bitset_encoding::elias_fano)
+				{
+					scan_elias_fano(begin, end, [&decoded](address, std::uint64_t element)
+					                {
+						                decoded.emplace_back(element);
+						                return true;
+						            });
+					return;
+				}
+				address const first = (encoding == layouts::bitset_encoding::delta)
+				                          ? (begin - (begin % layouts::delta_block_length))
+				                          : begin;
+				std::uint64_t previous = 0;
+				for_each_code(first, end, [this, begin, &previous, &decoded](address index, std::uint64_t code)
+				              {
+					              previous = decode(index, code, previous);
+					              if (index >= begin)
+					              {
+						              decoded.emplace_back(previous);
+					              }
+					          });
+			}
+
+			std::uint64_t value_at(address element_index) const
+			{
+				if (encoding == layouts::bitset_encoding::elias_fano)
+				{
+					std::uint64_t const high_part = select(true, element_index) - element_index;
+					return reference + ((high_part << code_bits) | code_at(element_index));
+				}
+				if (encoding == layouts::bitset_encoding::delta)
+				{
+					std::vector<std::uint64_t> decoded;
+					decode_range(element_index, element_index + 1u, decoded);
+					return decoded.front();
+				}
+				return decode(element_index, code_at(element_index), 0);
+			}
+
+			pseudo_value<Storage> get(address element_index) const
+			{
+				return pseudo_value<Storage>(make_bitset_value(value_at(element_index), element_bits));
+			}
+
+			// The code of every element that equals the given one, or none if no element does. Delta and Elias-Fano
+			// codes do not stand for an element on their own, so they are never compared directly.
+			Si::optional<std::uint64_t> find_code(std::uint64_t wanted) const
+			{
+				assert((encoding == layouts::bitset_encoding::frame_of_reference) ||
+				       (encoding == layouts::bitset_encoding::dictionary));
+				if (encoding == layouts::bitset_encoding::frame_of_reference)
+				{
+					if ((wanted < reference) || (layouts::offset_bits(wanted - reference) > code_bits))
+					{
+						return Si::none;
+					}
+					return wanted - reference;
+				}
+				address first = 0;
+				address count = dictionary_length;
+				while (count > 0)
+				{
+					address const half = count / 2u;
+					if (dictionary_entry(first + half) < wanted)
+					{
+						first += half + 1u;
+						count -= half + 1u;
+					}
+					else
+					{
+						count = half;
+					}
+				}
+				if ((first == dictionary_length) || (dictionary_entry(first) != wanted))
+				{
+					return Si::none;
+				}
+				return first;
+			}
+
+			// The bit after the last one of the array.
+			Si::overflow_or<address> end() const
+			{
+				if (encoding == layouts::bitset_encoding::elias_fano)
+				{
+					return Si::overflow_or<address>(high.where) + high_length;
+				}
+				return (Si::overflow_or<address>(length) * code_bits) + codes.where;
+			}
+		};
+
+		template <class Storage>
+		Si::optional<encoded_column<Storage>> find_encoded_column(basic_array_accessor<Storage> const &array)
+		{
+			if (array.encoding == layouts::bitset_encoding::plain)
+			{
+				return Si::none;
+			}
+			layouts::bitset const *const element = Si::try_get_ptr<layouts::bitset>(array.element_layout.as_variant());
+			if (!element || (element->length > 64))
+			{
+				throw std::invalid_argument("an encoded array needs bitset elements of at most 64 bits");
+			}
+			return encoded_column<Storage>(*element, array.begin, array.encoding);
+		}
+
+		// Like array_get, but also for arrays that store the tags of their elements in a column or encode their
+		// elements.
+		template <class Storage>
+		Si::optional<pseudo_value<Storage>> get_stored_element(basic_array_accessor<Storage> const &array,
+		                                                       address index)
+		{
+			Si::optional<encoded_column<Storage>> const encoded = find_encoded_column(array);
+			if (encoded)
+			{
+				return encoded->get(index);
+			}
+			Si::optional<tag_column<Storage>> const column = find_tag_column(array);
+			if (column)
+			{
+				return column->get(index);
+			}
+			return array_get(array.begin, index, array.element_layout);
+		}
+
+		// Reads all elements of an array, including the changes of its delta.
+		template <class Storage>
+		values::value reduce_array(basic_array_accessor<Storage> const &array)
+		{
+			address const stored_length = array_length(array.begin);
+			address const length = array.delta ? array.delta->length(stored_length) : stored_length;
+			std::vector<values::value> elements;
+			Si::optional<encoded_column<Storage>> const encoded = find_encoded_column(array);
+			if (encoded && !array.delta)
+			{
+				std::vector<std::uint64_t> decoded;
+				decoded.reserve(static_cast<std::size_t>(length));
+				encoded->decode_range(0, length, decoded);
+				elements.reserve(decoded.size());
+				for (std::uint64_t element : decoded)
+				{
+					elements.emplace_back(make_bitset_value(element, encoded->element_bits));
+				}
+				return values::value(values::tuple(std::move(elements)));
+			}
+			for (address i = 0; i < length; ++i)
+			{
+				address index = i;
+				if (array.delta)
+				{
+					array_delta::location const found = array.delta->locate(i);
+					if (found.value)
+					{
+						elements.emplace_back(found.value->copy());
+						continue;
+					}
+					index = found.stored_index;
+				}
+				Si::optional<pseudo_value<Storage>> const element = get_stored_element(array, index);
+				if (!element)
+				{
+					throw std::invalid_argument("reduce_value found an array that exceeds the address space");
+				}
+				elements.emplace_back(reduce_value(*element));
+			}
+			return values::value(values::tuple(std::move(elements)));
+		}
+
+		// Overwrites the element at index of a stored array with a value of the same fixed size and returns the value
+		// it had before. Nothing else of the array is read or written.
+		template <class Storage>
+		values::value set_array_element(basic_array_accessor<Storage> const &array, address index,
+		                                values::value const &new_element)
+		{
+			if (!layouts::has_fixed_size(array.element_layout))
+			{
+				throw std::invalid_argument("set_array_element needs elements of a fixed size");
+			}
+			if (index >= array_length(array.begin))
+			{
+				throw std::invalid_argument("set_array_element called with index out of range");
+			}
+			if (array.encoding != layouts::bitset_encoding::plain)
+			{
+				throw std::invalid_argument("set_array_element cannot change the codes of an encoded array");
+			}
+			Si::optional<tag_column<Storage>> const column = find_tag_column(array);
+			if (column)
+			{
+				if (column->indexed)
+				{
+					throw std::invalid_argument("set_array_element cannot update the index of a tag column");
+				}
+				Si::optional<std::pair<std::size_t, values::value const *>> const leaf =
+				    layouts::find_leaf(*column->element, new_element);
+				if (!leaf)
+				{
+					throw std::invalid_argument("set_array_element got an element of the wrong type");
+				}
+				if (column->sparse && (read_packed_bits(column->tag_at(index), column->tag_bits) != leaf->first))
+				{
+					throw std::invalid_argument(
+					    "set_array_element cannot change whether an element of a sparse column is present");
+				}
+				bit_buffer tag;
+				tag.append_bits(leaf->first, static_cast<std::size_t>(column->tag_bits));
+				bit_buffer content;
+				layouts::serialize_leaf_content(content, *column->element, leaf->first, *leaf->second);
+				values::value previous = reduce_value(column->get(index));
+				write_packed_bits(column->tag_at(index), tag);
+				write_packed_bits(column->content_at(index), content);
+				return previous;
+			}
+			Si::overflow_or<address> const element_size = layouts::layout_size_in_bits(array.element_layout);
+			bit_buffer encoded;
+			layouts::serialize(encoded, new_element, array.element_layout);
+			if (element_size.is_overflow() || (encoded.length() != *element_size.value()))
+			{
+				throw std::invalid_argument("set_array_element got an element of the wrong size");
+			}
+			Si::optional<storage_pointer<Storage>> const element = element_pointer(array.begin, index, element_size);
+			if (!element)
+			{
+				throw std::invalid_argument("set_array_element found an element beyond the address space");
+			}
+			values::value previous = reduce_value(access_value(*element, array.element_layout));
+			write_packed_bits(*element, encoded);
+			return previous;
+		}
+
+		inline packed_key pack_value(values::value const &key)
+		{
+			packing_bit_sink packer;
+			values::serialize(packer, key);
+			return packed_key(packer.packed(), packer.length());
+		}
+
+		template <class Storage>
+		std::uint64_t read_key_bits(storage_pointer<Storage> const &element, key_bits const &bits)
+		{
+			std::uint64_t packed = 0;
+			for (bit_range const &range : bits.ranges)
+			{
+				std::uint64_t const part =
+				    read_packed_bits(storage_pointer<Storage>(*element.storage, element.where + range.offset),
+				                     range.length);
+				packed = (range.length == 64) ? part : ((packed << range.length) | part);
+			}
+			return packed;
+		}
+
+		// Like read_key_bits for an element that was already decoded into the lowest element_bits bits of a word.
+		inline std::uint64_t extract_key_bits(std::uint64_t element, address element_bits, key_bits const &bits)
+		{
+			std::uint64_t packed = 0;
+			for (bit_range const &range : bits.ranges)
+			{
+				if (range.length == 0)
+				{
+					continue;
+				}
+				std::uint64_t const mask =
+				    (range.length == 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << range.length) - 1u);
+				std::uint64_t const part = (element >> (element_bits - range.offset - range.length)) & mask;
+				packed = (range.length == 64) ? part : ((packed << range.length) | part);
+			}
+			return packed;
+		}
+
+		// Whether the bits are all within the tag at the beginning of a variant.
+		inline bool reads_only_tag(key_bits const &bits, address tag_bits)
+		{
+			return std::all_of(bits.ranges.begin(), bits.ranges.end(), [tag_bits](bit_range range)
+			                   {
+				                   return (range.offset + range.length) <= tag_bits;
+				               });
+		}
+
+		template <class Storage>
+		struct key_reader
+		{
+			explicit key_reader(pseudo_value<Storage> const &input, pseudo_value<Storage> const &key)
+			    : m_array(Si::try_get_ptr<basic_array_accessor<Storage>>(input))
+			    , m_tuple(Si::try_get_ptr<basic_tuple<pseudo_value<Storage>>>(input))
+			    , m_key(&key)
+			    , m_length(0)
+			    , m_block_begin(0)
+			{
+				if (m_array)
+				{
+					m_length = array_length(m_array->begin);
+					if (m_array->delta)
+					{
+						m_length = m_array->delta->length(m_length);
+					}
+					if (layouts::has_fixed_size(m_array->element_layout))
+					{
+						m_element_size = layout_size_in_bits(m_array->element_layout);
+					}
+					typedef basic_closure<pseudo_value<Storage>> closure_type;
+					closure_type const *const is_closure = Si::try_get_ptr<closure_type>(key);
+					if (is_closure)
+					{
+						m_bits = find_key_bits(*is_closure->body, m_array->element_layout);
+					}
+					m_encoded = find_encoded_column(*m_array);
+					m_column = find_tag_column(*m_array);
+					if (m_column && m_bits && !reads_only_tag(*m_bits, m_column->tag_bits))
+					{
+						m_bits = Si::optional<key_bits>();
+					}
+				}
+				else if (m_tuple)
+				{
+					m_length = m_tuple->elements.size();
+				}
+				else
+				{
+					throw std::logic_error("not implemented");
+				}
+			}
+
+			address length() const
+			{
+				return m_length;
+			}
+
+			Si::optional<packed_key> read(address index) const
+			{
+				if (m_array && m_array->delta)
+				{
+					array_delta::location const found = m_array->delta->locate(index);
+					if (found.value)
+					{
+						return pack_value(
+						    reduce_value(execute_closure(*m_key, pseudo_value<Storage>(found.value->copy()))));
+					}
+					index = found.stored_index;
+				}
+				if (m_bits && m_encoded)
+				{
+					return packed_key(extract_key_bits(encoded_value_at(index), m_encoded->element_bits, *m_bits),
+					                  m_bits->value_length);
+				}
+				if (m_bits && m_column)
+				{
+					return packed_key(read_key_bits(m_column->tag_at(index), *m_bits), m_bits->value_length);
+				}
+				if (m_bits)
+				{
+					Si::optional<storage_pointer<Storage>> const element =
+					    element_pointer(m_array->begin, index, m_element_size);
+					if (!element)
+					{
+						return Si::none;
+					}
+					return packed_key(read_key_bits(*element, *m_bits), m_bits->value_length);
+				}
+				Si::optional<pseudo_value<Storage>> const element = get(index);
+				if (!element)
+				{
+					return Si::none;
+				}
+				return pack_value(reduce_value(execute_closure(*m_key, *element)));
+			}
+
+			Si::optional<pseudo_value<Storage>> get(address index) const
+			{
+				if (m_tuple)
+				{
+					return m_tuple->elements[static_cast<std::size_t>(index)].copy();
+				}
+				if (m_array->delta)
+				{
+					array_delta::location const found = m_array->delta->locate(index);
+					if (found.value)
+					{
+						return pseudo_value<Storage>(found.value->copy());
+					}
+					index = found.stored_index;
+				}
+				return get_stored_element(*m_array, index);
+			}
+
+		private:
+			basic_array_accessor<Storage> const *m_array;
+			basic_tuple<pseudo_value<Storage>> const *m_tuple;
+			pseudo_value<Storage> const *m_key;
+			address m_length;
+			Si::overflow_or<address> m_element_size;
+			Si::optional<key_bits> m_bits;
+			Si::optional<tag_column<Storage>> m_column;
+			Si::optional<encoded_column<Storage>> m_encoded;
+
+			// The last decoded block of a delta column. Keys are read in order, so each block is decoded once.
+			mutable std::vector<std::uint64_t> m_block;
+			mutable address m_block_begin;
+
+			std::uint64_t encoded_value_at(address index) const
+			{
+				if (m_encoded->encoding != layouts::bitset_encoding::delta)
+				{
+					return m_encoded->value_at(index);
+				}
+				address const block_begin = index - (index % layouts::delta_block_length);
+				if (m_block.empty() || (m_block_begin != block_begin))
+				{
+					m_block.clear();
+					m_encoded->decode_range(
+					    block_begin, (std::min)(block_begin + layouts::delta_block_length, m_encoded->length), m_block);
+					m_block_begin = block_begin;
+				}
+				return m_block[static_cast<std::size_t>(index - block_begin)];
+			}
+		};
+
+		struct scan_options
+		{
+			std::shared_ptr<work_stealing_pool> pool;
+			address parallel_threshold;
+			address morsel_size;
+
+			// indexes that filters use instead of scanning arrays without a delta. They only exist in memory, and a plan
+			// that uses them cannot have setters.
+			std::shared_ptr<bitmap_index_set const> bitmap_indexes;
+
+			// per block bounds that let filters on arrays without a delta skip blocks. Setters widen them.
+			std::shared_ptr<zone_map_set> zone_maps;
+
+			scan_options()
+			    : parallel_threshold(address(1) << 16u)
+			    , morsel_size(address(1) << 14u)
+			{
+			}
+
+			scan_options(std::shared_ptr<work_stealing_pool> pool, address parallel_threshold, address morsel_size)
+			    : pool(std::move(pool))
+			    , parallel_threshold(parallel_threshold)
+			    , morsel_size(morsel_size)
+			{
+			}
+		};
+
+		template <class Storage>
+		void filter_element(pseudo_value<Storage> element, pseudo_value<Storage> const &predicate,
+		                    std::vector<pseudo_value<Storage>> &results)
+		{
+			pseudo_value<Storage> const is_good = execute_closure(predicate, element);
+			if (extract_bool(is_good))
+			{
+				results.emplace_back(std::move(element));
+			}
+		}
+
+		// A predicate that compares bits of the element with a constant. The filter reads only these bits and decodes
+		// only the elements that match.
+		struct equality_filter
+		{
+			key_bits bits;
+			std::uint64_t wanted;
+		};
+
+		template <class Storage>
+		Si::optional<values::value> constant_operand(expressions::expression const &operand,
+		                                             pseudo_value<Storage> const &bound_)
+		{
+			expressions::literal const *const literal_ = Si::try_get_ptr<expressions::literal>(operand.as_variant());
+			if (literal_)
+			{
+				return literal_->value.copy();
+			}
+			values::value const *const simple_bound = Si::try_get_ptr<values::value>(bound_);
+			if (Si::try_get_ptr<expressions::bound>(operand.as_variant()) && simple_bound)
+			{
+				return simple_bound->copy();
+			}
+			return Si::none;
+		}
+
+		// Whether a constant has the same structure as what a key expression with these bits evaluates to, so that
+		// comparing the packed bits means the same as comparing the values.
+		inline bool has_key_shape(expressions::expression const &key, values::value const &constant,
+		                          key_bits const &bits)
+		{
+			if (Si::try_get_ptr<expressions::tuple_at>(key.as_variant()))
+			{
+				return Si::try_get_ptr<values::bit>(constant.as_variant()) != nullptr;
+			}
+			if (!Si::try_get_ptr<expressions::argument>(key.as_variant()) &&
+			    !Si::try_get_ptr<expressions::variant_index>(key.as_variant()))
+			{
+				return false;
+			}
+			values::tuple const *const elements = Si::try_get_ptr<values::tuple>(constant.as_variant());
+			return elements && (elements->elements.size() == bits.value_length) &&
+			       std::all_of(elements->elements.begin(), elements->elements.end(), [](values::value const &element)
+			                   {
+				                   return Si::try_get_ptr<values::bit>(element.as_variant()) != nullptr;
+				               });
+		}
+
+		template <class Storage>
+		Si::optional<equality_filter> find_equality_filter(basic_array_accessor<Storage> const &array,
+		                                                   pseudo_value<Storage> const &predicate)
+		{
+			typedef basic_closure<pseudo_value<Storage>> closure_type;
+			closure_type const *const closure = Si::try_get_ptr<closure_type>(predicate);
+			if (!closure)
+			{
+				return Si::none;
+			}
+			expressions::equals const *const equals_ =
+			    Si::try_get_ptr<expressions::equals>(closure->body->as_variant());
+			if (!equals_)
+			{
+				return Si::none;
+			}
+			expressions::expression const *const sides[2] = {equals_->first.get(), equals_->second.get()};
+			for (std::size_t i = 0; i < 2; ++i)
+			{
+				expressions::expression const &key = *sides[i];
+				Si::optional<values::value> const constant = constant_operand(*sides[1 - i], *closure->bound);
+				if (!constant)
+				{
+					continue;
+				}
+				Si::optional<key_bits> bits = find_key_bits(key, array.element_layout);
+				if (!bits || !has_key_shape(key, *constant, *bits))
+				{
+					continue;
+				}
+				equality_filter result;
+				result.wanted = pack_value(*constant).bits;
+				result.bits = std::move(*bits);
+				return result;
+			}
+			return Si::none;
+		}
+
+		// Appends the elements in [begin, end) of the leaf that the index lists.
+		template <class Storage>
+		void lookup_leaf(tag_column<Storage> const &column, std::uint64_t leaf, address begin, address end,
+		                 std::vector<pseudo_value<Storage>> &results)
+		{
+			if (leaf >= column.element->leaves.size())
+			{
+				return;
+			}
+			std::size_t const chosen = static_cast<std::size_t>(leaf);
+			address first = column.leaf_entries_begin(chosen);
+			address const last = column.leaf_entries_begin(chosen + 1u);
+			address count = last - first;
+			while (count > 0)
+			{
+				address const half = count / 2u;
+				if (column.entry(first + half) < begin)
+				{
+					first += half + 1u;
+					count -= half + 1u;
+				}
+				else
+				{
+					count = half;
+				}
+			}
+			for (; first < last; ++first)
+			{
+				address const found = column.entry(first);
+				if (found >= end)
+				{
+					break;
+				}
+				results.emplace_back(column.get(found));
+			}
+		}
+
+		// Compares the tags of the elements in [begin, end) with a constant. As many tags as fit into 64 bits are read
+		// at once.
+		template <class Storage>
+		void scan_tags(tag_column<Storage> const &column, std::uint64_t wanted, address begin, address end,
+		               std::vector<pseudo_value<Storage>> &results)
+		{
+			assert(column.tag_bits > 0);
+			address const tags_per_read = address(64) / column.tag_bits;
+			std::uint64_t const mask =
+			    (column.tag_bits == 64) ? ~std::uint64_t(0) : ((std::uint64_t(1) << column.tag_bits) - 1u);
+			for (address index = begin; index < end;)
+			{
+				address const count = (std::min)(tags_per_read, end - index);
+				std::uint64_t const tags = read_packed_bits(column.tag_at(index), count * column.tag_bits);
+				for (address i = 0; i < count; ++i)
+				{
+					if (((tags >> ((count - 1u - i) * column.tag_bits)) & mask) == wanted)
+					{
+						results.emplace_back(column.get(index + i));
+					}
+				}
+				index += count;
+			}
+		}
+
+		template <class Storage>
+		void filter_tag_column(tag_column<Storage> const &column, Si::optional<equality_filter> const &equality,
+		                       pseudo_value<Storage> const &predicate, address begin, address end,
+		                       std::vector<pseudo_value<Storage>> &results)
+		{
+			if (!equality || !reads_only_tag(equality->bits, column.tag_bits))
+			{
+				for (address index = begin; index < end; ++index)
+				{
+					filter_element(column.get(index), predicate, results);
+				}
+				return;
+			}
+			bool const whole_tag = (equality->bits.length == column.tag_bits);
+			if (whole_tag && column.indexed)
+			{
+				lookup_leaf(column, equality->wanted, begin, end, results);
+				return;
+			}
+			if (whole_tag && column.sparse && (equality->wanted == 1))
+			{
+				address const last = column.rank(end);
+				for (address position = column.rank(begin); position < last; ++position)
+				{
+					results.emplace_back(column.get_present(position));
+				}
+				return;
+			}
+			if (whole_tag && (column.tag_bits > 0))
+			{
+				scan_tags(column, equality->wanted, begin, end, results);
+				return;
+			}
+			for (address index = begin; index < end; ++index)
+			{
+				if (read_key_bits(column.tag_at(index), equality->bits) == equality->wanted)
+				{
+					results.emplace_back(column.get(index));
+				}
+			}
+		}
+
+		// Decodes the elements in [begin, end) one morsel at a time. A comparison of whole elements with a constant
+		// compares the codes with the code of the constant instead, so only the matching elements are decoded. An
+		// Elias-Fano array is sorted, so the matching elements are found with lower_bound.
+		template <class Storage>
+		void filter_encoded_column(encoded_column<Storage> const &column, Si::optional<equality_filter> const &equality,
+		                           pseudo_value<Storage> const &predicate, address begin, address end,
+		                           std::vector<pseudo_value<Storage>> &results)
+		{
+			bool const whole_element = equality && (equality->bits.length == column.element_bits);
+			if (whole_element && (column.encoding == layouts::bitset_encoding::elias_fano))
+			{
+				values::value const matching = make_bitset_value(equality->wanted, column.element_bits);
+				column.scan_elias_fano((std::max)(begin, column.lower_bound(equality->wanted)), end,
+				                       [&equality, &matching, &results](address, std::uint64_t element)
+				                       {
+					                       if (element != equality->wanted)
+					                       {
+						                       return false;
+					                       }
+					                       results.emplace_back(matching.copy());
+					                       return true;
+					                   });
+				return;
+			}
+			if (whole_element && (column.encoding != layouts::bitset_encoding::delta))
+			{
+				Si::optional<std::uint64_t> const code = column.find_code(equality->wanted);
+				if (!code)
+				{
+					return;
+				}
+				values::value const matching = make_bitset_value(equality->wanted, column.element_bits);
+				column.for_each_code(begin, end, [&code, &matching, &results](address, std::uint64_t found)
+				                     {
+					                     if (found == *code)
+					                     {
+						                     results.emplace_back(matching.copy());
+					                     }
+					                 });
+				return;
+			}
+			std::vector<std::uint64_t> decoded;
+			decoded.reserve(static_cast<std::size_t>(end - begin));
+			column.decode_range(begin, end, decoded);
+			for (std::uint64_t element : decoded)
+			{
+				if (equality)
+				{
+					if (extract_key_bits(element, column.element_bits, equality->bits) == equality->wanted)
+					{
+						results.emplace_back(make_bitset_value(element, column.element_bits));
+					}
+					continue;
+				}
+				filter_element(pseudo_value<Storage>(make_bitset_value(element, column.element_bits)), predicate,
+				               results);
+			}
+		}
+
+		template <class Storage>
+		bool filter_stored_range(basic_array_accessor<Storage> const &array, pseudo_value<Storage> const &predicate,
+		                         address begin, address end, std::vector<pseudo_value<Storage>> &results)
+		{
+			Si::optional<equality_filter> const equality = find_equality_filter(array, predicate);
+			Si::optional<encoded_column<Storage>> const encoded = find_encoded_column(array);
+			if (encoded)
+			{
+				filter_encoded_column(*encoded, equality, predicate, begin, end, results);
+				return true;
 			}
-			values::value const *const simple_argument = Si::try_get_ptr<values::value>(argument_);
-			if (!simple_argument)
+			Si::optional<tag_column<Storage>> const column = find_tag_column(array);
+			if (column)
 			{
-				throw std::logic_error("not implemented");
+				filter_tag_column(*column, equality, predicate, begin, end, results);
+				return true;
 			}
-			values::value const *const simple_bound = Si::try_get_ptr<values::value>(*is_closure->bound);
-			if (!simple_bound)
+			if (equality)
 			{
-				throw std::logic_error("not implemented");
+				Si::overflow_or<address> const element_size = layout_size_in_bits(array.element_layout);
+				for (address index = begin; index < end; ++index)
+				{
+					Si::optional<storage_pointer<Storage>> const element =
+					    element_pointer(array.begin, index, element_size);
+					if (!element)
+					{
+						return false;
+					}
+					if (read_key_bits(*element, equality->bits) == equality->wanted)
+					{
+						results.emplace_back(access_value(*element, array.element_layout));
+					}
+				}
+				return true;
 			}
-			return expressions::execute(*is_closure->body, *simple_argument, *simple_bound);
+			for (address index = begin; index < end; ++index)
+			{
+				Si::optional<pseudo_value<Storage>> element = array_get(array.begin, index, array.element_layout);
+				if (!element)
+				{
+					return false;
+				}
+				filter_element(std::move(*element), predicate, results);
+			}
+			return true;
 		}
 
+		// Filters the stored elements in [begin, end) merged with the changes at these positions.
 		template <class Storage>
-		bool extract_bool(pseudo_value<Storage> const &boolean)
+		bool filter_range(basic_array_accessor<Storage> const &array, pseudo_value<Storage> const &predicate,
+		                  address begin, address end, std::vector<pseudo_value<Storage>> &results)
 		{
-			values::value const *const simple_value = Si::try_get_ptr<values::value>(boolean);
-			if (!simple_value)
+			if (!array.delta)
 			{
-				throw std::logic_error("not implemented");
+				return filter_stored_range(array, predicate, begin, end, results);
 			}
-			values::bit const *const bit = Si::try_get_ptr<values::bit>(simple_value->as_variant());
-			if (!bit)
+			auto change = array.delta->first_change(begin);
+			address index = begin;
+			for (; (change != array.delta->changes().end()) && (change->position < end); ++change)
 			{
-				throw std::logic_error("not implemented");
+				if (!filter_stored_range(array, predicate, index, change->position, results))
+				{
+					return false;
+				}
+				for (values::value const &inserted : change->inserted)
+				{
+					filter_element(pseudo_value<Storage>(inserted.copy()), predicate, results);
+				}
+				index = change->position + 1u;
+				if (change->erased)
+				{
+					continue;
+				}
+				if (change->replacement)
+				{
+					filter_element(pseudo_value<Storage>(change->replacement->copy()), predicate, results);
+					continue;
+				}
+				if (!filter_stored_range(array, predicate, change->position, index, results))
+				{
+					return false;
+				}
 			}
-			return bit->is_set;
+			return filter_stored_range(array, predicate, index, end, results);
 		}
 
-		const address address_size_in_bytes(8);
-
+		// Splits the ranges of elements into morsels that the threads of the pool filter. The results are in the order
+		// of the ranges.
 		template <class Storage>
-		address deserialize_address(storage_pointer<Storage> const &begin)
+		bool parallel_filter(basic_array_accessor<Storage> const &array, pseudo_value<Storage> const &predicate,
+		                     std::vector<std::pair<address, address>> const &ranges, scan_options const &options,
+		                     std::vector<pseudo_value<Storage>> &results)
 		{
-			address result = 0;
-			assert(sizeof(result) == address_size_in_bytes);
-			auto byte_source = begin.storage->read_at(begin.where);
-			for (address i = 0; i < address_size_in_bytes; ++i)
+			address const morsel_size = (std::max)(address(1), options.morsel_size);
+			std::vector<std::pair<address, address>> morsels;
+			for (std::pair<address, address> const &range : ranges)
 			{
-				Si::optional<byte> digit = Si::get(byte_source);
-				if (!digit)
+				for (address begin = range.first; begin < range.second; begin = morsels.back().second)
 				{
-					throw std::invalid_argument("deserialize_address needs more bytes");
+					morsels.emplace_back(begin, begin + (std::min)(morsel_size, range.second - begin));
 				}
-				result |= (*digit << (address_size_in_bytes - 1 - i));
 			}
-			return result;
+			std::vector<std::vector<pseudo_value<Storage>>> morsel_results(morsels.size());
+			std::vector<char> morsel_succeeded(morsels.size(), 0);
+			bool const ran = options.pool->try_run(
+			    morsels.size(), [&array, &predicate, &morsels, &morsel_results, &morsel_succeeded](std::size_t morsel)
+			    {
+				    morsel_succeeded[morsel] = filter_range(array, predicate, morsels[morsel].first,
+				                                            morsels[morsel].second, morsel_results[morsel]);
+				});
+			if (!ran)
+			{
+				for (std::pair<address, address> const &range : ranges)
+				{
+					if (!filter_range(array, predicate, range.first, range.second, results))
+					{
+						return false;
+					}
+				}
+				return true;
+			}
+			if (std::find(morsel_succeeded.begin(), morsel_succeeded.end(), 0) != morsel_succeeded.end())
+			{
+				return false;
+			}
+			for (std::vector<pseudo_value<Storage>> &morsel : morsel_results)
+			{
+				std::move(morsel.begin(), morsel.end(), std::back_inserter(results));
+			}
+			return true;
 		}
 
+		// Reads the elements of an array without a delta that the bitmap index of a filter lists. Returns false if
+		// there is no index for the filter.
 		template <class Storage>
-		address array_length(storage_pointer<Storage> const &array_begin)
+		bool filter_by_bitmap(basic_array_accessor<Storage> const &array, pseudo_value<Storage> const &predicate,
+		                      bitmap_index_set const &indexes, address length,
+		                      std::vector<pseudo_value<Storage>> &results)
 		{
-			address length = deserialize_address(array_begin);
-			return length;
+			if (array.delta)
+			{
+				return false;
+			}
+			Si::optional<equality_filter> const equality = find_equality_filter(array, predicate);
+			if (!equality)
+			{
+				return false;
+			}
+			bitmap_index const *const index = indexes.find(array.begin.where, equality->bits.ranges);
+			if (!index || (index->length != length))
+			{
+				return false;
+			}
+			roaring_bitmap const *const rows = index->find(equality->wanted);
+			if (!rows)
+			{
+				return true;
+			}
+			rows->for_each(0, length, [&array, &results](address row)
+			               {
+				               Si::optional<pseudo_value<Storage>> element = get_stored_element(array, row);
+				               if (!element)
+				               {
+					               throw std::invalid_argument("filter_by_bitmap found a row beyond the address space");
+				               }
+				               results.emplace_back(std::move(*element));
+				           });
+			return true;
 		}
 
+		// The ranges of the blocks whose zones may contain the constant of an equality filter, adjacent blocks merged.
+		// Returns none if there is no zone map of the compared field that covers the array or if no block can be
+		// skipped, so that the ordinary scan can still split the array between threads.
 		template <class Storage>
-		pseudo_value<Storage> access_value(storage_pointer<Storage> const &element_begin,
-		                                   layouts::layout const &element_layout)
+		Si::optional<std::vector<std::pair<address, address>>>
+		find_zone_ranges(basic_array_accessor<Storage> const &array, pseudo_value<Storage> const &predicate,
+		                 zone_map_set const &maps, address length)
 		{
-			return Si::visit<pseudo_value<Storage>>(
-			    element_layout.as_variant(),
-			    [](layouts::unit) -> pseudo_value<Storage>
-			    {
-				    throw std::logic_error("not implemented");
-				},
-			    [](layouts::tuple const &) -> pseudo_value<Storage>
-			    {
-				    throw std::logic_error("not implemented");
-				},
-			    [](layouts::array const &) -> pseudo_value<Storage>
-			    {
-				    throw std::logic_error("not implemented");
-				},
-			    [&element_begin](layouts::bitset const &bitset_) -> pseudo_value<Storage>
-			    {
-				    std::vector<values::value> bits;
-				    bits.reserve(bitset_.length);
-				    assert(element_begin.where % 8 == 0);
-				    auto byte_reader = element_begin.storage->read_at(element_begin.where / address(8));
-				    auto bit_reader = make_byte_to_bit_source(byte_reader);
-				    for (address i = 0; i < bitset_.length; ++i)
-				    {
-					    Si::optional<values::bit> const bit_read = Si::get(bit_reader);
-					    if (!bit_read)
-					    {
-						    throw std::logic_error("not implemented");
-					    }
-					    bits.emplace_back(*bit_read);
-				    }
-				    return pseudo_value<Storage>(values::value(values::tuple(std::move(bits))));
-				},
-			    [](layouts::variant const &) -> pseudo_value<Storage>
-			    {
-				    throw std::logic_error("not implemented");
-				});
+			if (array.delta)
+			{
+				return Si::none;
+			}
+			zone_map const *const zones = maps.find(array.begin.where);
+			if (!zones || (zones->length != length))
+			{
+				return Si::none;
+			}
+			Si::optional<equality_filter> const equality = find_equality_filter(array, predicate);
+			if (!equality)
+			{
+				return Si::none;
+			}
+			Si::optional<std::size_t> const field = zones->find_field(equality->bits.ranges);
+			if (!field)
+			{
+				return Si::none;
+			}
+			std::vector<std::pair<address, address>> ranges;
+			for (address block = 0; block < zones->block_count(); ++block)
+			{
+				if (!zones->at(block, *field).may_contain(equality->wanted))
+				{
+					continue;
+				}
+				address const begin = block * zones->block_length;
+				address const end = (std::min)(length, begin + zones->block_length);
+				if (!ranges.empty() && (ranges.back().second == begin))
+				{
+					ranges.back().second = end;
+				}
+				else
+				{
+					ranges.emplace_back(begin, end);
+				}
+			}
+			if ((ranges.size() == 1) && (ranges.front().first == 0) && (ranges.front().second == length))
+			{
+				return Si::none;
+			}
+			return std::move(ranges);
 		}
 
+		// Adds the fields of an element that a setter wrote to the zones of its block, so that filters for its new
+		// value do not skip the block.
 		template <class Storage>
-		Si::optional<pseudo_value<Storage>> array_get(storage_pointer<Storage> const &array_begin, address index,
-		                                              layouts::layout const &element)
+		void widen_zones(basic_array_accessor<Storage> const &array, address index, values::value const &element,
+		                 zone_map_set &maps)
 		{
-			Si::overflow_or<address> first_element = array_begin.where + (address_size_in_bytes * address(8));
-			Si::overflow_or<address> element_size_in_bits = layout_size_in_bits(element);
-			Si::overflow_or<address> wanted_element = first_element + (element_size_in_bits * index);
-			if (wanted_element.is_overflow())
+			zone_map *const zones = maps.find(array.begin.where);
+			if (!zones || zones->fields.empty() || (index >= zones->length))
 			{
-				return Si::none;
+				return;
+			}
+			bit_buffer encoded;
+			layouts::serialize(encoded, element, array.element_layout);
+			std::vector<std::uint64_t> values(zones->fields.size());
+			for (std::size_t i = 0; i < values.size(); ++i)
+			{
+				bit_range const field = zones->fields[i];
+				values[i] = encoded.read_bits(field.offset, static_cast<std::size_t>(field.length));
 			}
-			return access_value(storage_pointer<Storage>(*array_begin.storage, *wanted_element.value()), element);
+			zones->widen(index, values.data());
 		}
 
 		template <class Storage>
 		Si::optional<pseudo_value<Storage>> run_filter(pseudo_value<Storage> const &container,
-		                                               pseudo_value<Storage> const &predicate)
+		                                               pseudo_value<Storage> const &predicate,
+		                                               scan_options const &options)
 		{
 			return Si::visit<Si::optional<pseudo_value<Storage>>>(
 			    container,
-			    [&predicate](basic_array_accessor<Storage> const &array) -> Si::optional<pseudo_value<Storage>>
+			    [&predicate, &options](basic_array_accessor<Storage> const &array)
+			        -> Si::optional<pseudo_value<Storage>>
 			    {
 				    std::vector<pseudo_value<Storage>> results;
-				    for (address index = 0, length = array_length(array.begin); index < length; ++index)
+				    address const length = array_length(array.begin);
+				    if (options.bitmap_indexes &&
+				        filter_by_bitmap(array, predicate, *options.bitmap_indexes, length, results))
+				    {
+					    return pseudo_value<Storage>(basic_tuple<pseudo_value<Storage>>(std::move(results)));
+				    }
+				    Si::optional<std::vector<std::pair<address, address>>> zone_ranges;
+				    if (options.zone_maps)
+				    {
+					    zone_ranges = find_zone_ranges(array, predicate, *options.zone_maps, length);
+				    }
+				    if (zone_ranges)
+				    {
+					    address surviving = 0;
+					    for (std::pair<address, address> const &range : *zone_ranges)
+					    {
+						    surviving += range.second - range.first;
+					    }
+					    if (options.pool && (surviving >= options.parallel_threshold))
+					    {
+						    if (!parallel_filter(array, predicate, *zone_ranges, options, results))
+						    {
+							    return Si::none;
+						    }
+						    return pseudo_value<Storage>(basic_tuple<pseudo_value<Storage>>(std::move(results)));
+					    }
+					    for (std::pair<address, address> const &range : *zone_ranges)
+					    {
+						    if (!filter_stored_range(array, predicate, range.first, range.second, results))
+						    {
+							    return Si::none;
+						    }
+					    }
+					    return pseudo_value<Storage>(basic_tuple<pseudo_value<Storage>>(std::move(results)));
+				    }
+				    if (options.pool && (length >= options.parallel_threshold))
 				    {
-					    Si::optional<pseudo_value<Storage>> element =
-					        array_get(array.begin, index, array.element_layout);
-					    if (!element)
+					    std::vector<std::pair<address, address>> const whole(1, std::make_pair(address(0), length));
+					    if (!parallel_filter(array, predicate, whole, options, results))
 					    {
 						    return Si::none;
 					    }
-					    pseudo_value<Storage> const is_good = execute_closure(predicate, *element);
-					    if (!extract_bool(is_good))
+				    }
+				    else if (!filter_range(array, predicate, 0, length, results))
+				    {
+					    return Si::none;
+				    }
+				    if (array.delta)
+				    {
+					    // elements appended after the last stored one
+					    auto const appended = array.delta->first_change(length);
+					    if (appended != array.delta->changes().end())
 					    {
-						    continue;
+						    for (values::value const &inserted : appended->inserted)
+						    {
+							    filter_element(pseudo_value<Storage>(inserted.copy()), predicate, results);
+						    }
 					    }
-					    results.emplace_back(std::move(*element));
 				    }
 				    return pseudo_value<Storage>(basic_tuple<pseudo_value<Storage>>(std::move(results)));
 				},
@@ -447,10 +2209,213 @@ namespace staticdb
 				});
 		}
 
+		template <class Storage>
+		Si::optional<pseudo_value<Storage>> run_join(pseudo_value<Storage> const &left, pseudo_value<Storage> const &right,
+		                                             pseudo_value<Storage> const &left_key,
+		                                             pseudo_value<Storage> const &right_key)
+		{
+			key_reader<Storage> const left_keys(left, left_key);
+			key_reader<Storage> const right_keys(right, right_key);
+			bool const build_left = (left_keys.length() <= right_keys.length());
+			key_reader<Storage> const &build = build_left ? left_keys : right_keys;
+			key_reader<Storage> const &probe = build_left ? right_keys : left_keys;
+
+			std::unordered_multimap<packed_key, address, packed_key_hash> table;
+			table.reserve(static_cast<std::size_t>(build.length()));
+			for (address index = 0; index < build.length(); ++index)
+			{
+				Si::optional<packed_key> const key = build.read(index);
+				if (!key)
+				{
+					return Si::none;
+				}
+				table.emplace(*key, index);
+			}
+
+			std::vector<pseudo_value<Storage>> results;
+			std::vector<address> matches;
+			for (address index = 0; index < probe.length(); ++index)
+			{
+				Si::optional<packed_key> const key = probe.read(index);
+				if (!key)
+				{
+					return Si::none;
+				}
+				auto const found = table.equal_range(*key);
+				if (found.first == found.second)
+				{
+					continue;
+				}
+				matches.clear();
+				for (auto i = found.first; i != found.second; ++i)
+				{
+					matches.emplace_back(i->second);
+				}
+				std::sort(matches.begin(), matches.end());
+				Si::optional<pseudo_value<Storage>> const probe_element = probe.get(index);
+				if (!probe_element)
+				{
+					return Si::none;
+				}
+				for (address match : matches)
+				{
+					Si::optional<pseudo_value<Storage>> build_element = build.get(match);
+					if (!build_element)
+					{
+						return Si::none;
+					}
+					basic_tuple<pseudo_value<Storage>> pair;
+					pair.elements.reserve(2);
+					pair.elements.emplace_back(build_left ? std::move(*build_element) : probe_element->copy());
+					pair.elements.emplace_back(build_left ? probe_element->copy() : std::move(*build_element));
+					results.emplace_back(std::move(pair));
+				}
+			}
+			return pseudo_value<Storage>(basic_tuple<pseudo_value<Storage>>(std::move(results)));
+		}
+
+		template <class Storage>
+		Si::optional<pseudo_value<Storage>> run_order_by(pseudo_value<Storage> const &input,
+		                                                 pseudo_value<Storage> const &key,
+		                                                 Si::optional<address> limit)
+		{
+			key_reader<Storage> const keys(input, key);
+			std::vector<sort_entry> entries;
+			entries.reserve(static_cast<std::size_t>(keys.length()));
+			address key_bits = 0;
+			for (address index = 0; index < keys.length(); ++index)
+			{
+				Si::optional<packed_key> const element_key = keys.read(index);
+				if (!element_key)
+				{
+					return Si::none;
+				}
+				entries.emplace_back(element_key->bits, index);
+				key_bits = (std::max)(key_bits, element_key->length);
+			}
+
+			if (limit && (*limit < entries.size()))
+			{
+				top_k(entries, static_cast<std::size_t>(*limit));
+			}
+			else
+			{
+				radix_sort(entries, key_bits);
+			}
+
+			std::vector<pseudo_value<Storage>> results;
+			results.reserve(entries.size());
+			for (sort_entry const &entry : entries)
+			{
+				Si::optional<pseudo_value<Storage>> element = keys.get(entry.index);
+				if (!element)
+				{
+					return Si::none;
+				}
+				results.emplace_back(std::move(*element));
+			}
+			return pseudo_value<Storage>(basic_tuple<pseudo_value<Storage>>(std::move(results)));
+		}
+
+		struct aggregate_state
+		{
+			address first_index;
+			Si::overflow_or<std::uint64_t> result;
+
+			aggregate_state(address first_index, std::uint64_t result)
+			    : first_index(first_index)
+			    , result(result)
+			{
+			}
+		};
+
+		template <class Storage>
+		Si::optional<pseudo_value<Storage>> run_group_by(pseudo_value<Storage> const &input,
+		                                                 pseudo_value<Storage> const &key,
+		                                                 expressions::aggregate_function function,
+		                                                 pseudo_value<Storage> const *value)
+		{
+			key_reader<Storage> const keys(input, key);
+			std::unique_ptr<key_reader<Storage>> values_;
+			if (function != expressions::aggregate_function::count)
+			{
+				if (!value)
+				{
+					throw std::invalid_argument("group_by needs a value for every aggregate except count");
+				}
+				values_ = Si::make_unique<key_reader<Storage>>(input, *value);
+			}
+
+			packed_key_table<aggregate_state> groups;
+			for (address index = 0; index < keys.length(); ++index)
+			{
+				Si::optional<packed_key> const element_key = keys.read(index);
+				if (!element_key)
+				{
+					return Si::none;
+				}
+				std::uint64_t element_value = 1;
+				if (values_)
+				{
+					Si::optional<packed_key> const read = values_->read(index);
+					if (!read)
+					{
+						return Si::none;
+					}
+					element_value = read->bits;
+				}
+				std::pair<aggregate_state *, bool> const group =
+				    groups.insert(*element_key, aggregate_state(index, element_value));
+				if (group.second)
+				{
+					continue;
+				}
+				Si::overflow_or<std::uint64_t> &result = group.first->result;
+				switch (function)
+				{
+				case expressions::aggregate_function::count:
+				case expressions::aggregate_function::sum:
+					result = result + element_value;
+					break;
+
+				case expressions::aggregate_function::min:
+					result = (std::min)(*result.value(), element_value);
+					break;
+
+				case expressions::aggregate_function::max:
+					result = (std::max)(*result.value(), element_value);
+					break;
+				}
+			}
+
+			std::vector<pseudo_value<Storage>> results;
+			results.reserve(groups.entries().size());
+			for (auto const &group : groups.entries())
+			{
+				if (group.second.result.is_overflow())
+				{
+					return Si::none;
+				}
+				Si::optional<pseudo_value<Storage>> const representative = keys.get(group.second.first_index);
+				if (!representative)
+				{
+					return Si::none;
+				}
+				basic_tuple<pseudo_value<Storage>> pair;
+				pair.elements.reserve(2);
+				pair.elements.emplace_back(execute_closure(key, *representative));
+				pair.elements.emplace_back(
+				    values::value(values::make_unsigned_integer(*group.second.result.value())));
+				results.emplace_back(std::move(pair));
+			}
+			return pseudo_value<Storage>(basic_tuple<pseudo_value<Storage>>(std::move(results)));
+		}
+
 		template <class Storage>
 		Si::optional<pseudo_value<Storage>> execute(expressions::expression const &program,
 		                                            pseudo_value<Storage> const &argument_,
-		                                            pseudo_value<Storage> const &bound_)
+		                                            pseudo_value<Storage> const &bound_,
+		                                            scan_options const &options)
 		{
 			typedef pseudo_value<Storage> value_type;
 			return Si::visit<Si::optional<value_type>>(
@@ -467,13 +2432,13 @@ namespace staticdb
 			    {
 				    return bound_.copy();
 				},
-			    [&argument_, &bound_](expressions::make_tuple const &make_tuple_) -> Si::optional<value_type>
+			    [&argument_, &bound_, &options](expressions::make_tuple const &make_tuple_) -> Si::optional<value_type>
 			    {
 				    basic_tuple<value_type> result;
 				    result.elements.reserve(make_tuple_.elements.size());
 				    for (expressions::expression const &element : make_tuple_.elements)
 				    {
-					    Si::optional<value_type> evaluated_element = execute(element, argument_, bound_);
+					    Si::optional<value_type> evaluated_element = execute(element, argument_, bound_, options);
 					    if (!evaluated_element)
 					    {
 						    return Si::none;
@@ -482,14 +2447,14 @@ namespace staticdb
 				    }
 				    return value_type(std::move(result));
 				},
-			    [&argument_, &bound_](expressions::tuple_at const &tuple_at_) -> Si::optional<value_type>
+			    [&argument_, &bound_, &options](expressions::tuple_at const &tuple_at_) -> Si::optional<value_type>
 			    {
-				    Si::optional<value_type> const tuple_ = execute(*tuple_at_.tuple, argument_, bound_);
+				    Si::optional<value_type> const tuple_ = execute(*tuple_at_.tuple, argument_, bound_, options);
 				    if (!tuple_)
 				    {
 					    return Si::none;
 				    }
-				    Si::optional<value_type> const index = execute(*tuple_at_.index, argument_, bound_);
+				    Si::optional<value_type> const index = execute(*tuple_at_.index, argument_, bound_, options);
 				    if (!index)
 				    {
 					    return Si::none;
@@ -501,11 +2466,11 @@ namespace staticdb
 			    {
 				    throw std::logic_error("not implemented");
 				},
-			    [&argument_, &bound_](expressions::lambda const &lambda_) -> Si::optional<value_type>
+			    [&argument_, &bound_, &options](expressions::lambda const &lambda_) -> Si::optional<value_type>
 			    {
 				    basic_closure<value_type> closure;
 				    closure.body = Si::to_unique(lambda_.body->copy());
-				    Si::optional<value_type> bound = execute(*lambda_.bound, argument_, bound_);
+				    Si::optional<value_type> bound = execute(*lambda_.bound, argument_, bound_, options);
 				    if (!bound)
 				    {
 					    return Si::none;
@@ -517,23 +2482,113 @@ namespace staticdb
 			    {
 				    throw std::logic_error("not implemented");
 				},
-			    [&argument_, &bound_](expressions::filter const &filter_) -> Si::optional<value_type>
+			    [&argument_, &bound_, &options](expressions::filter const &filter_) -> Si::optional<value_type>
 			    {
-				    Si::optional<value_type> const input = execute(*filter_.input, argument_, bound_);
+				    Si::optional<value_type> const input = execute(*filter_.input, argument_, bound_, options);
 				    if (!input)
 				    {
 					    return Si::none;
 				    }
-				    Si::optional<value_type> const predicate = execute(*filter_.predicate, argument_, bound_);
+				    Si::optional<value_type> const predicate = execute(*filter_.predicate, argument_, bound_, options);
 				    if (!predicate)
 				    {
 					    return Si::none;
 				    }
-				    return run_filter(*input, *predicate);
+				    return run_filter(*input, *predicate, options);
 				},
 			    [](expressions::equals const &) -> Si::optional<value_type>
 			    {
 				    throw std::logic_error("not implemented");
+				},
+			    [&argument_, &bound_, &options](expressions::join const &join_) -> Si::optional<value_type>
+			    {
+				    Si::optional<value_type> const left = execute(*join_.left, argument_, bound_, options);
+				    if (!left)
+				    {
+					    return Si::none;
+				    }
+				    Si::optional<value_type> const right = execute(*join_.right, argument_, bound_, options);
+				    if (!right)
+				    {
+					    return Si::none;
+				    }
+				    Si::optional<value_type> const left_key = execute(*join_.left_key, argument_, bound_, options);
+				    if (!left_key)
+				    {
+					    return Si::none;
+				    }
+				    Si::optional<value_type> const right_key = execute(*join_.right_key, argument_, bound_, options);
+				    if (!right_key)
+				    {
+					    return Si::none;
+				    }
+				    return run_join(*left, *right, *left_key, *right_key);
+				},
+			    [&argument_, &bound_, &options](expressions::order_by const &order_by_) -> Si::optional<value_type>
+			    {
+				    Si::optional<value_type> const input = execute(*order_by_.input, argument_, bound_, options);
+				    if (!input)
+				    {
+					    return Si::none;
+				    }
+				    Si::optional<value_type> const key = execute(*order_by_.key, argument_, bound_, options);
+				    if (!key)
+				    {
+					    return Si::none;
+				    }
+				    Si::optional<address> limit;
+				    if (order_by_.limit)
+				    {
+					    Si::optional<value_type> const limit_value =
+					        execute(*order_by_.limit, argument_, bound_, options);
+					    if (!limit_value)
+					    {
+						    return Si::none;
+					    }
+					    limit = extract_address(*limit_value);
+				    }
+				    return run_order_by(*input, *key, limit);
+				},
+			    [&argument_, &bound_, &options](expressions::group_by const &group_by_) -> Si::optional<value_type>
+			    {
+				    Si::optional<value_type> const input = execute(*group_by_.input, argument_, bound_, options);
+				    if (!input)
+				    {
+					    return Si::none;
+				    }
+				    Si::optional<value_type> const key = execute(*group_by_.key, argument_, bound_, options);
+				    if (!key)
+				    {
+					    return Si::none;
+				    }
+				    Si::optional<value_type> value;
+				    if (group_by_.value)
+				    {
+					    value = execute(*group_by_.value, argument_, bound_, options);
+					    if (!value)
+					    {
+						    return Si::none;
+					    }
+				    }
+				    return run_group_by(*input, *key, group_by_.function, value ? &*value : nullptr);
+				},
+			    [&argument_, &bound_, &options](expressions::variant_index const &variant_index_)
+			        -> Si::optional<value_type>
+			    {
+				    Si::optional<value_type> const variant_ =
+				        execute(*variant_index_.variant, argument_, bound_, options);
+				    if (!variant_)
+				    {
+					    return Si::none;
+				    }
+				    values::value const simple_variant = reduce_value(*variant_);
+				    values::variant const *const is_variant =
+				        Si::try_get_ptr<values::variant>(simple_variant.as_variant());
+				    if (!is_variant)
+				    {
+					    throw std::invalid_argument("variant_index was called with a non-variant argument");
+				    }
+				    return value_type(values::value(values::make_unsigned_integer<std::uint64_t>(is_variant->which)));
 				});
 		}
 	}
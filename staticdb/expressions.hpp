@@ -308,12 +308,207 @@ namespace staticdb
 			SILICIUM_DISABLE_COPY(basic_equals)
 		};
 
+		// The index of the possibility that a variant value holds.
+		template <class Expression>
+		struct basic_variant_index
+		{
+			std::unique_ptr<Expression> variant;
+
+			explicit basic_variant_index(std::unique_ptr<Expression> variant)
+			    : variant(std::move(variant))
+			{
+			}
+
+			basic_variant_index copy() const
+			{
+				return basic_variant_index(Si::to_unique(variant->copy()));
+			}
+
+#if SILICIUM_COMPILER_GENERATES_MOVES
+			SILICIUM_DEFAULT_MOVE(basic_variant_index)
+#else
+			basic_variant_index(basic_variant_index &&other) BOOST_NOEXCEPT : variant(std::move(other.variant))
+			{
+			}
+
+			basic_variant_index &operator=(basic_variant_index &&other) BOOST_NOEXCEPT
+			{
+				variant = std::move(other.variant);
+				return *this;
+			}
+#endif
+			SILICIUM_DISABLE_COPY(basic_variant_index)
+		};
+
+		template <class Expression>
+		struct basic_join
+		{
+			std::unique_ptr<Expression> left;
+			std::unique_ptr<Expression> right;
+			std::unique_ptr<Expression> left_key;
+			std::unique_ptr<Expression> right_key;
+
+			explicit basic_join(std::unique_ptr<Expression> left, std::unique_ptr<Expression> right,
+			                    std::unique_ptr<Expression> left_key, std::unique_ptr<Expression> right_key)
+			    : left(std::move(left))
+			    , right(std::move(right))
+			    , left_key(std::move(left_key))
+			    , right_key(std::move(right_key))
+			{
+			}
+
+			basic_join copy() const
+			{
+				return basic_join(Si::to_unique(left->copy()), Si::to_unique(right->copy()),
+				                  Si::to_unique(left_key->copy()), Si::to_unique(right_key->copy()));
+			}
+
+#if SILICIUM_COMPILER_GENERATES_MOVES
+			SILICIUM_DEFAULT_MOVE(basic_join)
+#else
+			basic_join(basic_join &&other) BOOST_NOEXCEPT : left(std::move(other.left)),
+			                                                right(std::move(other.right)),
+			                                                left_key(std::move(other.left_key)),
+			                                                right_key(std::move(other.right_key))
+			{
+			}
+
+			basic_join &operator=(basic_join &&other) BOOST_NOEXCEPT
+			{
+				left = std::move(other.left);
+				right = std::move(other.right);
+				left_key = std::move(other.left_key);
+				right_key = std::move(other.right_key);
+				return *this;
+			}
+#endif
+			SILICIUM_DISABLE_COPY(basic_join)
+		};
+
+		template <class Expression>
+		struct basic_order_by
+		{
+			std::unique_ptr<Expression> input;
+			std::unique_ptr<Expression> key;
+			std::unique_ptr<Expression> limit;
+
+			explicit basic_order_by(std::unique_ptr<Expression> input, std::unique_ptr<Expression> key)
+			    : input(std::move(input))
+			    , key(std::move(key))
+			{
+			}
+
+			explicit basic_order_by(std::unique_ptr<Expression> input, std::unique_ptr<Expression> key,
+			                        std::unique_ptr<Expression> limit)
+			    : input(std::move(input))
+			    , key(std::move(key))
+			    , limit(std::move(limit))
+			{
+			}
+
+			basic_order_by copy() const
+			{
+				if (!limit)
+				{
+					return basic_order_by(Si::to_unique(input->copy()), Si::to_unique(key->copy()));
+				}
+				return basic_order_by(Si::to_unique(input->copy()), Si::to_unique(key->copy()),
+				                      Si::to_unique(limit->copy()));
+			}
+
+#if SILICIUM_COMPILER_GENERATES_MOVES
+			SILICIUM_DEFAULT_MOVE(basic_order_by)
+#else
+			basic_order_by(basic_order_by &&other) BOOST_NOEXCEPT : input(std::move(other.input)),
+			                                                        key(std::move(other.key)),
+			                                                        limit(std::move(other.limit))
+			{
+			}
+
+			basic_order_by &operator=(basic_order_by &&other) BOOST_NOEXCEPT
+			{
+				input = std::move(other.input);
+				key = std::move(other.key);
+				limit = std::move(other.limit);
+				return *this;
+			}
+#endif
+			SILICIUM_DISABLE_COPY(basic_order_by)
+		};
+
+		enum class aggregate_function
+		{
+			count,
+			sum,
+			min,
+			max
+		};
+
+		template <class Expression>
+		struct basic_group_by
+		{
+			std::unique_ptr<Expression> input;
+			std::unique_ptr<Expression> key;
+			aggregate_function function;
+			std::unique_ptr<Expression> value;
+
+			explicit basic_group_by(std::unique_ptr<Expression> input, std::unique_ptr<Expression> key,
+			                        aggregate_function function)
+			    : input(std::move(input))
+			    , key(std::move(key))
+			    , function(function)
+			{
+			}
+
+			explicit basic_group_by(std::unique_ptr<Expression> input, std::unique_ptr<Expression> key,
+			                        aggregate_function function, std::unique_ptr<Expression> value)
+			    : input(std::move(input))
+			    , key(std::move(key))
+			    , function(function)
+			    , value(std::move(value))
+			{
+			}
+
+			basic_group_by copy() const
+			{
+				if (!value)
+				{
+					return basic_group_by(Si::to_unique(input->copy()), Si::to_unique(key->copy()), function);
+				}
+				return basic_group_by(Si::to_unique(input->copy()), Si::to_unique(key->copy()), function,
+				                      Si::to_unique(value->copy()));
+			}
+
+#if SILICIUM_COMPILER_GENERATES_MOVES
+			SILICIUM_DEFAULT_MOVE(basic_group_by)
+#else
+			basic_group_by(basic_group_by &&other) BOOST_NOEXCEPT : input(std::move(other.input)),
+			                                                        key(std::move(other.key)),
+			                                                        function(other.function),
+			                                                        value(std::move(other.value))
+			{
+			}
+
+			basic_group_by &operator=(basic_group_by &&other) BOOST_NOEXCEPT
+			{
+				input = std::move(other.input);
+				key = std::move(other.key);
+				function = other.function;
+				value = std::move(other.value);
+				return *this;
+			}
+#endif
+			SILICIUM_DISABLE_COPY(basic_group_by)
+		};
+
 		template <class Expression>
 		struct make_expression_type
 		{
 			typedef Si::variant<literal, argument, bound, basic_make_tuple<Expression>, basic_tuple_at<Expression>,
 			                    basic_branch<Expression>, basic_lambda<Expression>, basic_call<Expression>,
-			                    basic_filter<Expression>, basic_equals<Expression>> type;
+			                    basic_filter<Expression>, basic_equals<Expression>, basic_join<Expression>,
+			                    basic_order_by<Expression>, basic_group_by<Expression>,
+			                    basic_variant_index<Expression>> type;
 		};
 
 		struct expression : make_expression_type<expression>::type
@@ -364,6 +559,10 @@ namespace staticdb
 		typedef basic_call<expression> call;
 		typedef basic_filter<expression> filter;
 		typedef basic_equals<expression> equals;
+		typedef basic_join<expression> join;
+		typedef basic_order_by<expression> order_by;
+		typedef basic_group_by<expression> group_by;
+		typedef basic_variant_index<expression> variant_index;
 
 		inline tuple_at make_tuple_at(expression tuple, std::size_t index)
 		{
@@ -446,6 +645,28 @@ namespace staticdb
 				    values::value const second = execute(*equals_.second, argument_, bound_);
 				    bool const equal = (first == second);
 				    return values::value(values::bit(equal));
+				},
+			    [](join const &) -> values::value
+			    {
+				    throw std::logic_error("not implemented");
+				},
+			    [](order_by const &) -> values::value
+			    {
+				    throw std::logic_error("not implemented");
+				},
+			    [](group_by const &) -> values::value
+			    {
+				    throw std::logic_error("not implemented");
+				},
+			    [&argument_, &bound_](variant_index const &variant_index_) -> values::value
+			    {
+				    values::value const variant_ = execute(*variant_index_.variant, argument_, bound_);
+				    values::variant const *const is_variant = Si::try_get_ptr<values::variant>(variant_.as_variant());
+				    if (!is_variant)
+				    {
+					    throw std::invalid_argument("variant_index was called with a non-variant argument");
+				    }
+				    return values::value(values::make_unsigned_integer<std::uint64_t>(is_variant->which));
 				});
 		}
 	}
@@ -0,0 +1,676 @@
+#ifndef STATICDB_FILE_FORMAT_HPP
+#define STATICDB_FILE_FORMAT_HPP
+
+#include <staticdb/plan.hpp>
+
+namespace staticdb
+{
+	// A database file starts with a header that describes it:
+	//
+	//   "STATICDB", version (u32), section count (u32), checksum (u64),
+	//   per section: kind (u32), tag (u32), offset in bytes (u64), length in bytes (u64)
+	//
+	// followed by the sections. Every section begins at a multiple of section_alignment, so it can be mapped into
+	// memory directly. The type section holds the serialized root type, the layout section the layout that the
+	// data is stored in, and the root section the bit offsets of the members of a tuple root in the data section.
+	// Index and plan sections are opaque to this format; their tag tells them apart. An index section can hold a zone
+	// map, see zone_map_content. The checksum covers the section
+	// table and the type, layout and root sections. All integers are big endian.
+	namespace file_format
+	{
+		std::uint32_t const current_version = 1;
+		address const section_alignment = 4096;
+		std::size_t const fixed_header_size = 24;
+		std::size_t const section_entry_size = 24;
+		std::size_t const max_nesting = 1000;
+
+		enum class section_kind : std::uint32_t
+		{
+			type = 1,
+			layout = 2,
+			root = 3,
+			data = 4,
+			index = 5,
+			plan = 6
+		};
+
+		struct section
+		{
+			section_kind kind;
+			std::uint32_t tag;
+			address offset;
+			address length;
+		};
+
+		struct index_content
+		{
+			std::uint32_t tag;
+			std::vector<byte> content;
+		};
+
+		struct byte_reader
+		{
+			explicit byte_reader(Si::iterator_range<byte const *> input)
+			    : m_next(input.begin())
+			    , m_end(input.end())
+			{
+			}
+
+			std::uint64_t read_integer(std::size_t size)
+			{
+				if (static_cast<std::size_t>(m_end - m_next) < size)
+				{
+					throw std::invalid_argument("staticdb file is truncated");
+				}
+				std::uint64_t result = 0;
+				for (std::size_t i = 0; i < size; ++i)
+				{
+					result = (result << 8u) | *m_next;
+					++m_next;
+				}
+				return result;
+			}
+
+			std::uint32_t read_u32()
+			{
+				return static_cast<std::uint32_t>(read_integer(4));
+			}
+
+			std::uint64_t read_u64()
+			{
+				return read_integer(8);
+			}
+
+			std::size_t read_count()
+			{
+				std::uint64_t const count = read_u64();
+				if (count > static_cast<std::uint64_t>(m_end - m_next))
+				{
+					throw std::invalid_argument("staticdb file has an element count larger than the section");
+				}
+				return static_cast<std::size_t>(count);
+			}
+
+			bool empty() const
+			{
+				return m_next == m_end;
+			}
+
+		private:
+			byte const *m_next;
+			byte const *m_end;
+		};
+
+		inline void append_integer(std::vector<byte> &output, std::uint64_t value, std::size_t size)
+		{
+			for (std::size_t i = size; i > 0; --i)
+			{
+				output.emplace_back(static_cast<byte>(value >> ((i - 1u) * 8u)));
+			}
+		}
+
+		inline std::uint64_t checksum(std::uint64_t seed, std::vector<byte> const &content)
+		{
+			std::uint64_t result = execution::mix_bits(seed ^ content.size());
+			for (byte element : content)
+			{
+				result = execution::mix_bits(result ^ element);
+			}
+			return result;
+		}
+
+		inline std::uint64_t schema_hash(std::vector<byte> const &type_section, std::vector<byte> const &layout_section)
+		{
+			return checksum(checksum(0, type_section), layout_section);
+		}
+
+		inline void serialize_type(std::vector<byte> &output, types::type const &serialized)
+		{
+			Si::visit<void>(serialized.as_variant(),
+			                [&output](types::unit)
+			                {
+				                output.emplace_back(0);
+				            },
+			                [&output](types::bit)
+			                {
+				                output.emplace_back(1);
+				            },
+			                [&output](types::function)
+			                {
+				                output.emplace_back(2);
+				            },
+			                [&output](types::tuple const &tuple_)
+			                {
+				                output.emplace_back(3);
+				                append_integer(output, tuple_.elements.size(), 8);
+				                for (types::type const &element : tuple_.elements)
+				                {
+					                serialize_type(output, element);
+				                }
+				            },
+			                [&output](types::variant const &variant_)
+			                {
+				                output.emplace_back(4);
+				                append_integer(output, variant_.possibilities.size(), 8);
+				                for (types::type const &possibility : variant_.possibilities)
+				                {
+					                serialize_type(output, possibility);
+				                }
+				            },
+			                [&output](types::array const &array_)
+			                {
+				                output.emplace_back(5);
+				                serialize_type(output, *array_.elements);
+				            });
+		}
+
+		inline types::type deserialize_type(byte_reader &input, std::size_t depth = 0)
+		{
+			if (depth > max_nesting)
+			{
+				throw std::invalid_argument("staticdb file nests types too deeply");
+			}
+			switch (input.read_integer(1))
+			{
+			case 0:
+				return types::unit();
+			case 1:
+				return types::bit();
+			case 2:
+				return types::function();
+			case 3:
+			{
+				std::vector<types::type> elements(input.read_count());
+				for (types::type &element : elements)
+				{
+					element = deserialize_type(input, depth + 1);
+				}
+				return types::tuple(std::move(elements));
+			}
+			case 4:
+			{
+				std::vector<types::type> possibilities(input.read_count());
+				for (types::type &possibility : possibilities)
+				{
+					possibility = deserialize_type(input, depth + 1);
+				}
+				return types::variant(std::move(possibilities));
+			}
+			case 5:
+				return types::array(Si::make_unique<types::type>(deserialize_type(input, depth + 1)));
+			default:
+				throw std::invalid_argument("staticdb file contains an unknown type");
+			}
+		}
+
+		inline void serialize_layout(std::vector<byte> &output, layouts::layout const &serialized)
+		{
+			Si::visit<void>(serialized.as_variant(),
+			                [&output](layouts::unit)
+			                {
+				                output.emplace_back(0);
+				            },
+			                [&output](layouts::tuple const &tuple_)
+			                {
+				                output.emplace_back(1);
+				                append_integer(output, tuple_.elements.size(), 8);
+				                for (layouts::layout const &element : tuple_.elements)
+				                {
+					                serialize_layout(output, element);
+				                }
+				            },
+			                [&output](layouts::array const &array_)
+			                {
+				                switch (array_.encoding)
+				                {
+				                case layouts::bitset_encoding::plain:
+					                break;
+				                case layouts::bitset_encoding::frame_of_reference:
+					                output.emplace_back(8);
+					                serialize_layout(output, *array_.element);
+					                return;
+				                case layouts::bitset_encoding::delta:
+					                output.emplace_back(9);
+					                serialize_layout(output, *array_.element);
+					                return;
+				                case layouts::bitset_encoding::dictionary:
+					                output.emplace_back(10);
+					                serialize_layout(output, *array_.element);
+					                return;
+				                case layouts::bitset_encoding::elias_fano:
+					                output.emplace_back(11);
+					                serialize_layout(output, *array_.element);
+					                return;
+				                }
+				                switch (array_.tags)
+				                {
+				                case layouts::variant_tags::in_elements:
+					                output.emplace_back(2);
+					                break;
+				                case layouts::variant_tags::column:
+					                output.emplace_back(5);
+					                break;
+				                case layouts::variant_tags::indexed_column:
+					                output.emplace_back(6);
+					                break;
+				                case layouts::variant_tags::sparse_column:
+					                output.emplace_back(7);
+					                break;
+				                }
+				                serialize_layout(output, *array_.element);
+				            },
+			                [&output](layouts::bitset const &bitset_)
+			                {
+				                output.emplace_back(3);
+				                append_integer(output, bitset_.length, 8);
+				            },
+			                [&output](layouts::variant const &variant_)
+			                {
+				                output.emplace_back(4);
+				                append_integer(output, variant_.possibilities.size(), 8);
+				                for (layouts::layout const &possibility : variant_.possibilities)
+				                {
+					                serialize_layout(output, possibility);
+				                }
+				            });
+		}
+
+		inline std::vector<layouts::layout> deserialize_layouts(byte_reader &input, std::size_t depth);
+
+		inline layouts::layout deserialize_layout(byte_reader &input, std::size_t depth = 0)
+		{
+			if (depth > max_nesting)
+			{
+				throw std::invalid_argument("staticdb file nests layouts too deeply");
+			}
+			switch (input.read_integer(1))
+			{
+			case 0:
+				return layouts::layout(layouts::unit());
+			case 1:
+				return layouts::layout(layouts::tuple(deserialize_layouts(input, depth + 1)));
+			case 2:
+				return layouts::layout(layouts::array(Si::to_unique(deserialize_layout(input, depth + 1))));
+			case 3:
+				return layouts::layout(layouts::bitset(input.read_u64()));
+			case 4:
+				return layouts::layout(layouts::variant(deserialize_layouts(input, depth + 1)));
+			case 5:
+				return layouts::layout(
+				    layouts::array(Si::to_unique(deserialize_layout(input, depth + 1)), layouts::variant_tags::column));
+			case 6:
+				return layouts::layout(layouts::array(Si::to_unique(deserialize_layout(input, depth + 1)),
+				                                      layouts::variant_tags::indexed_column));
+			case 7:
+				return layouts::layout(layouts::array(Si::to_unique(deserialize_layout(input, depth + 1)),
+				                                      layouts::variant_tags::sparse_column));
+			case 8:
+				return layouts::layout(layouts::array(Si::to_unique(deserialize_layout(input, depth + 1)),
+				                                      layouts::bitset_encoding::frame_of_reference));
+			case 9:
+				return layouts::layout(layouts::array(Si::to_unique(deserialize_layout(input, depth + 1)),
+				                                      layouts::bitset_encoding::delta));
+			case 10:
+				return layouts::layout(layouts::array(Si::to_unique(deserialize_layout(input, depth + 1)),
+				                                      layouts::bitset_encoding::dictionary));
+			case 11:
+				return layouts::layout(layouts::array(Si::to_unique(deserialize_layout(input, depth + 1)),
+				                                      layouts::bitset_encoding::elias_fano));
+			default:
+				throw std::invalid_argument("staticdb file contains an unknown layout");
+			}
+		}
+
+		inline std::vector<layouts::layout> deserialize_layouts(byte_reader &input, std::size_t depth)
+		{
+			std::size_t const count = input.read_count();
+			std::vector<layouts::layout> result;
+			result.reserve(count);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				result.emplace_back(deserialize_layout(input, depth));
+			}
+			return result;
+		}
+
+		// Makes the bytes of one section look like a storage of their own.
+		template <class Storage>
+		struct section_storage
+		{
+			section_storage(Storage &whole, address offset)
+			    : m_whole(&whole)
+			    , m_offset(offset)
+			{
+			}
+
+			auto read_at(address where) const -> decltype(std::declval<Storage &>().read_at(where))
+			{
+				return m_whole->read_at(m_offset + where);
+			}
+
+			Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+			{
+				return m_whole->read_span(m_offset + where, length, scratch);
+			}
+
+			// Only exists when the whole storage is writable, so that sections of const storages stay read-only.
+			template <class Whole = Storage>
+			auto write_at(address where) -> decltype(std::declval<Whole &>().write_at(where))
+			{
+				return m_whole->write_at(m_offset + where);
+			}
+
+		private:
+			Storage *m_whole;
+			address m_offset;
+		};
+
+		struct database
+		{
+			types::type root_type;
+			layouts::layout root_layout;
+			std::vector<address> root_member_offsets;
+			section data;
+			std::vector<section> indexes;
+			std::vector<section> plans;
+			std::uint64_t schema_hash;
+		};
+
+		inline address align_section(address offset)
+		{
+			return ((offset + section_alignment - 1u) / section_alignment) * section_alignment;
+		}
+
+		template <class Storage>
+		void write_bytes(Storage &destination, address where, std::vector<byte> const &content)
+		{
+			byte const *const begin = content.data();
+			destination.write_at(where).append(Si::make_iterator_range(begin, begin + content.size()));
+		}
+
+		// Writes a database file whose data section holds the given bytes, which have to be a value of the root type
+		// as produced by layouts::serialize with root_layout. The layout can differ from the calculated one, for
+		// example in arrays that store the tags of their variant elements in a column or that encode their elements
+		// as chosen by layouts::choose_encodings.
+		template <class Storage>
+		void write_database(Storage &destination, types::type const &root_type, layouts::layout const &root_layout,
+		                    std::vector<byte> const &data, std::vector<index_content> const &indexes,
+		                    std::vector<index_content> const &plans)
+		{
+			std::vector<byte> type_section;
+			serialize_type(type_section, root_type);
+			std::vector<byte> layout_section;
+			serialize_layout(layout_section, root_layout);
+
+			layouts::tuple const *const members = Si::try_get_ptr<layouts::tuple>(root_layout.as_variant());
+			std::vector<byte> root_section;
+			std::vector<section> sections;
+			std::vector<std::vector<byte> const *> contents;
+			auto const add =
+			    [&sections, &contents](section_kind kind, std::uint32_t tag, std::vector<byte> const &content)
+			{
+				sections.push_back(section{kind, tag, 0, content.size()});
+				contents.emplace_back(&content);
+			};
+			add(section_kind::type, 0, type_section);
+			add(section_kind::layout, 0, layout_section);
+			add(section_kind::root, 0, root_section);
+			add(section_kind::data, 0, data);
+			for (index_content const &index : indexes)
+			{
+				add(section_kind::index, index.tag, index.content);
+			}
+			for (index_content const &plan : plans)
+			{
+				add(section_kind::plan, plan.tag, plan.content);
+			}
+			sections[2].length = members ? (members->elements.size() * 8u) : 0u;
+
+			address next = align_section(fixed_header_size + (section_entry_size * sections.size()));
+			std::vector<byte> table;
+			for (section &entry : sections)
+			{
+				entry.offset = next;
+				next = align_section(next + entry.length);
+				append_integer(table, static_cast<std::uint32_t>(entry.kind), 4);
+				append_integer(table, entry.tag, 4);
+				append_integer(table, entry.offset, 8);
+				append_integer(table, entry.length, 8);
+			}
+
+			write_bytes(destination, sections[3].offset, data);
+			if (members)
+			{
+				section_storage<Storage> written(destination, sections[3].offset);
+				address where = 0;
+				for (layouts::layout const &member : members->elements)
+				{
+					append_integer(root_section, where, 8);
+					Si::overflow_or<address> const member_end =
+					    Si::overflow_or<address>(where) +
+					    execution::stored_size_in_bits(
+					        execution::storage_pointer<section_storage<Storage>>(written, where), member);
+					if (member_end.is_overflow())
+					{
+						throw std::invalid_argument("write_database found a root that exceeds the address space");
+					}
+					where = *member_end.value();
+				}
+			}
+
+			std::uint64_t const sum = checksum(
+			    checksum(checksum(checksum(current_version, table), type_section), layout_section), root_section);
+			std::vector<byte> header{'S', 'T', 'A', 'T', 'I', 'C', 'D', 'B'};
+			append_integer(header, current_version, 4);
+			append_integer(header, sections.size(), 4);
+			append_integer(header, sum, 8);
+			header.insert(header.end(), table.begin(), table.end());
+			write_bytes(destination, 0, header);
+			for (std::size_t i = 0; i < sections.size(); ++i)
+			{
+				if (sections[i].kind != section_kind::data)
+				{
+					write_bytes(destination, sections[i].offset, *contents[i]);
+				}
+			}
+		}
+
+		template <class Storage>
+		void write_database(Storage &destination, types::type const &root_type, std::vector<byte> const &data,
+		                    std::vector<index_content> const &indexes, std::vector<index_content> const &plans)
+		{
+			write_database(destination, root_type, layouts::calculate(root_type), data, indexes, plans);
+		}
+
+		template <class Storage>
+		void write_database(Storage &destination, types::type const &root_type, std::vector<byte> const &data,
+		                    std::vector<index_content> const &indexes)
+		{
+			write_database(destination, root_type, data, indexes, std::vector<index_content>());
+		}
+
+		template <class Storage>
+		std::vector<byte> read_bytes(Storage &source, address where, address length)
+		{
+			if (length > (std::numeric_limits<std::size_t>::max)())
+			{
+				throw std::invalid_argument("staticdb file section is too large");
+			}
+			if (length == 0)
+			{
+				return std::vector<byte>();
+			}
+			// a corrupt length must not cause a huge allocation, so the last byte has to exist first
+			byte last = 0;
+			if ((length > ((std::numeric_limits<address>::max)() - where)) ||
+			    source.read_span(where + length - 1u, 1, &last).empty())
+			{
+				throw std::invalid_argument("staticdb file is truncated");
+			}
+			std::vector<byte> result(static_cast<std::size_t>(length));
+			Si::iterator_range<byte const *> const read = source.read_span(where, result.size(), result.data());
+			if (static_cast<std::size_t>(read.size()) != result.size())
+			{
+				throw std::invalid_argument("staticdb file is truncated");
+			}
+			if (read.begin() != result.data())
+			{
+				std::copy(read.begin(), read.end(), result.begin());
+			}
+			return result;
+		}
+
+		// Validates the header and decodes the type, the layout and the root offsets. The data section is not read.
+		template <class Storage>
+		database open_database(Storage &source)
+		{
+			std::vector<byte> const fixed = read_bytes(source, 0, fixed_header_size);
+			static char const magic[] = "STATICDB";
+			if (!std::equal(fixed.begin(), fixed.begin() + 8, magic))
+			{
+				throw std::invalid_argument("not a staticdb file");
+			}
+			byte_reader fixed_reader(Si::make_iterator_range(fixed.data() + 8, fixed.data() + fixed.size()));
+			std::uint32_t const version = fixed_reader.read_u32();
+			if (version != current_version)
+			{
+				throw std::invalid_argument("unsupported staticdb file version");
+			}
+			std::uint32_t const section_count = fixed_reader.read_u32();
+			std::uint64_t const expected_sum = fixed_reader.read_u64();
+
+			std::vector<byte> const table = read_bytes(source, fixed_header_size, section_entry_size * section_count);
+			byte_reader table_reader(Si::make_iterator_range(table.data(), table.data() + table.size()));
+			std::vector<section> sections;
+			for (std::uint32_t i = 0; i < section_count; ++i)
+			{
+				section entry;
+				entry.kind = static_cast<section_kind>(table_reader.read_u32());
+				entry.tag = table_reader.read_u32();
+				entry.offset = table_reader.read_u64();
+				entry.length = table_reader.read_u64();
+				if ((entry.offset % section_alignment) != 0)
+				{
+					throw std::invalid_argument("staticdb file contains a misaligned section");
+				}
+				sections.emplace_back(entry);
+			}
+			auto const find = [&sections](section_kind kind) -> section const &
+			{
+				for (section const &entry : sections)
+				{
+					if (entry.kind == kind)
+					{
+						return entry;
+					}
+				}
+				throw std::invalid_argument("staticdb file lacks a required section");
+			};
+			section const &type_entry = find(section_kind::type);
+			section const &layout_entry = find(section_kind::layout);
+			section const &root_entry = find(section_kind::root);
+			std::vector<byte> const type_section = read_bytes(source, type_entry.offset, type_entry.length);
+			std::vector<byte> const layout_section = read_bytes(source, layout_entry.offset, layout_entry.length);
+			std::vector<byte> const root_section = read_bytes(source, root_entry.offset, root_entry.length);
+			if (checksum(checksum(checksum(checksum(version, table), type_section), layout_section), root_section) !=
+			    expected_sum)
+			{
+				throw std::invalid_argument("staticdb file header is corrupt");
+			}
+
+			byte_reader type_reader(
+			    Si::make_iterator_range(type_section.data(), type_section.data() + type_section.size()));
+			byte_reader layout_reader(
+			    Si::make_iterator_range(layout_section.data(), layout_section.data() + layout_section.size()));
+			database result{deserialize_type(type_reader),
+			                deserialize_layout(layout_reader),
+			                std::vector<address>(),
+			                find(section_kind::data),
+			                std::vector<section>(),
+			                std::vector<section>(),
+			                schema_hash(type_section, layout_section)};
+			byte_reader root_reader(
+			    Si::make_iterator_range(root_section.data(), root_section.data() + root_section.size()));
+			while (!root_reader.empty())
+			{
+				result.root_member_offsets.emplace_back(root_reader.read_u64());
+			}
+			for (section const &entry : sections)
+			{
+				if (entry.kind == section_kind::index)
+				{
+					result.indexes.emplace_back(entry);
+				}
+				else if (entry.kind == section_kind::plan)
+				{
+					result.plans.emplace_back(entry);
+				}
+			}
+			return result;
+		}
+
+		template <class Storage>
+		section_storage<Storage> open_section(Storage &whole, section const &opened)
+		{
+			return section_storage<Storage>(whole, opened.offset);
+		}
+
+		// Makes an index section for write_database that holds the zone map of the array that begins at the bit
+		// array_begin of the data section: array_begin in 64 bits, then the zone map like serialize_zone_map writes it.
+		inline index_content zone_map_content(std::uint32_t tag, address array_begin, zone_map const &zones)
+		{
+			bit_buffer content;
+			content.append_bits(array_begin, 64);
+			serialize_zone_map(content, zones);
+			return index_content{tag, content.bytes()};
+		}
+
+		// Reads the zone maps of the index sections with the given tags for scan_options::zone_maps of a plan that
+		// runs on the data section.
+		template <class Storage>
+		std::shared_ptr<zone_map_set> load_zone_maps(Storage &whole, database const &opened,
+		                                             std::vector<std::uint32_t> const &tags)
+		{
+			auto const maps = std::make_shared<zone_map_set>();
+			for (std::uint32_t tag : tags)
+			{
+				section const *stored = nullptr;
+				for (section const &entry : opened.indexes)
+				{
+					if (entry.tag == tag)
+					{
+						stored = &entry;
+					}
+				}
+				if (!stored)
+				{
+					throw std::invalid_argument("staticdb file has no index with this tag");
+				}
+				memory_storage content;
+				content.memory = read_bytes(whole, stored->offset, stored->length);
+				if (content.memory.size() < 8u)
+				{
+					throw std::invalid_argument("staticdb zone map section is truncated");
+				}
+				typedef execution::storage_pointer<memory_storage const> pointer;
+				address const array_begin = execution::read_packed_bits(pointer(content, 0), 64);
+				maps->add(array_begin, std::make_shared<zone_map>(execution::read_zone_map(pointer(content, 64))));
+			}
+			return maps;
+		}
+
+		// Plans the gets against the stored layout instead of calculating it again. The plan runs on the data
+		// section, see open_section.
+		template <class Storage>
+		basic_plan<section_storage<Storage>> make_plan(database const &opened,
+		                                               Si::iterator_range<get_function const *> gets,
+		                                               Si::iterator_range<set_function const *> sets,
+		                                               execution::scan_options const &options)
+		{
+			return staticdb::make_plan<section_storage<Storage>>(Si::to_shared(opened.root_layout.copy()),
+			                                                     opened.root_member_offsets, gets, sets, options);
+		}
+	}
+}
+
+#endif
@@ -0,0 +1,262 @@
+#ifndef STATICDB_FILE_STORAGE_HPP
+#define STATICDB_FILE_STORAGE_HPP
+
+#include <staticdb/storage.hpp>
+#include <boost/config.hpp>
+#include <algorithm>
+#include <array>
+#include <system_error>
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <cerrno>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+namespace staticdb
+{
+	// Storage in a file on disk. Reads and writes use positional I/O, so reading from many threads at the same time
+	// is safe.
+	struct file_storage
+	{
+		explicit file_storage(char const *path)
+		{
+#ifdef _WIN32
+			m_file = CreateFileA(path, GENERIC_READ | GENERIC_WRITE, FILE_SHARE_READ, nullptr, OPEN_ALWAYS,
+			                     FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (m_file == INVALID_HANDLE_VALUE)
+			{
+				throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "CreateFile");
+			}
+#else
+			m_file = ::open(path, O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+			if (m_file < 0)
+			{
+				throw std::system_error(errno, std::system_category(), "open");
+			}
+#endif
+		}
+
+		~file_storage()
+		{
+			close();
+		}
+
+		file_storage(file_storage &&other) BOOST_NOEXCEPT : m_file(other.m_file)
+		{
+			other.m_file = invalid_file();
+		}
+
+		file_storage &operator=(file_storage &&other) BOOST_NOEXCEPT
+		{
+			close();
+			m_file = other.m_file;
+			other.m_file = invalid_file();
+			return *this;
+		}
+
+		SILICIUM_DISABLE_COPY(file_storage)
+
+		struct source
+		{
+			typedef byte element_type;
+
+			explicit source(file_storage const &file, address position)
+			    : m_file(&file)
+			    , m_position(position)
+			    , m_begin(0)
+			    , m_end(0)
+			{
+			}
+
+			Si::iterator_range<element_type const *> map_next(std::size_t size)
+			{
+				if (m_begin == m_end)
+				{
+					fill();
+				}
+				std::size_t const mapped = (std::min)(size, m_end - m_begin);
+				element_type const *const begin = m_buffer.data() + m_begin;
+				m_begin += mapped;
+				return Si::make_iterator_range(begin, begin + mapped);
+			}
+
+			element_type *copy_next(Si::iterator_range<element_type *> destination)
+			{
+				element_type *i = destination.begin();
+				while (i != destination.end())
+				{
+					Si::iterator_range<element_type const *> const mapped =
+					    map_next(static_cast<std::size_t>(destination.end() - i));
+					if (mapped.empty())
+					{
+						break;
+					}
+					i = std::copy(mapped.begin(), mapped.end(), i);
+				}
+				return i;
+			}
+
+		private:
+			file_storage const *m_file;
+			address m_position;
+			std::array<element_type, 256> m_buffer;
+			std::size_t m_begin;
+			std::size_t m_end;
+
+			void fill()
+			{
+				m_begin = 0;
+				m_end = m_file->read_some(m_position, m_buffer.data(), m_buffer.size());
+				m_position += m_end;
+			}
+		};
+
+		struct sink
+		{
+			typedef byte element_type;
+			typedef Si::success error_type;
+
+			explicit sink(file_storage &file, address position)
+			    : m_file(&file)
+			    , m_position(position)
+			{
+			}
+
+			error_type append(Si::iterator_range<element_type const *> data)
+			{
+				m_file->write(m_position, data.begin(), data.size());
+				m_position += data.size();
+				return error_type();
+			}
+
+		private:
+			file_storage *m_file;
+			address m_position;
+		};
+
+		source read_at(address where) const
+		{
+			return source(*this, where);
+		}
+
+		Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+		{
+			std::size_t copied = 0;
+			while (copied < length)
+			{
+				std::size_t const read = read_some(where + copied, scratch + copied, length - copied);
+				if (read == 0)
+				{
+					break;
+				}
+				copied += read;
+			}
+			return Si::make_iterator_range<byte const *>(scratch, scratch + copied);
+		}
+
+		sink write_at(address where)
+		{
+			return sink(*this, where);
+		}
+
+		std::size_t read_some(address where, byte *destination, std::size_t size) const
+		{
+#ifdef _WIN32
+			OVERLAPPED position = {};
+			position.Offset = static_cast<DWORD>(where);
+			position.OffsetHigh = static_cast<DWORD>(where >> 32u);
+			DWORD read = 0;
+			if (!ReadFile(m_file, destination, static_cast<DWORD>(size), &read, &position))
+			{
+				DWORD const error = GetLastError();
+				if (error == ERROR_HANDLE_EOF)
+				{
+					return 0;
+				}
+				throw std::system_error(static_cast<int>(error), std::system_category(), "ReadFile");
+			}
+			return read;
+#else
+			for (;;)
+			{
+				ssize_t const read = ::pread(m_file, destination, size, static_cast<off_t>(where));
+				if (read >= 0)
+				{
+					return static_cast<std::size_t>(read);
+				}
+				if (errno != EINTR)
+				{
+					throw std::system_error(errno, std::system_category(), "pread");
+				}
+			}
+#endif
+		}
+
+		void write(address where, byte const *data, std::size_t size)
+		{
+			while (size > 0)
+			{
+#ifdef _WIN32
+				OVERLAPPED position = {};
+				position.Offset = static_cast<DWORD>(where);
+				position.OffsetHigh = static_cast<DWORD>(where >> 32u);
+				DWORD written = 0;
+				if (!WriteFile(m_file, data, static_cast<DWORD>(size), &written, &position))
+				{
+					throw std::system_error(static_cast<int>(GetLastError()), std::system_category(), "WriteFile");
+				}
+#else
+				ssize_t const written = ::pwrite(m_file, data, size, static_cast<off_t>(where));
+				if (written < 0)
+				{
+					if (errno == EINTR)
+					{
+						continue;
+					}
+					throw std::system_error(errno, std::system_category(), "pwrite");
+				}
+#endif
+				data += written;
+				where += static_cast<address>(written);
+				size -= static_cast<std::size_t>(written);
+			}
+		}
+
+	private:
+#ifdef _WIN32
+		typedef HANDLE file_handle;
+
+		static file_handle invalid_file()
+		{
+			return INVALID_HANDLE_VALUE;
+		}
+#else
+		typedef int file_handle;
+
+		static file_handle invalid_file()
+		{
+			return -1;
+		}
+#endif
+
+		file_handle m_file;
+
+		void close()
+		{
+			if (m_file == invalid_file())
+			{
+				return;
+			}
+#ifdef _WIN32
+			CloseHandle(m_file);
+#else
+			::close(m_file);
+#endif
+			m_file = invalid_file();
+		}
+	};
+}
+
+#endif
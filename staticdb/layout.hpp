@@ -2,10 +2,12 @@
 #define STATICDB_LAYOUT_HPP
 
 #include <staticdb/types.hpp>
+#include <staticdb/bit_sink.hpp>
 #include <staticdb/storage.hpp>
 #include <staticdb/copy.hpp>
 #include <silicium/to_unique.hpp>
 #include <silicium/arithmetic/add.hpp>
+#include <algorithm>
 
 namespace staticdb
 {
@@ -51,12 +53,64 @@ namespace staticdb
 			SILICIUM_DISABLE_COPY(tuple)
 		};
 
+		// Where an array of variants stores the tags of its elements.
+		enum class variant_tags
+		{
+			// every element is its tag followed by its padded content
+			in_elements,
+
+			// the tags of all elements in front of the contents, so that filtering by the tag only reads the tags
+			column,
+
+			// like column, with the elements of every leaf listed after the contents
+			indexed_column,
+
+			// presence bits and only the present contents, for variants like an optional whose first leaf is empty
+			sparse_column
+		};
+
+		address const sparse_block_bits = 512;
+
+		// How an array of bitsets of at most 64 bits stores its elements. choose_encoding picks one from the data.
+		enum class bitset_encoding
+		{
+			// every element in the full length of the bitset
+			plain,
+
+			// the differences of the elements to the smallest one
+			frame_of_reference,
+
+			// for ascending elements: the differences to the previous element, restarting every delta_block_length
+			delta,
+
+			// the positions of the elements in a sorted list of the distinct ones
+			dictionary,
+
+			// for ascending elements: packed low bits and unary high bits with samples for a constant time search
+			elias_fano
+		};
+
+		address const delta_block_length = 128;
+		address const elias_fano_sample_interval = 256;
+
 		struct array
 		{
 			std::unique_ptr<layout> element;
+			variant_tags tags;
+			bitset_encoding encoding;
+
+			explicit array(std::unique_ptr<layout> element, variant_tags tags = variant_tags::in_elements,
+			               bitset_encoding encoding = bitset_encoding::plain)
+			    : element(std::move(element))
+			    , tags(tags)
+			    , encoding(encoding)
+			{
+			}
 
-			explicit array(std::unique_ptr<layout> element)
+			array(std::unique_ptr<layout> element, bitset_encoding encoding)
 			    : element(std::move(element))
+			    , tags(variant_tags::in_elements)
+			    , encoding(encoding)
 			{
 			}
 
@@ -65,13 +119,17 @@ namespace staticdb
 #if SILICIUM_COMPILER_GENERATES_MOVES
 			SILICIUM_DEFAULT_MOVE(array)
 #else
-			array(array &&other) BOOST_NOEXCEPT : element(std::move(other.element))
+			array(array &&other) BOOST_NOEXCEPT : element(std::move(other.element)),
+			                                      tags(other.tags),
+			                                      encoding(other.encoding)
 			{
 			}
 
 			array &operator=(array &&other) BOOST_NOEXCEPT
 			{
 				element = std::move(other.element);
+				tags = other.tags;
+				encoding = other.encoding;
 				return *this;
 			}
 #endif
@@ -97,10 +155,11 @@ namespace staticdb
 		{
 			std::vector<layout> possibilities;
 
-			explicit variant(std::vector<layout> possibilities)
-			    : possibilities(std::move(possibilities))
-			{
-			}
+			// Nested variants share the tag of the outermost one. Every leaf is a possibility that is not a variant
+			// itself, reached by choosing the possibilities along its path. The tag stores the index of the leaf.
+			std::vector<std::vector<std::size_t>> leaves;
+
+			explicit variant(std::vector<layout> possibilities);
 
 			variant copy() const
 			{
@@ -110,13 +169,15 @@ namespace staticdb
 #if SILICIUM_COMPILER_GENERATES_MOVES
 			SILICIUM_DEFAULT_MOVE(variant)
 #else
-			variant(variant &&other) BOOST_NOEXCEPT : possibilities(std::move(other.possibilities))
+			variant(variant &&other) BOOST_NOEXCEPT : possibilities(std::move(other.possibilities)),
+			                                          leaves(std::move(other.leaves))
 			{
 			}
 
 			variant &operator=(variant &&other) BOOST_NOEXCEPT
 			{
 				possibilities = std::move(other.possibilities);
+				leaves = std::move(other.leaves);
 				return *this;
 			}
 #endif
@@ -166,7 +227,27 @@ namespace staticdb
 
 		inline array array::copy() const
 		{
-			return array(Si::to_unique(element->copy()));
+			return array(Si::to_unique(element->copy()), tags, encoding);
+		}
+
+		inline variant::variant(std::vector<layout> possibilities)
+		    : possibilities(std::move(possibilities))
+		{
+			for (std::size_t i = 0; i < this->possibilities.size(); ++i)
+			{
+				variant const *const nested = Si::try_get_ptr<variant>(this->possibilities[i].as_variant());
+				if (!nested)
+				{
+					leaves.emplace_back(1, i);
+					continue;
+				}
+				for (std::vector<std::size_t> const &nested_leaf : nested->leaves)
+				{
+					std::vector<std::size_t> path(1, i);
+					path.insert(path.end(), nested_leaf.begin(), nested_leaf.end());
+					leaves.emplace_back(std::move(path));
+				}
+			}
 		}
 
 		bool operator==(layout const &left, layout const &right);
@@ -183,7 +264,7 @@ namespace staticdb
 
 		inline bool operator==(array const &left, array const &right)
 		{
-			return *left.element == *right.element;
+			return (*left.element == *right.element) && (left.tags == right.tags) && (left.encoding == right.encoding);
 		}
 
 		inline bool operator==(bitset left, bitset right)
@@ -220,7 +301,39 @@ namespace staticdb
 
 		inline std::ostream &operator<<(std::ostream &out, array const &value)
 		{
-			return out << "array(" << *value.element << ")";
+			out << "array(" << *value.element;
+			switch (value.tags)
+			{
+			case variant_tags::in_elements:
+				break;
+			case variant_tags::column:
+				out << ", tag column";
+				break;
+			case variant_tags::indexed_column:
+				out << ", indexed tag column";
+				break;
+			case variant_tags::sparse_column:
+				out << ", sparse tag column";
+				break;
+			}
+			switch (value.encoding)
+			{
+			case bitset_encoding::plain:
+				break;
+			case bitset_encoding::frame_of_reference:
+				out << ", frame of reference";
+				break;
+			case bitset_encoding::delta:
+				out << ", delta";
+				break;
+			case bitset_encoding::dictionary:
+				out << ", dictionary";
+				break;
+			case bitset_encoding::elias_fano:
+				out << ", Elias-Fano";
+				break;
+			}
+			return out << ")";
 		}
 
 		inline std::ostream &operator<<(std::ostream &out, bitset value)
@@ -243,6 +356,122 @@ namespace staticdb
 			return out << value.as_variant();
 		}
 
+		// Whether every value with this layout has the same size, so that it can be overwritten in place.
+		inline bool has_fixed_size(layout const &checked)
+		{
+			return Si::visit<bool>(checked.as_variant(),
+			                       [](unit)
+			                       {
+				                       return true;
+				                   },
+			                       [](tuple const &tuple_)
+			                       {
+				                       return std::all_of(tuple_.elements.begin(), tuple_.elements.end(),
+				                                          has_fixed_size);
+				                   },
+			                       [](array const &)
+			                       {
+				                       return false;
+				                   },
+			                       [](bitset const &)
+			                       {
+				                       return true;
+				                   },
+			                       [](variant const &variant_)
+			                       {
+				                       return std::all_of(variant_.possibilities.begin(), variant_.possibilities.end(),
+				                                          has_fixed_size);
+				                   });
+		}
+
+		inline Si::overflow_or<address> layout_size_in_bits(layout const &wanted);
+
+		// A variant is stored as the index of the leaf in as few bits as possible, followed by the content padded to
+		// the size of the largest leaf, so that every value of the variant has the same size. Merging nested variants
+		// into one tag uses the unused tag values of the inner variant, so for example an optional of a variant with
+		// three possibilities costs no more bits than the variant alone.
+		inline address variant_tag_bits(variant const &stored)
+		{
+			address bits = 0;
+			while ((bits < 64) && ((std::uint64_t(1) << bits) < stored.leaves.size()))
+			{
+				++bits;
+			}
+			return bits;
+		}
+
+		inline layout const &leaf_layout(variant const &stored, std::size_t leaf)
+		{
+			assert(leaf < stored.leaves.size());
+			variant const *current = &stored;
+			layout const *found = nullptr;
+			for (std::size_t chosen : stored.leaves[leaf])
+			{
+				assert(current);
+				found = &current->possibilities[chosen];
+				current = Si::try_get_ptr<variant>(found->as_variant());
+			}
+			assert(found);
+			return *found;
+		}
+
+		// Finds the leaf that a variant value belongs to. The content of the leaf is returned, too, because it is
+		// nested in as many values::variant as the path of the leaf is long.
+		inline Si::optional<std::pair<std::size_t, values::value const *>> find_leaf(variant const &stored,
+		                                                                             values::value const &object)
+		{
+			std::size_t leaf = 0;
+			variant const *current = &stored;
+			values::value const *content = &object;
+			while (current)
+			{
+				values::variant const *const chosen = Si::try_get_ptr<values::variant>(content->as_variant());
+				if (!chosen || (chosen->which >= current->possibilities.size()))
+				{
+					return Si::none;
+				}
+				for (std::size_t i = 0; i < chosen->which; ++i)
+				{
+					variant const *const skipped = Si::try_get_ptr<variant>(current->possibilities[i].as_variant());
+					leaf += skipped ? skipped->leaves.size() : 1u;
+				}
+				content = chosen->content.get();
+				current = Si::try_get_ptr<variant>(current->possibilities[chosen->which].as_variant());
+			}
+			return std::make_pair(leaf, content);
+		}
+
+		// Wraps the content of a leaf in the values::variant along its path.
+		inline values::value make_leaf_value(variant const &stored, std::size_t leaf, values::value content)
+		{
+			std::vector<std::size_t> const &path = stored.leaves[leaf];
+			for (auto i = path.rbegin(); i != path.rend(); ++i)
+			{
+				content = values::value(values::variant(*i, Si::to_unique(std::move(content))));
+			}
+			return content;
+		}
+
+		inline Si::overflow_or<address> variant_content_bits(variant const &stored)
+		{
+			address largest = 0;
+			for (std::size_t leaf = 0; leaf < stored.leaves.size(); ++leaf)
+			{
+				layout const &possibility = leaf_layout(stored, leaf);
+				if (!has_fixed_size(possibility))
+				{
+					throw std::invalid_argument("a variant can only contain possibilities of a fixed size");
+				}
+				Si::overflow_or<address> const size = layout_size_in_bits(possibility);
+				if (size.is_overflow())
+				{
+					return size;
+				}
+				largest = (std::max)(largest, *size.value());
+			}
+			return largest;
+		}
+
 		inline Si::overflow_or<address> layout_size_in_bits(layout const &wanted)
 		{
 			return Si::visit<Si::overflow_or<address>>(wanted.as_variant(),
@@ -261,15 +490,17 @@ namespace staticdb
 				                                       },
 			                                           [](array const &) -> Si::overflow_or<address>
 			                                           {
-				                                           throw std::logic_error("not implemented");
+				                                           throw std::invalid_argument(
+				                                               "the size of an array depends on its length");
 				                                       },
 			                                           [](bitset const &bitset_) -> Si::overflow_or<address>
 			                                           {
 				                                           return bitset_.length;
 				                                       },
-			                                           [](variant const &) -> Si::overflow_or<address>
+			                                           [](variant const &variant_) -> Si::overflow_or<address>
 			                                           {
-				                                           throw std::logic_error("not implemented");
+				                                           return variant_content_bits(variant_) +
+				                                                  variant_tag_bits(variant_);
 				                                       });
 		}
 
@@ -278,7 +509,7 @@ namespace staticdb
 			return Si::visit<layout>(root.as_variant(),
 			                         [](types::unit) -> layout
 			                         {
-				                         throw std::invalid_argument("Cannot calculate layout for unit");
+				                         return layout(unit());
 				                     },
 			                         [](types::bit) -> layout
 			                         {
@@ -332,7 +563,7 @@ namespace staticdb
 				                     },
 			                         [](types::variant const &variant_type) -> layout
 			                         {
-				                         // TODO: fold variants
+				                         // nested variants are folded into the tag of this one by the constructor
 				                         std::vector<layout> possibilities;
 				                         for (types::type const &possible_type : variant_type.possibilities)
 				                         {
@@ -346,6 +577,572 @@ namespace staticdb
 				                         return layout(array(Si::to_unique(std::move(element))));
 				                     });
 		}
+
+		// The variant elements of an array that stores its tags in a column.
+		inline variant const &tagged_element(layout const &element, variant_tags tags)
+		{
+			assert(tags != variant_tags::in_elements);
+			variant const *const variant_ = Si::try_get_ptr<variant>(element.as_variant());
+			if (!variant_ || !has_fixed_size(element))
+			{
+				throw std::invalid_argument("an array with a tag column needs variant elements of a fixed size");
+			}
+			if (tags != variant_tags::sparse_column)
+			{
+				return *variant_;
+			}
+			Si::overflow_or<address> const absent_bits =
+			    (variant_->leaves.size() == 2) ? layout_size_in_bits(leaf_layout(*variant_, 0))
+			                                     : Si::overflow_or<address>(address(1));
+			if (absent_bits.is_overflow() || (*absent_bits.value() != 0))
+			{
+				throw std::invalid_argument("a sparse tag column needs a variant of an empty and one other leaf");
+			}
+			return *variant_;
+		}
+
+		inline variant const &tagged_element(array const &stored)
+		{
+			return tagged_element(*stored.element, stored.tags);
+		}
+
+		inline void serialize(bit_buffer &destination, values::value const &object, layout const &stored);
+
+		inline void serialize_leaf_content(bit_buffer &destination, variant const &stored, std::size_t leaf,
+		                                   values::value const &content)
+		{
+			Si::overflow_or<address> const content_bits = variant_content_bits(stored);
+			if (content_bits.is_overflow())
+			{
+				throw std::invalid_argument("serialize found a variant that exceeds the address space");
+			}
+			address const begin = destination.length();
+			serialize(destination, content, leaf_layout(stored, leaf));
+			for (address padding = *content_bits.value() - (destination.length() - begin); padding > 0;)
+			{
+				address const taking = (std::min)(padding, address(64));
+				destination.append_bits(0, static_cast<std::size_t>(taking));
+				padding -= taking;
+			}
+		}
+
+		// Writes an array of variants whose tags are not in the elements. The format is described at serialize.
+		inline void serialize_tag_column(bit_buffer &destination, values::tuple const &elements, array const &stored)
+		{
+			variant const &element = tagged_element(stored);
+			std::vector<std::pair<std::size_t, values::value const *>> found;
+			found.reserve(elements.elements.size());
+			for (values::value const &object : elements.elements)
+			{
+				Si::optional<std::pair<std::size_t, values::value const *>> const leaf = find_leaf(element, object);
+				if (!leaf)
+				{
+					throw std::invalid_argument("serialize expected a variant value with a valid index");
+				}
+				found.emplace_back(*leaf);
+			}
+			std::size_t const tag_bits = static_cast<std::size_t>(variant_tag_bits(element));
+			for (std::pair<std::size_t, values::value const *> const &leaf : found)
+			{
+				destination.append_bits(leaf.first, tag_bits);
+			}
+			if (stored.tags == variant_tags::sparse_column)
+			{
+				std::uint64_t present = 0;
+				for (std::size_t i = 0; i < found.size(); ++i)
+				{
+					if ((i % sparse_block_bits) == 0)
+					{
+						destination.append_bits(present, 64);
+					}
+					present += found[i].first;
+				}
+			}
+			for (std::pair<std::size_t, values::value const *> const &leaf : found)
+			{
+				if ((stored.tags != variant_tags::sparse_column) || (leaf.first != 0))
+				{
+					serialize_leaf_content(destination, element, leaf.first, *leaf.second);
+				}
+			}
+			if (stored.tags != variant_tags::indexed_column)
+			{
+				return;
+			}
+			std::vector<std::vector<std::uint64_t>> entries(element.leaves.size());
+			for (std::size_t i = 0; i < found.size(); ++i)
+			{
+				entries[found[i].first].emplace_back(i);
+			}
+			std::uint64_t position = 0;
+			for (std::vector<std::uint64_t> const &leaf_entries : entries)
+			{
+				destination.append_bits(position, 64);
+				position += leaf_entries.size();
+			}
+			destination.append_bits(position, 64);
+			for (std::vector<std::uint64_t> const &leaf_entries : entries)
+			{
+				for (std::uint64_t entry : leaf_entries)
+				{
+					destination.append_bits(entry, 64);
+				}
+			}
+		}
+
+		// The number of bits needed to store every offset up to and including the given one.
+		inline address offset_bits(address largest)
+		{
+			address bits = 0;
+			while ((bits < 64) && ((largest >> bits) != 0))
+			{
+				++bits;
+			}
+			return bits;
+		}
+
+		// Writes an array of elements without a fixed size. The format is described at serialize.
+		inline void serialize_offsets(bit_buffer &destination, values::tuple const &elements, layout const &element)
+		{
+			std::vector<bit_buffer> encoded(elements.elements.size());
+			std::vector<address> offsets;
+			offsets.reserve(elements.elements.size() + 1u);
+			offsets.emplace_back(0);
+			for (std::size_t i = 0; i < elements.elements.size(); ++i)
+			{
+				serialize(encoded[i], elements.elements[i], element);
+				Si::overflow_or<address> const next = Si::overflow_or<address>(offsets.back()) + encoded[i].length();
+				if (next.is_overflow())
+				{
+					throw std::invalid_argument("serialize found an array that exceeds the address space");
+				}
+				offsets.emplace_back(*next.value());
+			}
+			std::size_t const width = static_cast<std::size_t>(offset_bits(offsets.back()));
+			destination.append_bits(width, 8);
+			for (address offset : offsets)
+			{
+				destination.append_bits(offset, width);
+			}
+			for (bit_buffer const &piece : encoded)
+			{
+				destination.append_buffer(piece);
+			}
+		}
+
+		// The bitset elements of an array with an encoding other than plain.
+		inline bitset const &encoded_element(array const &stored)
+		{
+			assert(stored.encoding != bitset_encoding::plain);
+			bitset const *const bitset_ = Si::try_get_ptr<bitset>(stored.element->as_variant());
+			if (!bitset_ || (bitset_->length > 64) || (stored.tags != variant_tags::in_elements))
+			{
+				throw std::invalid_argument("an encoded array needs bitset elements of at most 64 bits");
+			}
+			return *bitset_;
+		}
+
+		inline std::uint64_t pack_bitset(values::value const &object, bitset stored)
+		{
+			assert(stored.length <= 64);
+			packing_bit_sink packer;
+			values::serialize(packer, object);
+			if (packer.length() != stored.length)
+			{
+				throw std::invalid_argument("serialize expected a value with as many bits as the bitset");
+			}
+			return packer.packed();
+		}
+
+		inline std::vector<std::uint64_t> distinct_elements(std::vector<std::uint64_t> elements)
+		{
+			std::sort(elements.begin(), elements.end());
+			elements.erase(std::unique(elements.begin(), elements.end()), elements.end());
+			return elements;
+		}
+
+		// The number of low bits of an Elias-Fano encoding, which is about the binary logarithm of the average
+		// difference between two elements. Every element then needs this many bits and about two more.
+		inline address elias_fano_low_bits(address length, std::uint64_t range)
+		{
+			if ((length == 0) || (range / length == 0))
+			{
+				return 0;
+			}
+			return offset_bits(range / length) - 1u;
+		}
+
+		// The number of bits that an encoding needs for the elements after the length of the array, or none if the
+		// encoding cannot store them.
+		inline Si::optional<address> encoded_size_in_bits(std::vector<std::uint64_t> const &elements,
+		                                                  address element_bits, bitset_encoding encoding)
+		{
+			address const length = elements.size();
+			switch (encoding)
+			{
+			case bitset_encoding::plain:
+				return length * element_bits;
+
+			case bitset_encoding::frame_of_reference:
+			{
+				if (elements.empty())
+				{
+					return address(64 + 8);
+				}
+				auto const range = std::minmax_element(elements.begin(), elements.end());
+				return address(64 + 8) + (length * offset_bits(*range.second - *range.first));
+			}
+
+			case bitset_encoding::delta:
+			{
+				if (!std::is_sorted(elements.begin(), elements.end()))
+				{
+					return Si::none;
+				}
+				std::uint64_t largest = 0;
+				for (std::size_t i = 1; i < elements.size(); ++i)
+				{
+					largest = (std::max)(largest, elements[i] - elements[i - 1]);
+				}
+				address const blocks = (length + delta_block_length - 1u) / delta_block_length;
+				return address(8) + (blocks * 64u) + (length * offset_bits(largest));
+			}
+
+			case bitset_encoding::dictionary:
+				break;
+
+			case bitset_encoding::elias_fano:
+			{
+				if (!std::is_sorted(elements.begin(), elements.end()))
+				{
+					return Si::none;
+				}
+				std::uint64_t const range = elements.empty() ? 0 : (elements.back() - elements.front());
+				address const low_bits = elias_fano_low_bits(length, range);
+				address const zeros = (range >> low_bits) + 1u;
+				address const samples = ((length + elias_fano_sample_interval - 1u) / elias_fano_sample_interval) +
+				                        ((zeros + elias_fano_sample_interval - 1u) / elias_fano_sample_interval);
+				return address(64 + 8 + 64) + (samples * 64u) + (length * low_bits) + length + zeros;
+			}
+			}
+			address const distinct = distinct_elements(elements).size();
+			address const code_bits = (distinct == 0) ? 0 : offset_bits(distinct - 1u);
+			return address(64 + 8) + (distinct * element_bits) + (length * code_bits);
+		}
+
+		// The encoding that stores the elements in the fewest bits. Plain wins ties because it is the fastest to read.
+		inline bitset_encoding choose_encoding(std::vector<std::uint64_t> const &elements, address element_bits)
+		{
+			bitset_encoding best = bitset_encoding::plain;
+			address best_size = *encoded_size_in_bits(elements, element_bits, best);
+			for (bitset_encoding candidate : {bitset_encoding::frame_of_reference, bitset_encoding::delta,
+			                                  bitset_encoding::dictionary, bitset_encoding::elias_fano})
+			{
+				Si::optional<address> const size = encoded_size_in_bits(elements, element_bits, candidate);
+				if (size && (*size < best_size))
+				{
+					best = candidate;
+					best_size = *size;
+				}
+			}
+			return best;
+		}
+
+		inline void serialize_elias_fano(bit_buffer &destination, std::vector<std::uint64_t> const &elements)
+		{
+			if (!std::is_sorted(elements.begin(), elements.end()))
+			{
+				throw std::invalid_argument("an Elias-Fano encoded array needs ascending elements");
+			}
+			std::uint64_t const smallest = elements.empty() ? 0 : elements.front();
+			std::uint64_t const range = elements.empty() ? 0 : (elements.back() - smallest);
+			std::size_t const low_bits = static_cast<std::size_t>(elias_fano_low_bits(elements.size(), range));
+			std::uint64_t const buckets = (range >> low_bits) + 1u;
+			bit_buffer high;
+			std::vector<std::uint64_t> one_samples;
+			std::vector<std::uint64_t> zero_samples;
+			std::uint64_t zeros = 0;
+			auto const append_zero = [&high, &zero_samples, &zeros]()
+			{
+				if ((zeros % elias_fano_sample_interval) == 0)
+				{
+					zero_samples.emplace_back(high.length());
+				}
+				high.append_bits(0, 1);
+				++zeros;
+			};
+			for (std::size_t i = 0; i < elements.size(); ++i)
+			{
+				std::uint64_t const bucket = (elements[i] - smallest) >> low_bits;
+				while (zeros < bucket)
+				{
+					append_zero();
+				}
+				if ((i % elias_fano_sample_interval) == 0)
+				{
+					one_samples.emplace_back(high.length());
+				}
+				high.append_bits(1, 1);
+			}
+			while (zeros < buckets)
+			{
+				append_zero();
+			}
+			destination.append_bits(smallest, 64);
+			destination.append_bits(low_bits, 8);
+			destination.append_bits(high.length(), 64);
+			for (std::uint64_t sample : one_samples)
+			{
+				destination.append_bits(sample, 64);
+			}
+			for (std::uint64_t sample : zero_samples)
+			{
+				destination.append_bits(sample, 64);
+			}
+			std::uint64_t const low_mask = (std::uint64_t(1) << low_bits) - 1u;
+			for (std::uint64_t element : elements)
+			{
+				destination.append_bits((element - smallest) & low_mask, low_bits);
+			}
+			destination.append_buffer(high);
+		}
+
+		// Writes the elements of an array with an encoding other than plain. The format is described at serialize.
+		inline void serialize_encoded(bit_buffer &destination, std::vector<std::uint64_t> const &elements,
+		                              address element_bits, bitset_encoding encoding)
+		{
+			switch (encoding)
+			{
+			case bitset_encoding::plain:
+				for (std::uint64_t element : elements)
+				{
+					destination.append_bits(element, static_cast<std::size_t>(element_bits));
+				}
+				return;
+
+			case bitset_encoding::frame_of_reference:
+			{
+				std::uint64_t smallest = 0;
+				std::uint64_t largest = 0;
+				if (!elements.empty())
+				{
+					auto const range = std::minmax_element(elements.begin(), elements.end());
+					smallest = *range.first;
+					largest = *range.second;
+				}
+				std::size_t const width = static_cast<std::size_t>(offset_bits(largest - smallest));
+				destination.append_bits(smallest, 64);
+				destination.append_bits(width, 8);
+				for (std::uint64_t element : elements)
+				{
+					destination.append_bits(element - smallest, width);
+				}
+				return;
+			}
+
+			case bitset_encoding::delta:
+			{
+				if (!std::is_sorted(elements.begin(), elements.end()))
+				{
+					throw std::invalid_argument("a delta encoded array needs ascending elements");
+				}
+				std::uint64_t largest = 0;
+				for (std::size_t i = 1; i < elements.size(); ++i)
+				{
+					largest = (std::max)(largest, elements[i] - elements[i - 1]);
+				}
+				std::size_t const width = static_cast<std::size_t>(offset_bits(largest));
+				destination.append_bits(width, 8);
+				for (std::size_t i = 0; i < elements.size(); i += static_cast<std::size_t>(delta_block_length))
+				{
+					destination.append_bits(elements[i], 64);
+				}
+				for (std::size_t i = 0; i < elements.size(); ++i)
+				{
+					bool const starts_block = ((i % delta_block_length) == 0);
+					destination.append_bits(starts_block ? 0 : (elements[i] - elements[i - 1]), width);
+				}
+				return;
+			}
+
+			case bitset_encoding::dictionary:
+			{
+				std::vector<std::uint64_t> const dictionary = distinct_elements(elements);
+				std::size_t const width =
+				    dictionary.empty() ? 0 : static_cast<std::size_t>(offset_bits(dictionary.size() - 1u));
+				destination.append_bits(dictionary.size(), 64);
+				for (std::uint64_t entry : dictionary)
+				{
+					destination.append_bits(entry, static_cast<std::size_t>(element_bits));
+				}
+				destination.append_bits(width, 8);
+				for (std::uint64_t element : elements)
+				{
+					auto const found = std::lower_bound(dictionary.begin(), dictionary.end(), element);
+					destination.append_bits(static_cast<std::uint64_t>(found - dictionary.begin()), width);
+				}
+				return;
+			}
+
+			case bitset_encoding::elias_fano:
+				serialize_elias_fano(destination, elements);
+				return;
+			}
+		}
+
+		// Writes a value in the given layout. Unlike values::serialize, this writes the lengths of arrays and the
+		// indices and padding of variants.
+		//
+		// An array begins with its length in 64 bits. What follows depends on how it is stored:
+		// - plain fixed size elements: the elements one after another.
+		// - elements without a fixed size: the width of the offsets in 8 bits, the offset of every element from the
+		//   first one and of the end in that width, then the elements.
+		// - variant_tags::column: the tags of all elements, then their padded contents. indexed_column adds, for
+		//   every leaf, the position of its first entry and one more for the end, then the entries, which are the
+		//   ascending indices of the elements of each leaf. sparse_column stores a presence bit per element, the
+		//   number of present elements before every block of sparse_block_bits elements and only the present
+		//   contents.
+		// - frame_of_reference: the smallest element in 64 bits, the width of the differences in 8 bits and the
+		//   differences.
+		// - delta: the width of the differences in 8 bits, the first element of every block in 64 bits and the
+		//   differences, zero for the first element of a block.
+		// - dictionary: the number of distinct elements in 64 bits, the ascending distinct elements in the length
+		//   of the bitset, the width of the positions in 8 bits and the positions.
+		// - elias_fano: the smallest element in 64 bits, the number of low bits in 8 bits, the number of high bits
+		//   in 64 bits, the positions of every elias_fano_sample_interval-th one and then zero of the high bits in
+		//   64 bits each, the low bits and the high bits, which hold every element as zeros followed by a one.
+		inline void serialize(bit_buffer &destination, values::value const &object, layout const &stored)
+		{
+			Si::visit<void>(
+			    stored.as_variant(),
+			    [&object](unit)
+			    {
+				    if (!Si::try_get_ptr<values::unit>(object.as_variant()))
+				    {
+					    throw std::invalid_argument("serialize expected a unit value");
+				    }
+				},
+			    [&destination, &object](tuple const &tuple_)
+			    {
+				    values::tuple const *const elements = Si::try_get_ptr<values::tuple>(object.as_variant());
+				    if (!elements || (elements->elements.size() != tuple_.elements.size()))
+				    {
+					    throw std::invalid_argument("serialize expected a tuple value with matching elements");
+				    }
+				    for (std::size_t i = 0; i < tuple_.elements.size(); ++i)
+				    {
+					    serialize(destination, elements->elements[i], tuple_.elements[i]);
+				    }
+				},
+			    [&destination, &object](array const &array_)
+			    {
+				    values::tuple const *const elements = Si::try_get_ptr<values::tuple>(object.as_variant());
+				    if (!elements)
+				    {
+					    throw std::invalid_argument("serialize expected a tuple value for an array");
+				    }
+				    destination.append_bits(elements->elements.size(), 64);
+				    if (array_.encoding != bitset_encoding::plain)
+				    {
+					    bitset const element = encoded_element(array_);
+					    std::vector<std::uint64_t> packed;
+					    packed.reserve(elements->elements.size());
+					    for (values::value const &object : elements->elements)
+					    {
+						    packed.emplace_back(pack_bitset(object, element));
+					    }
+					    serialize_encoded(destination, packed, element.length, array_.encoding);
+					    return;
+				    }
+				    if (array_.tags != variant_tags::in_elements)
+				    {
+					    serialize_tag_column(destination, *elements, array_);
+					    return;
+				    }
+				    if (!has_fixed_size(*array_.element))
+				    {
+					    serialize_offsets(destination, *elements, *array_.element);
+					    return;
+				    }
+				    for (values::value const &element : elements->elements)
+				    {
+					    serialize(destination, element, *array_.element);
+				    }
+				},
+			    [&destination, &object](bitset const &bitset_)
+			    {
+				    address const begin = destination.length();
+				    values::serialize(destination, object);
+				    if ((destination.length() - begin) != bitset_.length)
+				    {
+					    throw std::invalid_argument("serialize expected a value with as many bits as the bitset");
+				    }
+				},
+			    [&destination, &object](variant const &variant_)
+			    {
+				    Si::optional<std::pair<std::size_t, values::value const *>> const leaf =
+				        find_leaf(variant_, object);
+				    if (!leaf)
+				    {
+					    throw std::invalid_argument("serialize expected a variant value with a valid index");
+				    }
+				    destination.append_bits(leaf->first, static_cast<std::size_t>(variant_tag_bits(variant_)));
+				    serialize_leaf_content(destination, variant_, leaf->first, *leaf->second);
+				});
+		}
+
+		// Gives every array of bitsets of at most 64 bits in the layout the encoding that stores its elements in
+		// the data in the fewest bits. Arrays within arrays keep their encoding because all of their elements share
+		// one layout.
+		inline layout choose_encodings(layout const &stored, values::value const &data)
+		{
+			return Si::visit<layout>(
+			    stored.as_variant(),
+			    [](unit) -> layout
+			    {
+				    return layout(unit());
+				},
+			    [&stored, &data](tuple const &tuple_) -> layout
+			    {
+				    values::tuple const *const elements = Si::try_get_ptr<values::tuple>(data.as_variant());
+				    if (!elements || (elements->elements.size() != tuple_.elements.size()))
+				    {
+					    return stored.copy();
+				    }
+				    std::vector<layout> chosen;
+				    chosen.reserve(tuple_.elements.size());
+				    for (std::size_t i = 0; i < tuple_.elements.size(); ++i)
+				    {
+					    chosen.emplace_back(choose_encodings(tuple_.elements[i], elements->elements[i]));
+				    }
+				    return layout(tuple(std::move(chosen)));
+				},
+			    [&stored, &data](array const &array_) -> layout
+			    {
+				    bitset const *const element = Si::try_get_ptr<bitset>(array_.element->as_variant());
+				    values::tuple const *const elements = Si::try_get_ptr<values::tuple>(data.as_variant());
+				    if (!element || (element->length > 64) || (array_.tags != variant_tags::in_elements) ||
+				        !elements)
+				    {
+					    return stored.copy();
+				    }
+				    std::vector<std::uint64_t> packed;
+				    packed.reserve(elements->elements.size());
+				    for (values::value const &object : elements->elements)
+				    {
+					    packed.emplace_back(pack_bitset(object, *element));
+				    }
+				    return layout(array(Si::to_unique(layout(*element)), choose_encoding(packed, element->length)));
+				},
+			    [](bitset const &bitset_) -> layout
+			    {
+				    return layout(bitset_);
+				},
+			    [&stored](variant const &) -> layout
+			    {
+				    return stored.copy();
+				});
+		}
 	}
 }
 
@@ -0,0 +1,259 @@
+#ifndef STATICDB_PACKED_KEY_HPP
+#define STATICDB_PACKED_KEY_HPP
+
+#include <staticdb/expressions.hpp>
+#include <staticdb/layout.hpp>
+
+namespace staticdb
+{
+	namespace execution
+	{
+		struct bit_range
+		{
+			address offset;
+			address length;
+
+			bit_range(address offset, address length)
+			    : offset(offset)
+			    , length(length)
+			{
+			}
+		};
+
+		inline bool operator==(bit_range left, bit_range right)
+		{
+			return (left.offset == right.offset) && (left.length == right.length);
+		}
+
+		struct packed_key
+		{
+			std::uint64_t bits;
+			address length;
+
+			packed_key()
+			    : bits(0)
+			    , length(0)
+			{
+			}
+
+			packed_key(std::uint64_t bits, address length)
+			    : bits(bits)
+			    , length(length)
+			{
+			}
+		};
+
+		inline bool operator==(packed_key left, packed_key right)
+		{
+			return (left.bits == right.bits) && (left.length == right.length);
+		}
+
+		inline bool operator!=(packed_key left, packed_key right)
+		{
+			return !(left == right);
+		}
+
+		const address max_packed_key_bits(64);
+
+		inline std::uint64_t mix_bits(std::uint64_t bits)
+		{
+			bits ^= bits >> 33u;
+			bits *= 0xff51afd7ed558ccdull;
+			bits ^= bits >> 33u;
+			bits *= 0xc4ceb9fe1a85ec53ull;
+			bits ^= bits >> 33u;
+			return bits;
+		}
+
+		inline address count_ones(std::uint64_t bits)
+		{
+			bits = bits - ((bits >> 1u) & 0x5555555555555555ull);
+			bits = (bits & 0x3333333333333333ull) + ((bits >> 2u) & 0x3333333333333333ull);
+			bits = (bits + (bits >> 4u)) & 0x0f0f0f0f0f0f0f0full;
+			return (bits * 0x0101010101010101ull) >> 56u;
+		}
+
+		// The position of the lowest set bit counted from the least significant one. bits must not be zero.
+		inline address lowest_one(std::uint64_t bits)
+		{
+			assert(bits != 0);
+			return count_ones((bits & (~bits + 1u)) - 1u);
+		}
+
+		struct packed_key_hash
+		{
+			std::size_t operator()(packed_key key) const
+			{
+				return static_cast<std::size_t>(mix_bits(key.bits ^ (key.length << 57u)));
+			}
+		};
+
+		inline void append_bit_range(std::vector<bit_range> &ranges, bit_range appended)
+		{
+			if (!ranges.empty() && (ranges.back().offset + ranges.back().length == appended.offset))
+			{
+				ranges.back().length += appended.length;
+				return;
+			}
+			ranges.emplace_back(appended);
+		}
+
+		struct key_bits
+		{
+			std::vector<bit_range> ranges;
+			address length;
+
+			// The number of bits of the evaluated key. It can be larger than length when the stored bits are the
+			// lowest bits of a wider integer.
+			address value_length;
+
+			key_bits()
+			    : length(0)
+			    , value_length(0)
+			{
+			}
+		};
+
+		// Finds the bits of an element that a key lambda body selects so that keys can be read from storage
+		// without building value trees. Returns none for bodies that have to be evaluated.
+		inline Si::optional<key_bits> find_key_bits(expressions::expression const &body, layouts::layout const &element)
+		{
+			return Si::visit<Si::optional<key_bits>>(
+			    body,
+			    [](expressions::literal const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [&element](expressions::argument) -> Si::optional<key_bits>
+			    {
+				    layouts::bitset const *const bits = Si::try_get_ptr<layouts::bitset>(element.as_variant());
+				    if (!bits || (bits->length > max_packed_key_bits))
+				    {
+					    return Si::none;
+				    }
+				    key_bits result;
+				    result.ranges.emplace_back(0, bits->length);
+				    result.length = bits->length;
+				    result.value_length = bits->length;
+				    return result;
+				},
+			    [](expressions::bound) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [&element](expressions::make_tuple const &make_tuple_) -> Si::optional<key_bits>
+			    {
+				    key_bits result;
+				    for (expressions::expression const &part : make_tuple_.elements)
+				    {
+					    Si::optional<key_bits> const part_bits = find_key_bits(part, element);
+					    if (!part_bits || (part_bits->value_length != part_bits->length))
+					    {
+						    return Si::none;
+					    }
+					    for (bit_range const &range : part_bits->ranges)
+					    {
+						    append_bit_range(result.ranges, range);
+					    }
+					    result.length += part_bits->length;
+				    }
+				    if (result.length > max_packed_key_bits)
+				    {
+					    return Si::none;
+				    }
+				    result.value_length = result.length;
+				    return result;
+				},
+			    [&element](expressions::tuple_at const &tuple_at_) -> Si::optional<key_bits>
+			    {
+				    if (!Si::try_get_ptr<expressions::argument>(tuple_at_.tuple->as_variant()))
+				    {
+					    return Si::none;
+				    }
+				    layouts::bitset const *const bits = Si::try_get_ptr<layouts::bitset>(element.as_variant());
+				    if (!bits)
+				    {
+					    return Si::none;
+				    }
+				    expressions::literal const *const index =
+				        Si::try_get_ptr<expressions::literal>(tuple_at_.index->as_variant());
+				    if (!index)
+				    {
+					    return Si::none;
+				    }
+				    values::tuple const *const index_tuple =
+				        Si::try_get_ptr<values::tuple>(index->value.as_variant());
+				    if (!index_tuple)
+				    {
+					    return Si::none;
+				    }
+				    Si::optional<address> const parsed_index = values::parse_unsigned_integer<address>(*index_tuple);
+				    if (!parsed_index || (*parsed_index >= bits->length))
+				    {
+					    return Si::none;
+				    }
+				    key_bits result;
+				    result.ranges.emplace_back(*parsed_index, 1);
+				    result.length = 1;
+				    result.value_length = 1;
+				    return result;
+				},
+			    [](expressions::branch const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [](expressions::lambda const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [](expressions::call const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [](expressions::filter const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [](expressions::equals const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [](expressions::join const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [](expressions::order_by const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [](expressions::group_by const &) -> Si::optional<key_bits>
+			    {
+				    return Si::none;
+				},
+			    [&element](expressions::variant_index const &variant_index_) -> Si::optional<key_bits>
+			    {
+				    if (!Si::try_get_ptr<expressions::argument>(variant_index_.variant->as_variant()))
+				    {
+					    return Si::none;
+				    }
+				    layouts::variant const *const variant_ = Si::try_get_ptr<layouts::variant>(element.as_variant());
+				    // the tag equals the index of the possibility only if no possibility was folded into it
+				    if (!variant_ || (variant_->leaves.size() != variant_->possibilities.size()))
+				    {
+					    return Si::none;
+				    }
+				    key_bits result;
+				    address const tag_bits = layouts::variant_tag_bits(*variant_);
+				    if (tag_bits > 0)
+				    {
+					    result.ranges.emplace_back(0, tag_bits);
+				    }
+				    result.length = tag_bits;
+				    result.value_length = 64;
+				    return result;
+				});
+		}
+	}
+}
+
+#endif
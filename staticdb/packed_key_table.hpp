@@ -0,0 +1,75 @@
+#ifndef STATICDB_PACKED_KEY_TABLE_HPP
+#define STATICDB_PACKED_KEY_TABLE_HPP
+
+#include <staticdb/packed_key.hpp>
+
+namespace staticdb
+{
+	namespace execution
+	{
+		// Open addressing with linear probing. The slots only hold indices into the entries, so the entries stay in
+		// insertion order and do not move when the table grows.
+		template <class Value>
+		struct packed_key_table
+		{
+			typedef std::pair<packed_key, Value> entry;
+
+			packed_key_table()
+			    : m_slots(16, empty_slot())
+			{
+			}
+
+			std::pair<Value *, bool> insert(packed_key key, Value const &initial)
+			{
+				if ((m_entries.size() + 1) * 2 > m_slots.size())
+				{
+					grow();
+				}
+				std::size_t slot = find_slot(key);
+				if (m_slots[slot] != empty_slot())
+				{
+					return std::make_pair(&m_entries[m_slots[slot]].second, false);
+				}
+				m_slots[slot] = m_entries.size();
+				m_entries.emplace_back(key, initial);
+				return std::make_pair(&m_entries.back().second, true);
+			}
+
+			std::vector<entry> const &entries() const
+			{
+				return m_entries;
+			}
+
+		private:
+			std::vector<std::size_t> m_slots;
+			std::vector<entry> m_entries;
+
+			static std::size_t empty_slot()
+			{
+				return (std::numeric_limits<std::size_t>::max)();
+			}
+
+			std::size_t find_slot(packed_key key) const
+			{
+				std::size_t const mask = m_slots.size() - 1;
+				std::size_t slot = packed_key_hash()(key) & mask;
+				while ((m_slots[slot] != empty_slot()) && (m_entries[m_slots[slot]].first != key))
+				{
+					slot = (slot + 1) & mask;
+				}
+				return slot;
+			}
+
+			void grow()
+			{
+				m_slots.assign(m_slots.size() * 2, empty_slot());
+				for (std::size_t i = 0; i < m_entries.size(); ++i)
+				{
+					m_slots[find_slot(m_entries[i].first)] = i;
+				}
+			}
+		};
+	}
+}
+
+#endif
@@ -0,0 +1,501 @@
+#ifndef STATICDB_PAGED_FILE_STORAGE_HPP
+#define STATICDB_PAGED_FILE_STORAGE_HPP
+
+#include <staticdb/file_storage.hpp>
+#include <condition_variable>
+#include <cstring>
+#include <mutex>
+#include <stdexcept>
+#include <unordered_map>
+
+namespace staticdb
+{
+	// Caches fixed-size pages of a file in a bounded pool of frames, so that files larger than the memory can be
+	// read without mmap. Frames are evicted with the clock algorithm. A frame stays pinned as long as a page_handle
+	// or a source returned by read_at refers to it. When a missing page directly follows a cached one, the
+	// following pages are read with the same call because scans like run_filter read the file front to back.
+	// Reading from many threads is safe, and the file is read without holding the lock of the pool. Writes go
+	// through to the file and update the cached pages, but must not run concurrently with reads.
+	struct paged_file_storage
+	{
+		struct page_handle
+		{
+			page_handle()
+			    : m_storage(nullptr)
+			    , m_frame(0)
+			{
+			}
+
+			page_handle(paged_file_storage const &storage, std::size_t frame)
+			    : m_storage(&storage)
+			    , m_frame(frame)
+			{
+			}
+
+			~page_handle()
+			{
+				release();
+			}
+
+			page_handle(page_handle &&other) BOOST_NOEXCEPT : m_storage(other.m_storage), m_frame(other.m_frame)
+			{
+				other.m_storage = nullptr;
+			}
+
+			page_handle &operator=(page_handle &&other) BOOST_NOEXCEPT
+			{
+				release();
+				m_storage = other.m_storage;
+				m_frame = other.m_frame;
+				other.m_storage = nullptr;
+				return *this;
+			}
+
+			SILICIUM_DISABLE_COPY(page_handle)
+
+			bool empty() const
+			{
+				return !m_storage;
+			}
+
+			Si::iterator_range<byte const *> bytes() const
+			{
+				assert(m_storage);
+				frame const &pinned = m_storage->m_pool->frames[m_frame];
+				return Si::make_iterator_range<byte const *>(pinned.data.data(), pinned.data.data() + pinned.size);
+			}
+
+		private:
+			paged_file_storage const *m_storage;
+			std::size_t m_frame;
+
+			void release()
+			{
+				if (m_storage)
+				{
+					m_storage->unpin(m_frame);
+					m_storage = nullptr;
+				}
+			}
+		};
+
+		struct source
+		{
+			typedef byte element_type;
+
+			explicit source(paged_file_storage const &storage, address position)
+			    : m_storage(&storage)
+			    , m_position(position)
+			{
+			}
+
+			Si::iterator_range<element_type const *> map_next(std::size_t size)
+			{
+				std::size_t const page_size = m_storage->page_size();
+				std::size_t const in_page = static_cast<std::size_t>(m_position % page_size);
+				if (m_page.empty() || (in_page == 0))
+				{
+					m_page = page_handle();
+					m_page = m_storage->pin(m_position / page_size);
+				}
+				Si::iterator_range<byte const *> const bytes = m_page.bytes();
+				if (in_page >= static_cast<std::size_t>(bytes.size()))
+				{
+					return Si::iterator_range<element_type const *>();
+				}
+				std::size_t const mapped = (std::min)(size, static_cast<std::size_t>(bytes.size()) - in_page);
+				m_position += mapped;
+				return Si::make_iterator_range(bytes.begin() + in_page, bytes.begin() + in_page + mapped);
+			}
+
+			element_type *copy_next(Si::iterator_range<element_type *> destination)
+			{
+				element_type *i = destination.begin();
+				while (i != destination.end())
+				{
+					Si::iterator_range<element_type const *> const mapped =
+					    map_next(static_cast<std::size_t>(destination.end() - i));
+					if (mapped.empty())
+					{
+						break;
+					}
+					i = std::copy(mapped.begin(), mapped.end(), i);
+				}
+				return i;
+			}
+
+		private:
+			paged_file_storage const *m_storage;
+			address m_position;
+			page_handle m_page;
+		};
+
+		struct sink
+		{
+			typedef byte element_type;
+			typedef Si::success error_type;
+
+			explicit sink(paged_file_storage &storage, address position)
+			    : m_storage(&storage)
+			    , m_position(position)
+			{
+			}
+
+			error_type append(Si::iterator_range<element_type const *> data)
+			{
+				m_storage->write(m_position, data.begin(), static_cast<std::size_t>(data.size()));
+				m_position += static_cast<address>(data.size());
+				return error_type();
+			}
+
+		private:
+			paged_file_storage *m_storage;
+			address m_position;
+		};
+
+		paged_file_storage(char const *path, std::size_t page_size, std::size_t page_count,
+		                   std::size_t read_ahead_pages = 8)
+		{
+			if (page_size == 0)
+			{
+				throw std::invalid_argument("paged_file_storage needs a page size");
+			}
+			if (page_count == 0)
+			{
+				throw std::invalid_argument("paged_file_storage needs at least one page in the buffer pool");
+			}
+			m_pool = Si::make_unique<pool>(file_storage(path), page_size, page_count, read_ahead_pages);
+		}
+
+#if SILICIUM_COMPILER_GENERATES_MOVES
+		SILICIUM_DEFAULT_MOVE(paged_file_storage)
+#else
+		paged_file_storage(paged_file_storage &&other) BOOST_NOEXCEPT : m_pool(std::move(other.m_pool))
+		{
+		}
+
+		paged_file_storage &operator=(paged_file_storage &&other) BOOST_NOEXCEPT
+		{
+			m_pool = std::move(other.m_pool);
+			return *this;
+		}
+#endif
+		SILICIUM_DISABLE_COPY(paged_file_storage)
+
+		std::size_t page_size() const
+		{
+			return m_pool->page_size;
+		}
+
+		std::uint64_t hits() const
+		{
+			std::lock_guard<std::mutex> lock(m_pool->mutex);
+			return m_pool->hits;
+		}
+
+		std::uint64_t misses() const
+		{
+			std::lock_guard<std::mutex> lock(m_pool->mutex);
+			return m_pool->misses;
+		}
+
+		std::uint64_t pages_read_ahead() const
+		{
+			std::lock_guard<std::mutex> lock(m_pool->mutex);
+			return m_pool->read_ahead;
+		}
+
+		page_handle pin(address page) const
+		{
+			for (;;)
+			{
+				std::unique_lock<std::mutex> lock(m_pool->mutex);
+				auto const found = m_pool->index.find(page);
+				if (found != m_pool->index.end())
+				{
+					std::size_t const frame_index = found->second;
+					frame &cached = m_pool->frames[frame_index];
+					++cached.pins;
+					m_pool->loaded.wait(lock, [&cached]()
+					                    {
+						                    return !cached.loading;
+						                });
+					if (cached.used && (cached.page == page))
+					{
+						++m_pool->hits;
+						cached.referenced = true;
+						return page_handle(*this, frame_index);
+					}
+					// the read of the page failed
+					--cached.pins;
+					continue;
+				}
+				bool const sequential = (page > 0) && (m_pool->index.count(page - 1) > 0);
+				std::size_t wanted = 1;
+				if (sequential)
+				{
+					while ((wanted < 1 + m_pool->read_ahead_pages) && (m_pool->index.count(page + wanted) == 0))
+					{
+						++wanted;
+					}
+				}
+				loading_frames claimed(*this, lock);
+				for (std::size_t i = 0; i < wanted; ++i)
+				{
+					Si::optional<std::size_t> const victim = find_victim();
+					if (!victim)
+					{
+						break;
+					}
+					frame &evicted = m_pool->frames[*victim];
+					if (evicted.used)
+					{
+						m_pool->index.erase(evicted.page);
+					}
+					evicted.page = page + i;
+					evicted.used = true;
+					evicted.loading = true;
+					++evicted.pins;
+					m_pool->index.emplace(evicted.page, *victim);
+					claimed.victims.emplace_back(*victim);
+				}
+				if (claimed.victims.empty())
+				{
+					bool const reading = std::any_of(m_pool->frames.begin(), m_pool->frames.end(), [](frame const &each)
+					                                 {
+						                                 return each.loading;
+						                             });
+					if (!reading)
+					{
+						++m_pool->misses;
+						throw std::runtime_error("paged_file_storage: every page in the buffer pool is pinned");
+					}
+					// frames that other threads are reading into become free when their reads complete
+					m_pool->loaded.wait(lock);
+					continue;
+				}
+				++m_pool->misses;
+				lock.unlock();
+
+				// the claimed frames are pinned and marked as loading, so nobody else touches them during the read
+				std::size_t const page_size = m_pool->page_size;
+				std::vector<byte> scratch(claimed.victims.size() * page_size);
+				Si::iterator_range<byte const *> const read =
+				    m_pool->file.read_span(page * page_size, scratch.size(), scratch.data());
+				std::vector<std::size_t> sizes(claimed.victims.size());
+				for (std::size_t i = 0; i < claimed.victims.size(); ++i)
+				{
+					frame &loaded = m_pool->frames[claimed.victims[i]];
+					std::size_t const begin = (std::min)(i * page_size, static_cast<std::size_t>(read.size()));
+					std::size_t const end = (std::min)(begin + page_size, static_cast<std::size_t>(read.size()));
+					std::copy(read.begin() + begin, read.begin() + end, loaded.data.begin());
+					sizes[i] = end - begin;
+				}
+
+				lock.lock();
+				for (std::size_t i = 0; i < claimed.victims.size(); ++i)
+				{
+					frame &loaded = m_pool->frames[claimed.victims[i]];
+					loaded.size = sizes[i];
+					loaded.referenced = true;
+					loaded.loading = false;
+					if (i > 0)
+					{
+						--loaded.pins;
+					}
+				}
+				m_pool->read_ahead += claimed.victims.size() - 1;
+				std::size_t const first = claimed.victims[0];
+				claimed.victims.clear();
+				m_pool->loaded.notify_all();
+				return page_handle(*this, first);
+			}
+		}
+
+		source read_at(address where) const
+		{
+			return source(*this, where);
+		}
+
+		Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+		{
+			std::size_t copied = 0;
+			while (copied < length)
+			{
+				address const position = where + copied;
+				page_handle const page = pin(position / page_size());
+				Si::iterator_range<byte const *> const bytes = page.bytes();
+				std::size_t const in_page = static_cast<std::size_t>(position % page_size());
+				if (in_page >= static_cast<std::size_t>(bytes.size()))
+				{
+					break;
+				}
+				std::size_t const taking =
+				    (std::min)(length - copied, static_cast<std::size_t>(bytes.size()) - in_page);
+				std::memcpy(scratch + copied, bytes.begin() + in_page, taking);
+				copied += taking;
+			}
+			return Si::make_iterator_range<byte const *>(scratch, scratch + copied);
+		}
+
+		sink write_at(address where)
+		{
+			return sink(*this, where);
+		}
+
+	private:
+		struct frame
+		{
+			address page;
+			std::vector<byte> data;
+			std::size_t size;
+			std::size_t pins;
+			bool referenced;
+			bool used;
+
+			// the page is being read into the frame without holding the mutex
+			bool loading;
+
+			explicit frame(std::size_t page_size)
+			    : page(0)
+			    , data(page_size)
+			    , size(0)
+			    , pins(0)
+			    , referenced(false)
+			    , used(false)
+			    , loading(false)
+			{
+			}
+		};
+
+		struct pool
+		{
+			file_storage file;
+			std::size_t page_size;
+			std::size_t read_ahead_pages;
+			std::mutex mutex;
+			std::condition_variable loaded;
+			std::vector<frame> frames;
+			std::unordered_map<address, std::size_t> index;
+			std::size_t clock_hand;
+			std::uint64_t hits;
+			std::uint64_t misses;
+			std::uint64_t read_ahead;
+
+			pool(file_storage file, std::size_t page_size, std::size_t page_count, std::size_t read_ahead_pages)
+			    : file(std::move(file))
+			    , page_size(page_size)
+			    , read_ahead_pages(read_ahead_pages)
+			    , frames(page_count, frame(page_size))
+			    , clock_hand(0)
+			    , hits(0)
+			    , misses(0)
+			    , read_ahead(0)
+			{
+			}
+		};
+
+		std::unique_ptr<pool> m_pool;
+
+		// Frames that pin() claimed for a read. Unless the read completes, the destructor gives them back to the pool
+		// as unused frames, so that a failed read neither leaks pins nor leaves pages marked as loading.
+		struct loading_frames
+		{
+			paged_file_storage const *storage;
+			std::unique_lock<std::mutex> *lock;
+			std::vector<std::size_t> victims;
+
+			loading_frames(paged_file_storage const &storage, std::unique_lock<std::mutex> &lock)
+			    : storage(&storage)
+			    , lock(&lock)
+			{
+			}
+
+			~loading_frames()
+			{
+				if (victims.empty())
+				{
+					return;
+				}
+				if (!lock->owns_lock())
+				{
+					lock->lock();
+				}
+				for (std::size_t victim : victims)
+				{
+					frame &abandoned = storage->m_pool->frames[victim];
+					storage->m_pool->index.erase(abandoned.page);
+					abandoned.used = false;
+					abandoned.loading = false;
+					--abandoned.pins;
+				}
+				storage->m_pool->loaded.notify_all();
+			}
+
+			SILICIUM_DISABLE_COPY(loading_frames)
+		};
+
+		Si::optional<std::size_t> find_victim() const
+		{
+			for (std::size_t step = 0; step < 2 * m_pool->frames.size(); ++step)
+			{
+				std::size_t const candidate = m_pool->clock_hand;
+				m_pool->clock_hand = (m_pool->clock_hand + 1) % m_pool->frames.size();
+				frame &current = m_pool->frames[candidate];
+				if (current.pins > 0)
+				{
+					continue;
+				}
+				if (!current.used)
+				{
+					return candidate;
+				}
+				if (current.referenced)
+				{
+					current.referenced = false;
+					continue;
+				}
+				return candidate;
+			}
+			return Si::none;
+		}
+
+		void unpin(std::size_t frame_index) const
+		{
+			std::lock_guard<std::mutex> lock(m_pool->mutex);
+			frame &pinned = m_pool->frames[frame_index];
+			assert(pinned.pins > 0);
+			--pinned.pins;
+		}
+
+		void write(address where, byte const *data, std::size_t size)
+		{
+			m_pool->file.write(where, data, size);
+			std::lock_guard<std::mutex> lock(m_pool->mutex);
+			std::size_t const page_size = m_pool->page_size;
+			for (address page = where / page_size; (page * page_size) < (where + size); ++page)
+			{
+				auto const found = m_pool->index.find(page);
+				if (found == m_pool->index.end())
+				{
+					continue;
+				}
+				frame &cached = m_pool->frames[found->second];
+				address const page_begin = page * page_size;
+				address const begin = (std::max)(where, page_begin);
+				address const end = (std::min)(where + size, page_begin + page_size);
+				std::size_t const in_page = static_cast<std::size_t>(begin - page_begin);
+				if (in_page > cached.size)
+				{
+					std::fill(cached.data.begin() + static_cast<std::ptrdiff_t>(cached.size),
+					          cached.data.begin() + static_cast<std::ptrdiff_t>(in_page), byte(0));
+				}
+				std::copy(data + (begin - where), data + (end - where),
+				          cached.data.begin() + static_cast<std::ptrdiff_t>(in_page));
+				cached.size = (std::max)(cached.size, static_cast<std::size_t>(end - page_begin));
+			}
+		}
+	};
+}
+
+#endif
@@ -9,6 +9,9 @@
 
 namespace staticdb
 {
+	// A plan does not change after make_plan. The planned gets keep all of their intermediate state local to the
+	// call, so one plan can be shared by any number of threads. A plan for a const storage type such as
+	// memory_storage const can only read, so those threads can also share a single storage without locking.
 	template <class Storage>
 	struct basic_plan
 	{
@@ -32,57 +35,121 @@ namespace staticdb
 
 	template <class Storage>
 	inline Si::optional<values::value> run_getter(Storage &storage, get_function const &get,
-	                                              values::value const &argument, layouts::layout const &root)
+	                                              values::value const &argument, layouts::layout const &root,
+	                                              std::vector<address> const &root_member_offsets,
+	                                              execution::scan_options const &options)
 	{
 		typedef execution::pseudo_value<Storage> pseudo_value;
-		return Si::visit<Si::optional<values::value>>(
-		    root.as_variant(),
-		    [](layouts::unit) -> Si::optional<values::value>
-		    {
-			    throw std::logic_error("not implemented");
-			},
-		    [](layouts::tuple const &) -> Si::optional<values::value>
-		    {
-			    throw std::logic_error("not implemented");
-			},
-		    [&storage, &get, &argument](layouts::array const &array_layout) -> Si::optional<values::value>
-		    {
-			    execution::basic_array_accessor<Storage> root_array(execution::storage_pointer<Storage>(storage, 0),
-			                                                        array_layout.element->copy());
-			    execution::basic_tuple<pseudo_value> get_argument;
-			    get_argument.elements.emplace_back(std::move(root_array));
-			    get_argument.elements.emplace_back(argument.copy());
-			    Si::optional<pseudo_value> const complex_result = execution::execute(
-			        get, pseudo_value(std::move(get_argument)), pseudo_value(values::value(values::unit())));
-			    if (!complex_result)
-			    {
-				    return Si::none;
-			    }
-			    values::value simple_result = execution::reduce_value(*complex_result);
-			    return std::move(simple_result);
-			},
-		    [](layouts::bitset const &) -> Si::optional<values::value>
-		    {
-			    throw std::logic_error("not implemented");
-			},
-		    [](layouts::variant const &) -> Si::optional<values::value>
-		    {
-			    throw std::logic_error("not implemented");
-			});
+		execution::basic_tuple<pseudo_value> get_argument;
+		get_argument.elements.emplace_back(execution::access_root(storage, root, root_member_offsets));
+		get_argument.elements.emplace_back(argument.copy());
+		Si::optional<pseudo_value> const complex_result = execution::execute(
+		    get, pseudo_value(std::move(get_argument)), pseudo_value(values::value(values::unit())), options);
+		if (!complex_result)
+		{
+			return Si::none;
+		}
+		values::value simple_result = execution::reduce_value(*complex_result);
+		return std::move(simple_result);
 	}
 
 	template <class Storage>
-	inline basic_plan<Storage> make_plan(types::type const &root, Si::iterator_range<get_function const *> gets,
-	                                     Si::iterator_range<set_function const *> sets)
+	inline Si::optional<values::value> run_getter(Storage &storage, get_function const &get,
+	                                              values::value const &argument, layouts::layout const &root,
+	                                              execution::scan_options const &options)
 	{
-		typedef Storage storage_type;
-		boost::ignore_unused_variable_warning(sets);
-		std::shared_ptr<layouts::layout> root_layout = Si::to_shared(layouts::calculate(root));
-		basic_plan<Storage> result;
-		for (get_function const &get : gets)
+		return run_getter(storage, get, argument, root, std::vector<address>(), options);
+	}
+
+	// A setter is evaluated like a getter. It results in a tuple of a stored array, an index and the new value of
+	// the element at that index. The element is overwritten in place, its zones are widened, and the setter returns
+	// its previous value.
+	template <class Storage>
+	inline values::value run_setter(Storage &storage, set_function const &set, values::value const &argument,
+	                                layouts::layout const &root, std::vector<address> const &root_member_offsets,
+	                                execution::scan_options const &options)
+	{
+		typedef execution::pseudo_value<Storage> pseudo_value;
+		execution::basic_tuple<pseudo_value> set_argument;
+		set_argument.elements.emplace_back(execution::access_root(storage, root, root_member_offsets));
+		set_argument.elements.emplace_back(argument.copy());
+		Si::optional<pseudo_value> const assignment = execution::execute(
+		    set, pseudo_value(std::move(set_argument)), pseudo_value(values::value(values::unit())), options);
+		if (!assignment)
 		{
-			analyze_getter(*root_layout, get);
+			throw std::invalid_argument("setter did not result in an assignment");
+		}
+		execution::basic_tuple<pseudo_value> const *const parts =
+		    Si::try_get_ptr<execution::basic_tuple<pseudo_value>>(*assignment);
+		if (!parts || (parts->elements.size() != 3))
+		{
+			throw std::invalid_argument("setter has to result in a tuple of an array, an index and an element");
+		}
+		execution::basic_array_accessor<Storage> const *const array =
+		    Si::try_get_ptr<execution::basic_array_accessor<Storage>>(parts->elements[0]);
+		if (!array)
+		{
+			throw std::invalid_argument("setter can only assign to elements of stored arrays");
+		}
+		address const index = execution::extract_address(parts->elements[1]);
+		values::value const element = execution::reduce_value(parts->elements[2]);
+		values::value previous = execution::set_array_element(*array, index, element);
+		if (options.zone_maps)
+		{
+			execution::widen_zones(*array, index, element, *options.zone_maps);
+		}
+		return previous;
+	}
+
+	template <class Storage>
+	inline void plan_setters(basic_plan<Storage> &, std::shared_ptr<layouts::layout const> const &,
+	                         std::shared_ptr<std::vector<address> const> const &,
+	                         Si::iterator_range<set_function const *> sets, execution::scan_options const &,
+	                         std::false_type)
+	{
+		if (!sets.empty())
+		{
+			throw std::invalid_argument("a plan for a storage without write_at cannot have setters");
+		}
+	}
+
+	template <class Storage>
+	inline void plan_setters(basic_plan<Storage> &result, std::shared_ptr<layouts::layout const> const &root_layout,
+	                         std::shared_ptr<std::vector<address> const> const &member_offsets,
+	                         Si::iterator_range<set_function const *> sets, execution::scan_options const &options,
+	                         std::true_type)
+	{
+		if (options.bitmap_indexes && !sets.empty())
+		{
+			// a setter would leave the rows of the overwritten element in the bitmap of its old value
+			throw std::invalid_argument("a plan with bitmap indexes cannot have setters");
+		}
+		for (set_function const &set : sets)
+		{
+			auto set_ptr = Si::to_shared(set.copy());
+			result.sets.emplace_back([set_ptr, root_layout, member_offsets, options](Storage &storage,
+			                                                                         values::value const &argument)
+			                         {
+				                         return run_setter(storage, *set_ptr, argument, *root_layout, *member_offsets,
+				                                           options);
+				                     });
 		}
+	}
+
+	// Plans the gets and sets for data whose root layout is already known, for example because it was stored in a file.
+	// root_member_offsets are the bit offsets of the members of a tuple root. They spare the getters from walking
+	// the preceding members to find one. An empty vector means that the offsets are not known.
+	template <class Storage>
+	inline basic_plan<Storage> make_plan(std::shared_ptr<layouts::layout const> root_layout,
+	                                     std::vector<address> root_member_offsets,
+	                                     Si::iterator_range<get_function const *> gets,
+	                                     Si::iterator_range<set_function const *> sets,
+	                                     execution::scan_options const &options)
+	{
+		typedef Storage storage_type;
+		std::shared_ptr<std::vector<address> const> const member_offsets =
+		    Si::to_shared(std::move(root_member_offsets));
+		basic_plan<Storage> result;
 		for (get_function const &get : gets)
 		{
 #if !SILICIUM_COMPILER_HAS_EXTENDED_CAPTURE
@@ -96,7 +163,8 @@ namespace staticdb
 			        get_ptr
 #endif
 			            ,
-			        root_layout](storage_type &storage, values::value const &argument) -> Si::optional<values::value>
+			        root_layout, member_offsets, options](storage_type &storage, values::value const &argument)
+			        -> Si::optional<values::value>
 			    {
 				    return run_getter(storage,
 #if SILICIUM_COMPILER_HAS_EXTENDED_CAPTURE
@@ -104,11 +172,32 @@ namespace staticdb
 #else
 				                      *get_ptr,
 #endif
-				                      argument, *root_layout);
+				                      argument, *root_layout, *member_offsets, options);
 				});
 		}
+		plan_setters(result, root_layout, member_offsets, sets, options, is_writable_storage<Storage>());
 		return result;
 	}
+
+	template <class Storage>
+	inline basic_plan<Storage> make_plan(types::type const &root, Si::iterator_range<get_function const *> gets,
+	                                     Si::iterator_range<set_function const *> sets,
+	                                     execution::scan_options const &options)
+	{
+		std::shared_ptr<layouts::layout> root_layout = Si::to_shared(layouts::calculate(root));
+		for (get_function const &get : gets)
+		{
+			analyze_getter(*root_layout, get);
+		}
+		return make_plan<Storage>(root_layout, std::vector<address>(), gets, sets, options);
+	}
+
+	template <class Storage>
+	inline basic_plan<Storage> make_plan(types::type const &root, Si::iterator_range<get_function const *> gets,
+	                                     Si::iterator_range<set_function const *> sets)
+	{
+		return make_plan<Storage>(root, gets, sets, execution::scan_options());
+	}
 }
 
 #endif
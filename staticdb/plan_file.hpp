@@ -0,0 +1,408 @@
+#ifndef STATICDB_PLAN_FILE_HPP
+#define STATICDB_PLAN_FILE_HPP
+
+#include <staticdb/file_format.hpp>
+
+namespace staticdb
+{
+	// A plan section stores the version of its encoding, the programs of the getters and setters of a plan, the hash
+	// of the type and layout sections it was made for and the tags of the index sections it reads. load_plan checks
+	// all of them, so a plan is never run against a database with a different schema, and builds the plan from the
+	// stored layout.
+	namespace file_format
+	{
+		// Has to change whenever the encoding of plans changes. Version 2 stores which possibility a variant value
+		// holds.
+		std::uint32_t const plan_version = 2;
+
+		inline void serialize_value(std::vector<byte> &output, values::value const &serialized)
+		{
+			Si::visit<void>(serialized.as_variant(),
+			                [&output](values::unit)
+			                {
+				                output.emplace_back(0);
+				            },
+			                [&output](values::bit bit_)
+			                {
+				                output.emplace_back(1);
+				                output.emplace_back(bit_.is_set);
+				            },
+			                [&output](values::tuple const &tuple_)
+			                {
+				                output.emplace_back(2);
+				                append_integer(output, tuple_.elements.size(), 8);
+				                for (values::value const &element : tuple_.elements)
+				                {
+					                serialize_value(output, element);
+				                }
+				            },
+			                [&output](values::variant const &variant_)
+			                {
+				                output.emplace_back(3);
+				                append_integer(output, variant_.which, 8);
+				                serialize_value(output, *variant_.content);
+				            },
+			                [](values::closure const &) -> void
+			                {
+				                throw std::invalid_argument("a closure cannot be stored in a file");
+				            });
+		}
+
+		inline values::value deserialize_value(byte_reader &input, std::size_t depth = 0)
+		{
+			if (depth > max_nesting)
+			{
+				throw std::invalid_argument("staticdb file nests values too deeply");
+			}
+			switch (input.read_integer(1))
+			{
+			case 0:
+				return values::unit();
+			case 1:
+				return values::bit(input.read_integer(1) != 0);
+			case 2:
+			{
+				std::size_t const count = input.read_count();
+				std::vector<values::value> elements;
+				elements.reserve(count);
+				for (std::size_t i = 0; i < count; ++i)
+				{
+					elements.emplace_back(deserialize_value(input, depth + 1));
+				}
+				return values::tuple(std::move(elements));
+			}
+			case 3:
+			{
+				std::uint64_t const which = input.read_u64();
+				if (which > (std::numeric_limits<std::size_t>::max)())
+				{
+					throw std::invalid_argument("staticdb file contains a variant with an invalid index");
+				}
+				return values::variant(static_cast<std::size_t>(which),
+				                       Si::make_unique<values::value>(deserialize_value(input, depth + 1)));
+			}
+			default:
+				throw std::invalid_argument("staticdb file contains an unknown value");
+			}
+		}
+
+		inline void serialize_expression(std::vector<byte> &output, expressions::expression const &serialized);
+
+		inline void serialize_expressions(std::vector<byte> &output,
+		                                  std::vector<expressions::expression> const &serialized)
+		{
+			append_integer(output, serialized.size(), 8);
+			for (expressions::expression const &element : serialized)
+			{
+				serialize_expression(output, element);
+			}
+		}
+
+		inline void serialize_expression(std::vector<byte> &output, expressions::expression const &serialized)
+		{
+			Si::visit<void>(serialized.as_variant(),
+			                [&output](expressions::literal const &literal_)
+			                {
+				                output.emplace_back(0);
+				                serialize_value(output, literal_.value);
+				            },
+			                [&output](expressions::argument)
+			                {
+				                output.emplace_back(1);
+				            },
+			                [&output](expressions::bound)
+			                {
+				                output.emplace_back(2);
+				            },
+			                [&output](expressions::make_tuple const &make_tuple_)
+			                {
+				                output.emplace_back(3);
+				                serialize_expressions(output, make_tuple_.elements);
+				            },
+			                [&output](expressions::tuple_at const &tuple_at_)
+			                {
+				                output.emplace_back(4);
+				                serialize_expression(output, *tuple_at_.tuple);
+				                serialize_expression(output, *tuple_at_.index);
+				            },
+			                [&output](expressions::branch const &branch_)
+			                {
+				                output.emplace_back(5);
+				                serialize_expression(output, *branch_.condition);
+				                serialize_expression(output, *branch_.positive);
+				                serialize_expression(output, *branch_.negative);
+				            },
+			                [&output](expressions::lambda const &lambda_)
+			                {
+				                output.emplace_back(6);
+				                serialize_expression(output, *lambda_.body);
+				                serialize_expression(output, *lambda_.bound);
+				            },
+			                [&output](expressions::call const &call_)
+			                {
+				                output.emplace_back(7);
+				                serialize_expression(output, *call_.function);
+				                serialize_expressions(output, call_.arguments);
+				            },
+			                [&output](expressions::filter const &filter_)
+			                {
+				                output.emplace_back(8);
+				                serialize_expression(output, *filter_.input);
+				                serialize_expression(output, *filter_.predicate);
+				            },
+			                [&output](expressions::equals const &equals_)
+			                {
+				                output.emplace_back(9);
+				                serialize_expression(output, *equals_.first);
+				                serialize_expression(output, *equals_.second);
+				            },
+			                [&output](expressions::join const &join_)
+			                {
+				                output.emplace_back(10);
+				                serialize_expression(output, *join_.left);
+				                serialize_expression(output, *join_.right);
+				                serialize_expression(output, *join_.left_key);
+				                serialize_expression(output, *join_.right_key);
+				            },
+			                [&output](expressions::order_by const &order_by_)
+			                {
+				                output.emplace_back(11);
+				                serialize_expression(output, *order_by_.input);
+				                serialize_expression(output, *order_by_.key);
+				                output.emplace_back(order_by_.limit ? 1 : 0);
+				                if (order_by_.limit)
+				                {
+					                serialize_expression(output, *order_by_.limit);
+				                }
+				            },
+			                [&output](expressions::group_by const &group_by_)
+			                {
+				                output.emplace_back(12);
+				                serialize_expression(output, *group_by_.input);
+				                serialize_expression(output, *group_by_.key);
+				                output.emplace_back(static_cast<byte>(group_by_.function));
+				                output.emplace_back(group_by_.value ? 1 : 0);
+				                if (group_by_.value)
+				                {
+					                serialize_expression(output, *group_by_.value);
+				                }
+				            },
+			                [&output](expressions::variant_index const &variant_index_)
+			                {
+				                output.emplace_back(13);
+				                serialize_expression(output, *variant_index_.variant);
+				            });
+		}
+
+		inline expressions::expression deserialize_expression(byte_reader &input, std::size_t depth = 0);
+
+		inline std::unique_ptr<expressions::expression> deserialize_operand(byte_reader &input, std::size_t depth)
+		{
+			return Si::make_unique<expressions::expression>(deserialize_expression(input, depth + 1));
+		}
+
+		inline std::vector<expressions::expression> deserialize_expressions(byte_reader &input, std::size_t depth)
+		{
+			std::size_t const count = input.read_count();
+			std::vector<expressions::expression> result;
+			result.reserve(count);
+			for (std::size_t i = 0; i < count; ++i)
+			{
+				result.emplace_back(deserialize_expression(input, depth + 1));
+			}
+			return result;
+		}
+
+		inline expressions::expression deserialize_expression(byte_reader &input, std::size_t depth)
+		{
+			if (depth > max_nesting)
+			{
+				throw std::invalid_argument("staticdb file nests expressions too deeply");
+			}
+			switch (input.read_integer(1))
+			{
+			case 0:
+				return expressions::literal(deserialize_value(input, depth + 1));
+			case 1:
+				return expressions::argument();
+			case 2:
+				return expressions::bound();
+			case 3:
+				return expressions::make_tuple(deserialize_expressions(input, depth));
+			case 4:
+			{
+				auto tuple = deserialize_operand(input, depth);
+				return expressions::tuple_at(std::move(tuple), deserialize_operand(input, depth));
+			}
+			case 5:
+			{
+				auto condition = deserialize_operand(input, depth);
+				auto positive = deserialize_operand(input, depth);
+				return expressions::branch(std::move(condition), std::move(positive),
+				                           deserialize_operand(input, depth));
+			}
+			case 6:
+			{
+				auto body = deserialize_operand(input, depth);
+				return expressions::lambda(std::move(body), deserialize_operand(input, depth));
+			}
+			case 7:
+			{
+				auto function = deserialize_operand(input, depth);
+				return expressions::call(std::move(function), deserialize_expressions(input, depth));
+			}
+			case 8:
+			{
+				auto filtered = deserialize_operand(input, depth);
+				return expressions::filter(std::move(filtered), deserialize_operand(input, depth));
+			}
+			case 9:
+			{
+				auto first = deserialize_operand(input, depth);
+				return expressions::equals(std::move(first), deserialize_operand(input, depth));
+			}
+			case 10:
+			{
+				auto left = deserialize_operand(input, depth);
+				auto right = deserialize_operand(input, depth);
+				auto left_key = deserialize_operand(input, depth);
+				return expressions::join(std::move(left), std::move(right), std::move(left_key),
+				                         deserialize_operand(input, depth));
+			}
+			case 11:
+			{
+				auto ordered = deserialize_operand(input, depth);
+				auto key = deserialize_operand(input, depth);
+				if (input.read_integer(1) == 0)
+				{
+					return expressions::order_by(std::move(ordered), std::move(key));
+				}
+				return expressions::order_by(std::move(ordered), std::move(key), deserialize_operand(input, depth));
+			}
+			case 12:
+			{
+				auto grouped = deserialize_operand(input, depth);
+				auto key = deserialize_operand(input, depth);
+				std::uint64_t const function = input.read_integer(1);
+				if (function > static_cast<std::uint64_t>(expressions::aggregate_function::max))
+				{
+					throw std::invalid_argument("staticdb file contains an unknown aggregate function");
+				}
+				auto const aggregate = static_cast<expressions::aggregate_function>(function);
+				if (input.read_integer(1) == 0)
+				{
+					return expressions::group_by(std::move(grouped), std::move(key), aggregate);
+				}
+				return expressions::group_by(std::move(grouped), std::move(key), aggregate,
+				                             deserialize_operand(input, depth));
+			}
+			case 13:
+				return expressions::variant_index(deserialize_operand(input, depth));
+			default:
+				throw std::invalid_argument("staticdb file contains an unknown expression");
+			}
+		}
+
+		inline std::vector<byte> serialize_plan(std::uint64_t schema, Si::iterator_range<get_function const *> gets,
+		                                        Si::iterator_range<set_function const *> sets,
+		                                        std::vector<std::uint32_t> const &index_tags)
+		{
+			std::vector<byte> result;
+			append_integer(result, plan_version, 4);
+			append_integer(result, schema, 8);
+			append_integer(result, index_tags.size(), 8);
+			for (std::uint32_t tag : index_tags)
+			{
+				append_integer(result, tag, 4);
+			}
+			append_integer(result, static_cast<std::uint64_t>(gets.size()), 8);
+			for (get_function const &get : gets)
+			{
+				serialize_expression(result, get);
+			}
+			append_integer(result, static_cast<std::uint64_t>(sets.size()), 8);
+			for (set_function const &set : sets)
+			{
+				serialize_expression(result, set);
+			}
+			return result;
+		}
+
+		// Makes a plan section for write_database. root_layout has to be the layout that the file is written with.
+		// index_tags name the index sections that the plan reads.
+		inline index_content plan_content(std::uint32_t tag, types::type const &root_type,
+		                                  layouts::layout const &root_layout,
+		                                  Si::iterator_range<get_function const *> gets,
+		                                  Si::iterator_range<set_function const *> sets,
+		                                  std::vector<std::uint32_t> const &index_tags)
+		{
+			std::vector<byte> type_section;
+			serialize_type(type_section, root_type);
+			std::vector<byte> layout_section;
+			serialize_layout(layout_section, root_layout);
+			return index_content{tag,
+			                     serialize_plan(schema_hash(type_section, layout_section), gets, sets, index_tags)};
+		}
+
+		// A plan section for a file with the calculated layout of root_type.
+		inline index_content plan_content(std::uint32_t tag, types::type const &root_type,
+		                                  Si::iterator_range<get_function const *> gets,
+		                                  Si::iterator_range<set_function const *> sets,
+		                                  std::vector<std::uint32_t> const &index_tags)
+		{
+			return plan_content(tag, root_type, layouts::calculate(root_type), gets, sets, index_tags);
+		}
+
+		template <class Storage>
+		basic_plan<section_storage<Storage>> load_plan(Storage &whole, database const &opened, std::uint32_t tag,
+		                                               execution::scan_options const &options)
+		{
+			section const *stored = nullptr;
+			for (section const &entry : opened.plans)
+			{
+				if (entry.tag == tag)
+				{
+					stored = &entry;
+				}
+			}
+			if (!stored)
+			{
+				throw std::invalid_argument("staticdb file has no plan with this tag");
+			}
+			std::vector<byte> const content = read_bytes(whole, stored->offset, stored->length);
+			byte_reader input(Si::make_iterator_range(content.data(), content.data() + content.size()));
+			if (input.read_u32() != plan_version)
+			{
+				throw std::invalid_argument("stored plan has an unsupported version");
+			}
+			if (input.read_u64() != opened.schema_hash)
+			{
+				throw std::invalid_argument("stored plan was made for a different schema");
+			}
+			std::size_t const index_count = input.read_count();
+			for (std::size_t i = 0; i < index_count; ++i)
+			{
+				std::uint32_t const index_tag = input.read_u32();
+				if (std::none_of(opened.indexes.begin(), opened.indexes.end(), [index_tag](section const &index)
+				                 {
+					                 return index.tag == index_tag;
+					             }))
+				{
+					throw std::invalid_argument("stored plan needs an index that the file lacks");
+				}
+			}
+			std::vector<get_function> const gets = deserialize_expressions(input, 0);
+			std::vector<set_function> const sets = deserialize_expressions(input, 0);
+			if (!input.empty())
+			{
+				throw std::invalid_argument("stored plan has trailing bytes");
+			}
+			return staticdb::make_plan<section_storage<Storage>>(
+			    Si::to_shared(opened.root_layout.copy()), opened.root_member_offsets,
+			    Si::make_iterator_range(gets.data(), gets.data() + gets.size()),
+			    Si::make_iterator_range(sets.data(), sets.data() + sets.size()), options);
+		}
+	}
+}
+
+#endif
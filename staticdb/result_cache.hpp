@@ -0,0 +1,222 @@
+#ifndef STATICDB_RESULT_CACHE_HPP
+#define STATICDB_RESULT_CACHE_HPP
+
+#include <staticdb/plan.hpp>
+#include <staticdb/plan_file.hpp>
+#include <atomic>
+#include <list>
+#include <mutex>
+#include <unordered_map>
+
+namespace staticdb
+{
+	struct result_cache_key
+	{
+		std::size_t getter;
+		std::vector<byte> argument;
+		std::uint64_t hash;
+
+		result_cache_key(std::size_t getter, std::vector<byte> argument)
+		    : getter(getter)
+		    , argument(std::move(argument))
+		    , hash(execution::mix_bits(getter))
+		{
+			for (byte digit : this->argument)
+			{
+				hash = execution::mix_bits(hash ^ digit);
+			}
+		}
+	};
+
+	inline bool operator==(result_cache_key const &left, result_cache_key const &right)
+	{
+		return (left.hash == right.hash) && (left.getter == right.getter) && (left.argument == right.argument);
+	}
+
+	struct result_cache_key_hash
+	{
+		std::size_t operator()(result_cache_key const &key) const
+		{
+			return static_cast<std::size_t>(key.hash);
+		}
+	};
+
+	// The key holds the shape of the argument, not only its bits, so that for example the possibilities of a variant
+	// with the same content get different entries.
+	inline result_cache_key make_result_cache_key(std::size_t getter, values::value const &argument)
+	{
+		std::vector<byte> serialized;
+		file_format::serialize_value(serialized, argument);
+		return result_cache_key(getter, std::move(serialized));
+	}
+
+	inline Si::optional<values::value> copy_result(Si::optional<values::value> const &result)
+	{
+		if (!result)
+		{
+			return Si::none;
+		}
+		return result->copy();
+	}
+
+	// A bounded LRU cache for getter results. The entries are spread over independently locked shards so that
+	// concurrent readers rarely wait for each other. invalidate() makes every entry stale without touching the
+	// shards; stale entries are dropped when they are found. Results computed before an invalidation are not
+	// inserted.
+	struct result_cache
+	{
+		explicit result_cache(std::size_t capacity, std::size_t shard_count = 16)
+		    : m_shards(shard_count)
+		    , m_capacity_per_shard(capacity_per_shard(capacity, shard_count))
+		    , m_generation(0)
+		    , m_hits(0)
+		    , m_misses(0)
+		{
+		}
+
+		Si::optional<Si::optional<values::value>> find(result_cache_key const &key)
+		{
+			shard &owner = shard_for(key);
+			std::uint64_t const generation = m_generation.load();
+			std::lock_guard<std::mutex> lock(owner.mutex);
+			auto const found = owner.index.find(key);
+			if (found == owner.index.end())
+			{
+				++m_misses;
+				return Si::none;
+			}
+			if (found->second->generation != generation)
+			{
+				owner.entries.erase(found->second);
+				owner.index.erase(found);
+				++m_misses;
+				return Si::none;
+			}
+			owner.entries.splice(owner.entries.begin(), owner.entries, found->second);
+			++m_hits;
+			return copy_result(found->second->result);
+		}
+
+		void insert(result_cache_key key, Si::optional<values::value> const &result, std::uint64_t generation)
+		{
+			if (generation != m_generation.load())
+			{
+				return;
+			}
+			shard &owner = shard_for(key);
+			std::lock_guard<std::mutex> lock(owner.mutex);
+			auto const existing = owner.index.find(key);
+			if (existing != owner.index.end())
+			{
+				owner.entries.erase(existing->second);
+				owner.index.erase(existing);
+			}
+			if (owner.entries.size() == m_capacity_per_shard)
+			{
+				owner.index.erase(owner.entries.back().key);
+				owner.entries.pop_back();
+			}
+			owner.entries.emplace_front(key, generation, copy_result(result));
+			owner.index.emplace(std::move(key), owner.entries.begin());
+		}
+
+		std::uint64_t generation() const
+		{
+			return m_generation.load();
+		}
+
+		void invalidate()
+		{
+			++m_generation;
+		}
+
+		std::uint64_t hits() const
+		{
+			return m_hits.load();
+		}
+
+		std::uint64_t misses() const
+		{
+			return m_misses.load();
+		}
+
+	private:
+		static std::size_t capacity_per_shard(std::size_t capacity, std::size_t shard_count)
+		{
+			if (shard_count == 0)
+			{
+				throw std::invalid_argument("result_cache needs at least one shard");
+			}
+			return (std::max)(std::size_t(1), capacity / shard_count);
+		}
+
+		struct entry
+		{
+			result_cache_key key;
+			std::uint64_t generation;
+			Si::optional<values::value> result;
+
+			entry(result_cache_key key, std::uint64_t generation, Si::optional<values::value> result)
+			    : key(std::move(key))
+			    , generation(generation)
+			    , result(std::move(result))
+			{
+			}
+		};
+
+		struct shard
+		{
+			std::mutex mutex;
+			std::list<entry> entries;
+			std::unordered_map<result_cache_key, std::list<entry>::iterator, result_cache_key_hash> index;
+		};
+
+		std::vector<shard> m_shards;
+		std::size_t m_capacity_per_shard;
+		std::atomic<std::uint64_t> m_generation;
+		std::atomic<std::uint64_t> m_hits;
+		std::atomic<std::uint64_t> m_misses;
+
+		shard &shard_for(result_cache_key const &key)
+		{
+			return m_shards[static_cast<std::size_t>(key.hash >> 32u) % m_shards.size()];
+		}
+	};
+
+	template <class Storage>
+	void cache_results(basic_plan<Storage> &plan, std::shared_ptr<result_cache> cache)
+	{
+		typedef typename basic_plan<Storage>::planned_get_function planned_get_function;
+		typedef typename basic_plan<Storage>::planned_set_function planned_set_function;
+		for (std::size_t i = 0; i < plan.gets.size(); ++i)
+		{
+			auto original = Si::to_shared(std::move(plan.gets[i]));
+			plan.gets[i] = planned_get_function(
+			    [original, cache, i](Storage &storage, values::value const &argument) -> Si::optional<values::value>
+			    {
+				    result_cache_key key = make_result_cache_key(i, argument);
+				    Si::optional<Si::optional<values::value>> cached = cache->find(key);
+				    if (cached)
+				    {
+					    return std::move(*cached);
+				    }
+				    std::uint64_t const generation = cache->generation();
+				    Si::optional<values::value> result = (*original)(storage, argument);
+				    cache->insert(std::move(key), result, generation);
+				    return result;
+				});
+		}
+		for (planned_set_function &set : plan.sets)
+		{
+			auto original = Si::to_shared(std::move(set));
+			set = planned_set_function([original, cache](Storage &storage, values::value const &argument)
+			                           {
+				                           values::value result = (*original)(storage, argument);
+				                           cache->invalidate();
+				                           return result;
+				                       });
+		}
+	}
+}
+
+#endif
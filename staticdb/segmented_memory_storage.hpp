@@ -0,0 +1,247 @@
+#ifndef STATICDB_SEGMENTED_MEMORY_STORAGE_HPP
+#define STATICDB_SEGMENTED_MEMORY_STORAGE_HPP
+
+#include <staticdb/storage.hpp>
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <new>
+#include <stdexcept>
+#ifdef _WIN32
+#include <malloc.h>
+#endif
+
+namespace staticdb
+{
+	// In-memory storage made of fixed-size segments. Growing it allocates new segments and never moves the bytes
+	// that are already stored, so appending costs O(1) per byte and there is no peak of twice the size during a
+	// reallocation. Segments are aligned to their size (at most 2 MiB) so that the system can back them with huge
+	// pages.
+	struct segmented_memory_storage
+	{
+		static std::size_t const default_segment_size = std::size_t(1) << 21u;
+
+		struct source
+		{
+			typedef byte element_type;
+
+			explicit source(segmented_memory_storage const &storage, address position)
+			    : m_storage(&storage)
+			    , m_position(position)
+			{
+			}
+
+			Si::iterator_range<element_type const *> map_next(std::size_t size)
+			{
+				Si::iterator_range<element_type const *> const mapped = m_storage->map(m_position, size);
+				m_position += static_cast<address>(mapped.size());
+				return mapped;
+			}
+
+			element_type *copy_next(Si::iterator_range<element_type *> destination)
+			{
+				element_type *i = destination.begin();
+				while (i != destination.end())
+				{
+					Si::iterator_range<element_type const *> const mapped =
+					    map_next(static_cast<std::size_t>(destination.end() - i));
+					if (mapped.empty())
+					{
+						break;
+					}
+					i = std::copy(mapped.begin(), mapped.end(), i);
+				}
+				return i;
+			}
+
+		private:
+			segmented_memory_storage const *m_storage;
+			address m_position;
+		};
+
+		struct sink
+		{
+			typedef byte element_type;
+			typedef Si::success error_type;
+
+			explicit sink(segmented_memory_storage &storage, address position)
+			    : m_storage(&storage)
+			    , m_position(position)
+			{
+			}
+
+			error_type append(Si::iterator_range<element_type const *> data)
+			{
+				m_storage->write(m_position, data.begin(), static_cast<std::size_t>(data.size()));
+				m_position += static_cast<address>(data.size());
+				return error_type();
+			}
+
+		private:
+			segmented_memory_storage *m_storage;
+			address m_position;
+		};
+
+		explicit segmented_memory_storage(std::size_t segment_size = default_segment_size)
+		    : m_segment_size(segment_size)
+		    , m_segment_shift(0)
+		    , m_size(0)
+		{
+			if ((segment_size == 0) || ((segment_size & (segment_size - 1u)) != 0))
+			{
+				throw std::invalid_argument("segmented_memory_storage needs a segment size that is a power of two");
+			}
+			while ((std::size_t(1) << m_segment_shift) != segment_size)
+			{
+				++m_segment_shift;
+			}
+		}
+
+#if SILICIUM_COMPILER_GENERATES_MOVES
+		SILICIUM_DEFAULT_MOVE(segmented_memory_storage)
+#else
+		segmented_memory_storage(segmented_memory_storage &&other) BOOST_NOEXCEPT
+		    : m_segment_size(other.m_segment_size)
+		    , m_segment_shift(other.m_segment_shift)
+		    , m_segments(std::move(other.m_segments))
+		    , m_size(other.m_size)
+		{
+		}
+
+		segmented_memory_storage &operator=(segmented_memory_storage &&other) BOOST_NOEXCEPT
+		{
+			m_segment_size = other.m_segment_size;
+			m_segment_shift = other.m_segment_shift;
+			m_segments = std::move(other.m_segments);
+			m_size = other.m_size;
+			return *this;
+		}
+#endif
+		SILICIUM_DISABLE_COPY(segmented_memory_storage)
+
+		address size() const
+		{
+			return m_size;
+		}
+
+		std::size_t segment_size() const
+		{
+			return m_segment_size;
+		}
+
+		source read_at(address where) const
+		{
+			return source(*this, where);
+		}
+
+		Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+		{
+			Si::iterator_range<byte const *> const first = map(where, length);
+			if (static_cast<std::size_t>(first.size()) == length)
+			{
+				return first;
+			}
+			std::size_t copied = 0;
+			for (;;)
+			{
+				Si::iterator_range<byte const *> const piece = map(where + copied, length - copied);
+				if (piece.empty())
+				{
+					break;
+				}
+				std::memcpy(scratch + copied, piece.begin(), static_cast<std::size_t>(piece.size()));
+				copied += static_cast<std::size_t>(piece.size());
+			}
+			return Si::make_iterator_range<byte const *>(scratch, scratch + copied);
+		}
+
+		sink write_at(address where)
+		{
+			if (where > m_size)
+			{
+				reserve(where);
+				m_size = where;
+			}
+			return sink(*this, where);
+		}
+
+	private:
+		struct aligned_free
+		{
+			void operator()(byte *allocation) const
+			{
+#ifdef _WIN32
+				_aligned_free(allocation);
+#else
+				std::free(allocation);
+#endif
+			}
+		};
+
+		typedef std::unique_ptr<byte, aligned_free> segment;
+
+		std::size_t m_segment_size;
+		std::size_t m_segment_shift;
+		std::vector<segment> m_segments;
+		address m_size;
+
+		Si::iterator_range<byte const *> map(address where, std::size_t length) const
+		{
+			if (where >= m_size)
+			{
+				return Si::iterator_range<byte const *>();
+			}
+			address const index = where >> m_segment_shift;
+			std::size_t const in_segment = static_cast<std::size_t>(where & (m_segment_size - 1u));
+			std::size_t const mapped = static_cast<std::size_t>(
+			    (std::min)(static_cast<address>((std::min)(length, m_segment_size - in_segment)), m_size - where));
+			byte const *const begin = m_segments[static_cast<std::size_t>(index)].get() + in_segment;
+			return Si::make_iterator_range(begin, begin + mapped);
+		}
+
+		void reserve(address size)
+		{
+			while ((static_cast<address>(m_segments.size()) << m_segment_shift) < size)
+			{
+				std::size_t const alignment =
+				    (std::max)(sizeof(void *), (std::min)(m_segment_size, std::size_t(1) << 21u));
+				void *allocation = nullptr;
+#ifdef _WIN32
+				allocation = _aligned_malloc(m_segment_size, alignment);
+#else
+				if (posix_memalign(&allocation, alignment, m_segment_size) != 0)
+				{
+					allocation = nullptr;
+				}
+#endif
+				if (!allocation)
+				{
+					throw std::bad_alloc();
+				}
+				std::memset(allocation, 0, m_segment_size);
+				segment added(static_cast<byte *>(allocation));
+				m_segments.emplace_back(std::move(added));
+			}
+		}
+
+		void write(address where, byte const *data, std::size_t size)
+		{
+			address const end = where + size;
+			reserve(end);
+			while (size > 0)
+			{
+				std::size_t const in_segment = static_cast<std::size_t>(where & (m_segment_size - 1u));
+				std::size_t const taking = (std::min)(size, m_segment_size - in_segment);
+				std::memcpy(m_segments[static_cast<std::size_t>(where >> m_segment_shift)].get() + in_segment, data,
+				            taking);
+				data += taking;
+				where += taking;
+				size -= taking;
+			}
+			m_size = (std::max)(m_size, end);
+		}
+	};
+}
+
+#endif
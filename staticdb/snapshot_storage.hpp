@@ -0,0 +1,433 @@
+#ifndef STATICDB_SNAPSHOT_STORAGE_HPP
+#define STATICDB_SNAPSHOT_STORAGE_HPP
+
+#include <staticdb/storage.hpp>
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+
+namespace staticdb
+{
+	// In-memory storage with snapshot isolation. The content is a table of fixed-size pages. A writer copies every
+	// page before it changes it and publishes the new page table atomically on commit, so a snapshot keeps seeing
+	// the pages that were current when it was taken, for as long as it lives. Readers never lock: they announce the
+	// epoch in which they loaded the page table in a slot, and old page tables and pages are freed once no slot
+	// announces an epoch from before they were replaced. Only one writer exists at a time.
+	struct snapshot_storage
+	{
+		struct version
+		{
+			std::vector<byte *> pages;
+			address size;
+
+			version()
+			    : size(0)
+			{
+			}
+		};
+
+		struct source
+		{
+			typedef byte element_type;
+
+			explicit source(snapshot_storage const &storage, version const &content, address position)
+			    : m_storage(&storage)
+			    , m_content(&content)
+			    , m_position(position)
+			{
+			}
+
+			Si::iterator_range<element_type const *> map_next(std::size_t size)
+			{
+				Si::iterator_range<element_type const *> const mapped = m_storage->map(*m_content, m_position, size);
+				m_position += static_cast<address>(mapped.size());
+				return mapped;
+			}
+
+			element_type *copy_next(Si::iterator_range<element_type *> destination)
+			{
+				element_type *i = destination.begin();
+				while (i != destination.end())
+				{
+					Si::iterator_range<element_type const *> const mapped =
+					    map_next(static_cast<std::size_t>(destination.end() - i));
+					if (mapped.empty())
+					{
+						break;
+					}
+					i = std::copy(mapped.begin(), mapped.end(), i);
+				}
+				return i;
+			}
+
+		private:
+			snapshot_storage const *m_storage;
+			version const *m_content;
+			address m_position;
+		};
+
+		// A consistent, read-only view of the storage. The pages it refers to stay valid until it is destroyed.
+		struct snapshot
+		{
+			snapshot(snapshot_storage const &storage, std::size_t slot, version const &content)
+			    : m_storage(&storage)
+			    , m_slot(slot)
+			    , m_content(&content)
+			{
+			}
+
+			~snapshot()
+			{
+				if (m_storage)
+				{
+					m_storage->m_slots[m_slot].store(0);
+				}
+			}
+
+			snapshot(snapshot &&other) BOOST_NOEXCEPT
+			    : m_storage(other.m_storage)
+			    , m_slot(other.m_slot)
+			    , m_content(other.m_content)
+			{
+				other.m_storage = nullptr;
+			}
+
+			SILICIUM_DISABLE_COPY(snapshot)
+
+			address size() const
+			{
+				return m_content->size;
+			}
+
+			source read_at(address where) const
+			{
+				return source(*m_storage, *m_content, where);
+			}
+
+			Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+			{
+				return m_storage->read_span(*m_content, where, length, scratch);
+			}
+
+		private:
+			snapshot_storage const *m_storage;
+			std::size_t m_slot;
+			version const *m_content;
+		};
+
+		struct writer;
+
+		struct sink
+		{
+			typedef byte element_type;
+			typedef Si::success error_type;
+
+			explicit sink(writer &destination, address position)
+			    : m_destination(&destination)
+			    , m_position(position)
+			{
+			}
+
+			error_type append(Si::iterator_range<element_type const *> data)
+			{
+				m_destination->write(m_position, data.begin(), static_cast<std::size_t>(data.size()));
+				m_position += static_cast<address>(data.size());
+				return error_type();
+			}
+
+		private:
+			writer *m_destination;
+			address m_position;
+		};
+
+		// Changes a private copy of the page table. Readers see the changes after commit(). Destroying a writer
+		// without committing discards its changes.
+		struct writer
+		{
+			explicit writer(snapshot_storage &storage)
+			    : m_storage(&storage)
+			    , m_lock(storage.m_writing)
+			    , m_draft(Si::make_unique<version>(*storage.m_current.load()))
+			    , m_owned(m_draft->pages.size(), false)
+			{
+			}
+
+			writer(writer &&other) BOOST_NOEXCEPT
+			    : m_storage(other.m_storage)
+			    , m_lock(std::move(other.m_lock))
+			    , m_draft(std::move(other.m_draft))
+			    , m_owned(std::move(other.m_owned))
+			    , m_replaced_pages(std::move(other.m_replaced_pages))
+			{
+			}
+
+			~writer()
+			{
+				if (!m_draft)
+				{
+					return;
+				}
+				for (std::size_t i = 0; i < m_owned.size(); ++i)
+				{
+					if (m_owned[i])
+					{
+						delete[] m_draft->pages[i];
+					}
+				}
+			}
+
+			SILICIUM_DISABLE_COPY(writer)
+
+			address size() const
+			{
+				return m_draft->size;
+			}
+
+			source read_at(address where) const
+			{
+				return source(*m_storage, *m_draft, where);
+			}
+
+			Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+			{
+				return m_storage->read_span(*m_draft, where, length, scratch);
+			}
+
+			sink write_at(address where)
+			{
+				if (where > m_draft->size)
+				{
+					resize(where);
+				}
+				return sink(*this, where);
+			}
+
+			void write(address where, byte const *data, std::size_t size)
+			{
+				address const end = where + size;
+				resize((std::max)(end, m_draft->size));
+				std::size_t const page_size = m_storage->m_page_size;
+				while (size > 0)
+				{
+					std::size_t const page = static_cast<std::size_t>(where / page_size);
+					std::size_t const in_page = static_cast<std::size_t>(where % page_size);
+					std::size_t const taking = (std::min)(size, page_size - in_page);
+					std::memcpy(writable_page(page) + in_page, data, taking);
+					data += taking;
+					where += taking;
+					size -= taking;
+				}
+			}
+
+			void commit()
+			{
+				version const *const replaced = m_storage->m_current.exchange(m_draft.release());
+				std::uint64_t const epoch = m_storage->m_epoch.fetch_add(1);
+				m_storage->m_retired.emplace_back(epoch, replaced, std::move(m_replaced_pages));
+				m_replaced_pages.clear();
+				m_owned.clear();
+				m_storage->reclaim();
+				m_draft = Si::make_unique<version>(*m_storage->m_current.load());
+				m_owned.assign(m_draft->pages.size(), false);
+			}
+
+		private:
+			snapshot_storage *m_storage;
+			std::unique_lock<std::mutex> m_lock;
+			std::unique_ptr<version> m_draft;
+			std::vector<bool> m_owned;
+			std::vector<byte *> m_replaced_pages;
+
+			void resize(address size)
+			{
+				std::size_t const page_size = m_storage->m_page_size;
+				std::size_t const page_count = static_cast<std::size_t>((size + page_size - 1u) / page_size);
+				while (m_draft->pages.size() < page_count)
+				{
+					m_draft->pages.emplace_back(new byte[page_size]());
+					m_owned.push_back(true);
+				}
+				m_draft->size = size;
+			}
+
+			byte *writable_page(std::size_t page)
+			{
+				if (!m_owned[page])
+				{
+					byte *const copy = new byte[m_storage->m_page_size];
+					std::memcpy(copy, m_draft->pages[page], m_storage->m_page_size);
+					m_replaced_pages.emplace_back(m_draft->pages[page]);
+					m_draft->pages[page] = copy;
+					m_owned[page] = true;
+				}
+				return m_draft->pages[page];
+			}
+		};
+
+		explicit snapshot_storage(std::size_t page_size = 4096, std::size_t max_readers = 128)
+		    : m_page_size(page_size)
+		    , m_slots(max_readers)
+		    , m_epoch(1)
+		    , m_current(new version)
+		{
+			if (page_size == 0)
+			{
+				throw std::invalid_argument("snapshot_storage needs a page size");
+			}
+			if (max_readers == 0)
+			{
+				throw std::invalid_argument("snapshot_storage needs at least one reader slot");
+			}
+			for (std::atomic<std::uint64_t> &slot : m_slots)
+			{
+				slot.store(0);
+			}
+		}
+
+		~snapshot_storage()
+		{
+			for (retired &old : m_retired)
+			{
+				free_retired(old);
+			}
+			std::unique_ptr<version const> const current(m_current.load());
+			for (byte *page : current->pages)
+			{
+				delete[] page;
+			}
+		}
+
+		SILICIUM_DISABLE_COPY(snapshot_storage)
+
+		// Takes a snapshot of the last committed content without locking. Waits while all reader slots are busy.
+		snapshot read() const
+		{
+			for (std::size_t attempt = 0;; ++attempt)
+			{
+				std::uint64_t const epoch = m_epoch.load();
+				for (std::size_t i = 0; i < m_slots.size(); ++i)
+				{
+					std::size_t const slot = (attempt + i) % m_slots.size();
+					std::uint64_t expected = 0;
+					if (m_slots[slot].compare_exchange_strong(expected, epoch))
+					{
+						return snapshot(*this, slot, *m_current.load());
+					}
+				}
+				std::this_thread::yield();
+			}
+		}
+
+		writer write()
+		{
+			return writer(*this);
+		}
+
+		// Frees the replaced versions that no snapshot can see anymore. commit() does this, too. Waits for the
+		// current writer.
+		void collect()
+		{
+			std::lock_guard<std::mutex> lock(m_writing);
+			reclaim();
+		}
+
+		// The number of replaced versions that still wait to be freed. Waits for the current writer.
+		std::size_t retired_versions() const
+		{
+			std::lock_guard<std::mutex> lock(m_writing);
+			return m_retired.size();
+		}
+
+	private:
+		struct retired
+		{
+			std::uint64_t epoch;
+			version const *content;
+			std::vector<byte *> pages;
+
+			retired(std::uint64_t epoch, version const *content, std::vector<byte *> pages)
+			    : epoch(epoch)
+			    , content(content)
+			    , pages(std::move(pages))
+			{
+			}
+		};
+
+		std::size_t m_page_size;
+		mutable std::vector<std::atomic<std::uint64_t>> m_slots;
+		std::atomic<std::uint64_t> m_epoch;
+		std::atomic<version const *> m_current;
+		mutable std::mutex m_writing;
+		std::vector<retired> m_retired;
+
+		Si::iterator_range<byte const *> map(version const &content, address where, std::size_t length) const
+		{
+			if (where >= content.size)
+			{
+				return Si::iterator_range<byte const *>();
+			}
+			std::size_t const in_page = static_cast<std::size_t>(where % m_page_size);
+			std::size_t const mapped = static_cast<std::size_t>(
+			    (std::min)(static_cast<address>((std::min)(length, m_page_size - in_page)), content.size - where));
+			byte const *const begin = content.pages[static_cast<std::size_t>(where / m_page_size)] + in_page;
+			return Si::make_iterator_range(begin, begin + mapped);
+		}
+
+		Si::iterator_range<byte const *> read_span(version const &content, address where, std::size_t length,
+		                                           byte *scratch) const
+		{
+			Si::iterator_range<byte const *> const first = map(content, where, length);
+			if (static_cast<std::size_t>(first.size()) == length)
+			{
+				return first;
+			}
+			std::size_t copied = 0;
+			for (;;)
+			{
+				Si::iterator_range<byte const *> const piece = map(content, where + copied, length - copied);
+				if (piece.empty())
+				{
+					break;
+				}
+				std::memcpy(scratch + copied, piece.begin(), static_cast<std::size_t>(piece.size()));
+				copied += static_cast<std::size_t>(piece.size());
+			}
+			return Si::make_iterator_range<byte const *>(scratch, scratch + copied);
+		}
+
+		static void free_retired(retired &old)
+		{
+			delete old.content;
+			for (byte *page : old.pages)
+			{
+				delete[] page;
+			}
+		}
+
+		void reclaim()
+		{
+			std::uint64_t oldest_reader = m_epoch.load();
+			for (std::atomic<std::uint64_t> const &slot : m_slots)
+			{
+				std::uint64_t const announced = slot.load();
+				if (announced != 0)
+				{
+					oldest_reader = (std::min)(oldest_reader, announced);
+				}
+			}
+			auto const still_visible =
+			    std::partition(m_retired.begin(), m_retired.end(), [oldest_reader](retired const &old)
+			                   {
+				                   return old.epoch < oldest_reader;
+				               });
+			std::for_each(m_retired.begin(), still_visible, free_retired);
+			m_retired.erase(m_retired.begin(), still_visible);
+		}
+	};
+}
+
+#endif
@@ -0,0 +1,98 @@
+#ifndef STATICDB_SORT_HPP
+#define STATICDB_SORT_HPP
+
+#include <staticdb/address.hpp>
+#include <algorithm>
+#include <array>
+#include <vector>
+
+namespace staticdb
+{
+	namespace execution
+	{
+		struct sort_entry
+		{
+			std::uint64_t key;
+			address index;
+
+			sort_entry()
+			    : key(0)
+			    , index(0)
+			{
+			}
+
+			sort_entry(std::uint64_t key, address index)
+			    : key(key)
+			    , index(index)
+			{
+			}
+		};
+
+		inline bool operator<(sort_entry const &left, sort_entry const &right)
+		{
+			return (left.key < right.key) || ((left.key == right.key) && (left.index < right.index));
+		}
+
+		// Stable LSD radix sort with 8 bit digits. Only the lowest key_bits bits of the keys are looked at and
+		// digits that are the same in every entry are skipped.
+		inline void radix_sort(std::vector<sort_entry> &entries, address key_bits)
+		{
+			std::vector<sort_entry> buffer(entries.size());
+			for (address shift = 0; shift < key_bits; shift += 8)
+			{
+				std::array<std::size_t, 256> counts;
+				counts.fill(0);
+				for (sort_entry const &entry : entries)
+				{
+					++counts[static_cast<std::size_t>((entry.key >> shift) & 0xffu)];
+				}
+				if (std::find(counts.begin(), counts.end(), entries.size()) != counts.end())
+				{
+					continue;
+				}
+				std::size_t offset = 0;
+				for (std::size_t &count : counts)
+				{
+					std::size_t const digit_count = count;
+					count = offset;
+					offset += digit_count;
+				}
+				for (sort_entry const &entry : entries)
+				{
+					buffer[counts[static_cast<std::size_t>((entry.key >> shift) & 0xffu)]++] = entry;
+				}
+				entries.swap(buffer);
+			}
+		}
+
+		// Keeps the count smallest entries in ascending order. A bounded max-heap makes this O(n log count).
+		inline void top_k(std::vector<sort_entry> &entries, std::size_t count)
+		{
+			if (count >= entries.size())
+			{
+				std::sort(entries.begin(), entries.end());
+				return;
+			}
+			std::vector<sort_entry> heap;
+			heap.reserve(count);
+			for (sort_entry const &entry : entries)
+			{
+				if (heap.size() < count)
+				{
+					heap.emplace_back(entry);
+					std::push_heap(heap.begin(), heap.end());
+				}
+				else if (!heap.empty() && (entry < heap.front()))
+				{
+					std::pop_heap(heap.begin(), heap.end());
+					heap.back() = entry;
+					std::push_heap(heap.begin(), heap.end());
+				}
+			}
+			std::sort_heap(heap.begin(), heap.end());
+			entries.swap(heap);
+		}
+	}
+}
+
+#endif
@@ -1,17 +1,37 @@
 #ifndef STATICDB_STORAGE_HPP
 #define STATICDB_STORAGE_HPP
 
+#include <type_traits>
+#include <utility>
 #include <vector>
 #include <staticdb/address.hpp>
 #include <staticdb/byte.hpp>
 #include <silicium/trait.hpp>
 #include <silicium/source/memory_source.hpp>
 #include <silicium/success.hpp>
+#include <boost/concept_check.hpp>
 
 namespace staticdb
 {
+	// read_span returns up to length bytes beginning at where. A storage that keeps its bytes contiguous in memory
+	// returns a range into that memory. Any other storage copies the bytes into scratch, which has room for length
+	// bytes. The range is shorter than length only at the end of the storage.
 	template <class ReadSource, class WriteSink>
-	SILICIUM_TRAIT(Storage, ((read_at, (1, (address)), ReadSource &))((write_at, (1, (address)), WriteSink &)))
+	SILICIUM_TRAIT(Storage, ((read_at, (1, (address)), ReadSource &))(
+	                            (read_span, (3, (address, std::size_t, byte *)), Si::iterator_range<byte const *>))(
+	                            (write_at, (1, (address)), WriteSink &)))
+
+	// Whether the plans for a storage type can have setters. Read-only views like const storages have no write_at.
+	template <class Storage, class = void>
+	struct is_writable_storage : std::false_type
+	{
+	};
+
+	template <class Storage>
+	struct is_writable_storage<Storage, decltype(void(std::declval<Storage &>().write_at(address())))>
+	    : std::true_type
+	{
+	};
 
 	template <class Element>
 	struct vector_sink
@@ -44,7 +64,7 @@ namespace staticdb
 	{
 		std::vector<byte> memory;
 
-		Si::memory_source<byte> read_at(address where)
+		Si::memory_source<byte> read_at(address where) const
 		{
 			if (where >= (std::numeric_limits<std::size_t>::max)())
 			{
@@ -55,6 +75,18 @@ namespace staticdb
 			    Si::make_iterator_range(memory.data() + limited_where, memory.data() + memory.size()));
 		}
 
+		Si::iterator_range<byte const *> read_span(address where, std::size_t length, byte *scratch) const
+		{
+			boost::ignore_unused_variable_warning(scratch);
+			if (where >= (std::numeric_limits<std::size_t>::max)())
+			{
+				throw std::invalid_argument("read_span where address out of range");
+			}
+			std::size_t const begin = (std::min)(static_cast<std::size_t>(where), memory.size());
+			std::size_t const end = begin + (std::min)(length, memory.size() - begin);
+			return Si::make_iterator_range(memory.data() + begin, memory.data() + end);
+		}
+
 		vector_sink<byte> write_at(address where)
 		{
 			if (where >= (std::numeric_limits<std::size_t>::max)())
@@ -0,0 +1,202 @@
+#ifndef STATICDB_THREAD_POOL_HPP
+#define STATICDB_THREAD_POOL_HPP
+
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace staticdb
+{
+	// Runs one batch of numbered tasks at a time. Every worker, and the thread that submitted the batch, starts
+	// with a contiguous slice of the task numbers and steals from the back of the other slices when its own slice
+	// is done.
+	struct work_stealing_pool
+	{
+		explicit work_stealing_pool(std::size_t thread_count)
+		    : m_task(nullptr)
+		    , m_batch(0)
+		    , m_remaining(0)
+		    , m_stopping(false)
+		{
+			for (std::size_t i = 0; i <= thread_count; ++i)
+			{
+				m_queues.emplace_back(new queue);
+			}
+			for (std::size_t i = 1; i <= thread_count; ++i)
+			{
+				m_threads.emplace_back([this, i]()
+				                       {
+					                       work(i);
+					                   });
+			}
+		}
+
+		~work_stealing_pool()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_state_mutex);
+				m_stopping = true;
+			}
+			m_wake.notify_all();
+			for (std::thread &thread : m_threads)
+			{
+				thread.join();
+			}
+		}
+
+		std::size_t thread_count() const
+		{
+			return m_threads.size();
+		}
+
+		// Calls task(i) for every i in [0, count) and returns true when all calls have finished. Returns false
+		// without calling the task when another thread is using the pool at the moment.
+		bool try_run(std::size_t count, std::function<void(std::size_t)> const &task)
+		{
+			std::unique_lock<std::mutex> batch_lock(m_batch_mutex, std::try_to_lock);
+			if (!batch_lock.owns_lock())
+			{
+				return false;
+			}
+			if (count == 0)
+			{
+				return true;
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_state_mutex);
+				m_task = &task;
+				m_remaining = count;
+				m_error = nullptr;
+			}
+			for (std::size_t i = 0; i < m_queues.size(); ++i)
+			{
+				std::lock_guard<std::mutex> lock(m_queues[i]->mutex);
+				for (std::size_t item = (count * i) / m_queues.size(), end = (count * (i + 1)) / m_queues.size();
+				     item < end; ++item)
+				{
+					m_queues[i]->items.push_back(item);
+				}
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_state_mutex);
+				++m_batch;
+			}
+			m_wake.notify_all();
+			drain(0);
+			std::exception_ptr error;
+			{
+				std::unique_lock<std::mutex> lock(m_state_mutex);
+				m_done.wait(lock, [this]()
+				            {
+					            return m_remaining == 0;
+					        });
+				m_task = nullptr;
+				error = m_error;
+			}
+			if (error)
+			{
+				std::rethrow_exception(error);
+			}
+			return true;
+		}
+
+	private:
+		struct queue
+		{
+			std::mutex mutex;
+			std::deque<std::size_t> items;
+		};
+
+		std::vector<std::unique_ptr<queue>> m_queues;
+		std::vector<std::thread> m_threads;
+		std::mutex m_batch_mutex;
+		std::mutex m_state_mutex;
+		std::condition_variable m_wake;
+		std::condition_variable m_done;
+		std::function<void(std::size_t)> const *m_task;
+		std::uint64_t m_batch;
+		std::size_t m_remaining;
+		bool m_stopping;
+		std::exception_ptr m_error;
+
+		void work(std::size_t self)
+		{
+			std::uint64_t seen_batch = 0;
+			for (;;)
+			{
+				{
+					std::unique_lock<std::mutex> lock(m_state_mutex);
+					m_wake.wait(lock, [this, seen_batch]()
+					            {
+						            return m_stopping || (m_batch != seen_batch);
+						        });
+					if (m_stopping)
+					{
+						return;
+					}
+					seen_batch = m_batch;
+				}
+				drain(self);
+			}
+		}
+
+		bool take(std::size_t self, std::size_t &item)
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_queues[self]->mutex);
+				if (!m_queues[self]->items.empty())
+				{
+					item = m_queues[self]->items.front();
+					m_queues[self]->items.pop_front();
+					return true;
+				}
+			}
+			for (std::size_t i = 1; i < m_queues.size(); ++i)
+			{
+				queue &victim = *m_queues[(self + i) % m_queues.size()];
+				std::lock_guard<std::mutex> lock(victim.mutex);
+				if (!victim.items.empty())
+				{
+					item = victim.items.back();
+					victim.items.pop_back();
+					return true;
+				}
+			}
+			return false;
+		}
+
+		void drain(std::size_t self)
+		{
+			std::size_t item = 0;
+			while (take(self, item))
+			{
+				std::exception_ptr error;
+				try
+				{
+					(*m_task)(item);
+				}
+				catch (...)
+				{
+					error = std::current_exception();
+				}
+				std::lock_guard<std::mutex> lock(m_state_mutex);
+				if (error && !m_error)
+				{
+					m_error = error;
+				}
+				--m_remaining;
+				if (m_remaining == 0)
+				{
+					m_done.notify_all();
+				}
+			}
+		}
+	};
+}
+
+#endif
@@ -117,14 +117,25 @@ namespace staticdb
 		template <class Value>
 		struct basic_variant
 		{
+			std::size_t which;
 			std::unique_ptr<Value> content;
 
 			basic_variant()
+			    : which(0)
 			{
 			}
 
 			explicit basic_variant(std::unique_ptr<Value> content)
-			    : content(std::move(content))
+			    : which(0)
+			    , content(std::move(content))
+			{
+				assert(this->content);
+			}
+
+			// which is the index of the possibility of the variant type that content belongs to.
+			basic_variant(std::size_t which, std::unique_ptr<Value> content)
+			    : which(which)
+			    , content(std::move(content))
 			{
 				assert(this->content);
 			}
@@ -133,6 +144,7 @@ namespace staticdb
 			{
 				assert(content);
 				basic_variant result;
+				result.which = which;
 				result.content = Si::to_unique(content->copy());
 				return result;
 			}
@@ -140,12 +152,13 @@ namespace staticdb
 #if SILICIUM_COMPILER_GENERATES_MOVES
 			SILICIUM_DEFAULT_MOVE(basic_variant)
 #else
-			basic_variant(basic_variant &&other) BOOST_NOEXCEPT : content(std::move(other.content))
+			basic_variant(basic_variant &&other) BOOST_NOEXCEPT : which(other.which), content(std::move(other.content))
 			{
 			}
 
 			basic_variant &operator=(basic_variant &&other) BOOST_NOEXCEPT
 			{
+				which = other.which;
 				content = std::move(other.content);
 				return *this;
 			}
@@ -298,9 +311,11 @@ namespace staticdb
 				                       tuple const *const second_tuple = Si::try_get_ptr<tuple>(second);
 				                       return second_tuple && (*second_tuple == first_tuple);
 				                   },
-			                       [](variant const &) -> bool
+			                       [&second](variant const &first_variant) -> bool
 			                       {
-				                       throw std::logic_error("not implemented");
+				                       variant const *const second_variant = Si::try_get_ptr<variant>(second);
+				                       return second_variant && (second_variant->which == first_variant.which) &&
+				                              (*second_variant->content == *first_variant.content);
 				                   },
 			                       [](closure const &) -> bool
 			                       {
@@ -354,16 +369,12 @@ namespace staticdb
 
 		inline variant make_some(value content)
 		{
-			variant result;
-			result.content = Si::to_unique(std::move(content));
-			return result;
+			return variant(1, Si::to_unique(std::move(content)));
 		}
 
 		inline variant make_none()
 		{
-			variant result;
-			result.content = Si::make_unique<value>(unit());
-			return result;
+			return variant(0, Si::make_unique<value>(unit()));
 		}
 
 		inline bool conforms_to_type(value const &object, types::type const &expected)
@@ -420,14 +431,12 @@ namespace staticdb
 				                       {
 					                       return false;
 				                       }
-				                       for (types::type const &possibility : expected_variant->possibilities)
+				                       if (value.which >= expected_variant->possibilities.size())
 				                       {
-					                       if (conforms_to_type(*value.content, possibility))
-					                       {
-						                       return true;
-					                       }
+					                       return false;
 				                       }
-				                       return false;
+				                       return conforms_to_type(*value.content,
+				                                               expected_variant->possibilities[value.which]);
 				                   },
 			                       [&expected](closure const &) -> bool
 			                       {
@@ -0,0 +1,255 @@
+#ifndef STATICDB_ZONE_MAP_HPP
+#define STATICDB_ZONE_MAP_HPP
+
+#include <staticdb/bit_sink.hpp>
+#include <staticdb/packed_key.hpp>
+#include <array>
+
+namespace staticdb
+{
+	address const zone_map_block_length = 4096;
+	std::size_t const zone_bloom_words = 8;
+	std::size_t const zone_bloom_probes = 3;
+
+	// The smallest and the largest value of a field in a block of elements and a Bloom filter of its values. A zone
+	// of a block without elements has a minimum above its maximum.
+	struct zone
+	{
+		std::uint64_t minimum;
+		std::uint64_t maximum;
+		std::array<std::uint64_t, zone_bloom_words> bloom;
+
+		zone()
+		    : minimum(~std::uint64_t(0))
+		    , maximum(0)
+		{
+			bloom.fill(0);
+		}
+
+		void add(std::uint64_t value)
+		{
+			minimum = (std::min)(minimum, value);
+			maximum = (std::max)(maximum, value);
+			std::uint64_t const hash = execution::mix_bits(value);
+			for (std::size_t i = 0; i < zone_bloom_probes; ++i)
+			{
+				std::size_t const bit = bloom_bit(hash, i);
+				bloom[bit / 64u] |= std::uint64_t(1) << (bit % 64u);
+			}
+		}
+
+		// Whether a value in [low, high] can be in the block.
+		bool may_overlap(std::uint64_t low, std::uint64_t high) const
+		{
+			return (low <= maximum) && (high >= minimum);
+		}
+
+		bool may_contain(std::uint64_t value) const
+		{
+			if (!may_overlap(value, value))
+			{
+				return false;
+			}
+			std::uint64_t const hash = execution::mix_bits(value);
+			for (std::size_t i = 0; i < zone_bloom_probes; ++i)
+			{
+				std::size_t const bit = bloom_bit(hash, i);
+				if (((bloom[bit / 64u] >> (bit % 64u)) & 1u) == 0)
+				{
+					return false;
+				}
+			}
+			return true;
+		}
+
+	private:
+		static std::size_t bloom_bit(std::uint64_t hash, std::size_t probe)
+		{
+			return static_cast<std::size_t>((hash >> (probe * 16u)) % (zone_bloom_words * 64u));
+		}
+	};
+
+	// The bit ranges of the bitsets of at most 64 bits in an element of a fixed size. Bitsets in variants are left
+	// out because where they are depends on the tag.
+	inline void find_zone_fields(layouts::layout const &element, address offset,
+	                             std::vector<execution::bit_range> &fields)
+	{
+		layouts::bitset const *const bits = Si::try_get_ptr<layouts::bitset>(element.as_variant());
+		if (bits)
+		{
+			if ((bits->length > 0) && (bits->length <= 64u))
+			{
+				fields.emplace_back(offset, bits->length);
+			}
+			return;
+		}
+		layouts::tuple const *const tuple_ = Si::try_get_ptr<layouts::tuple>(element.as_variant());
+		if (!tuple_)
+		{
+			return;
+		}
+		for (layouts::layout const &part : tuple_->elements)
+		{
+			if (!layouts::has_fixed_size(part))
+			{
+				return;
+			}
+			find_zone_fields(part, offset, fields);
+			offset += *layouts::layout_size_in_bits(part).value();
+		}
+	}
+
+	// Zones of every field for each block of block_length elements of an array. A filter that compares a field with a
+	// constant skips the blocks whose zones exclude the constant.
+	struct zone_map
+	{
+		address block_length;
+		address length;
+		std::vector<execution::bit_range> fields;
+
+		// the zones of the first block, then the ones of the second block and so on
+		std::vector<zone> zones;
+
+		zone_map(address block_length, std::vector<execution::bit_range> fields)
+		    : block_length(block_length)
+		    , length(0)
+		    , fields(std::move(fields))
+		{
+			if (block_length == 0)
+			{
+				throw std::invalid_argument("zone_map needs a block length");
+			}
+		}
+
+		address block_count() const
+		{
+			return (length + block_length - 1u) / block_length;
+		}
+
+		zone const &at(address block, std::size_t field) const
+		{
+			return zones[static_cast<std::size_t>(block * fields.size()) + field];
+		}
+
+		// Adds the values of the fields of the next element.
+		void push_back(std::uint64_t const *values)
+		{
+			if ((length % block_length) == 0)
+			{
+				zones.resize(zones.size() + fields.size());
+			}
+			zone *const block = zones.data() + (zones.size() - fields.size());
+			for (std::size_t i = 0; i < fields.size(); ++i)
+			{
+				block[i].add(values[i]);
+			}
+			++length;
+		}
+
+		// Adds the values of the fields of an element that was overwritten to the zones of its block. The zones only
+		// grow, so they still cover the value that the element had before.
+		void widen(address index, std::uint64_t const *values)
+		{
+			if (index >= length)
+			{
+				throw std::invalid_argument("zone_map::widen called with index out of range");
+			}
+			zone *const block = zones.data() + static_cast<std::size_t>((index / block_length) * fields.size());
+			for (std::size_t i = 0; i < fields.size(); ++i)
+			{
+				block[i].add(values[i]);
+			}
+		}
+
+		Si::optional<std::size_t> find_field(std::vector<execution::bit_range> const &field) const
+		{
+			if (field.size() != 1)
+			{
+				return Si::none;
+			}
+			auto const found = std::find(fields.begin(), fields.end(), field.front());
+			if (found == fields.end())
+			{
+				return Si::none;
+			}
+			return static_cast<std::size_t>(found - fields.begin());
+		}
+
+		std::size_t memory_in_bytes() const
+		{
+			return (fields.capacity() * sizeof(execution::bit_range)) + (zones.capacity() * sizeof(zone));
+		}
+	};
+
+	// Writes [block length][length][field count][offset and length of every field][minimum, maximum and Bloom
+	// filter of every zone], each as 64 bits.
+	inline void serialize_zone_map(bit_buffer &destination, zone_map const &zones)
+	{
+		destination.append_bits(zones.block_length, 64);
+		destination.append_bits(zones.length, 64);
+		destination.append_bits(zones.fields.size(), 64);
+		for (execution::bit_range const &field : zones.fields)
+		{
+			destination.append_bits(field.offset, 64);
+			destination.append_bits(field.length, 64);
+		}
+		for (zone const &block : zones.zones)
+		{
+			destination.append_bits(block.minimum, 64);
+			destination.append_bits(block.maximum, 64);
+			for (std::uint64_t word : block.bloom)
+			{
+				destination.append_bits(word, 64);
+			}
+		}
+	}
+
+	// The zone maps of the arrays of a storage by the bit address where an array begins. Setters widen the zones
+	// of the elements that they overwrite, so they must not run at the same time as getters that use the set.
+	struct zone_map_set
+	{
+		void add(address array_begin, std::shared_ptr<zone_map> zones)
+		{
+			m_maps.emplace_back(array_begin, std::move(zones));
+		}
+
+		zone_map *find(address array_begin)
+		{
+			for (auto const &entry : m_maps)
+			{
+				if (entry.first == array_begin)
+				{
+					return entry.second.get();
+				}
+			}
+			return nullptr;
+		}
+
+		zone_map const *find(address array_begin) const
+		{
+			for (auto const &entry : m_maps)
+			{
+				if (entry.first == array_begin)
+				{
+					return entry.second.get();
+				}
+			}
+			return nullptr;
+		}
+
+		std::size_t memory_in_bytes() const
+		{
+			std::size_t bytes = 0;
+			for (auto const &entry : m_maps)
+			{
+				bytes += entry.second->memory_in_bytes();
+			}
+			return bytes;
+		}
+
+	private:
+		std::vector<std::pair<address, std::shared_ptr<zone_map>>> m_maps;
+	};
+}
+
+#endif
@@ -0,0 +1,164 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/async_plan.hpp>
+#include <staticdb/file_storage.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include <chrono>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	using staticdb_tests::temporary_file;
+
+	// Holds back every read until two reads wait at the same time. With a single thread running the getters that
+	// happens only if a getter is suspended while its read is pending.
+	struct gated_storage
+	{
+		staticdb::memory_storage const *memory;
+		mutable std::mutex mutex;
+		mutable std::condition_variable opened;
+		mutable std::size_t waiting;
+		mutable bool open;
+		mutable bool timed_out;
+
+		explicit gated_storage(staticdb::memory_storage const &memory)
+		    : memory(&memory)
+		    , waiting(0)
+		    , open(false)
+		    , timed_out(false)
+		{
+		}
+
+		Si::memory_source<staticdb::byte> read_at(staticdb::address where) const
+		{
+			return memory->read_at(where);
+		}
+
+		Si::iterator_range<staticdb::byte const *> read_span(staticdb::address where, std::size_t length,
+		                                                      staticdb::byte *scratch) const
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			++waiting;
+			if (waiting >= 2)
+			{
+				open = true;
+				opened.notify_all();
+			}
+			if (!opened.wait_for(lock, std::chrono::seconds(10), [this]()
+			                     {
+				                     return open;
+				                 }))
+			{
+				timed_out = true;
+			}
+			return memory->read_span(where, length, scratch);
+		}
+	};
+
+	staticdb::memory_storage make_bytes()
+	{
+		staticdb::memory_storage memory;
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(memory.memory));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(256)));
+		for (unsigned i = 0; i < 256; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(static_cast<std::uint8_t>(i))));
+		}
+		return memory;
+	}
+
+	values::value make_found(std::uint8_t key)
+	{
+		std::vector<values::value> expected;
+		expected.emplace_back(values::make_unsigned_integer(key));
+		return values::tuple(std::move(expected));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(file_storage_round_trip)
+{
+	temporary_file const file("staticdb_file_storage_round_trip.bin");
+	staticdb::file_storage storage(file.path);
+	std::vector<staticdb::byte> written(1000);
+	for (std::size_t i = 0; i < written.size(); ++i)
+	{
+		written[i] = static_cast<staticdb::byte>(i * 7);
+	}
+	staticdb::byte const *const begin = written.data();
+	storage.write_at(0).append(Si::make_iterator_range(begin, begin + written.size()));
+	auto reader = storage.read_at(3);
+	for (std::size_t i = 3; i < written.size(); ++i)
+	{
+		Si::optional<staticdb::byte> const read = Si::get(reader);
+		BOOST_REQUIRE(read);
+		BOOST_REQUIRE_EQUAL(written[i], *read);
+	}
+	BOOST_CHECK(!Si::get(reader));
+}
+
+BOOST_AUTO_TEST_CASE(async_gets_on_file_storage)
+{
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+
+	temporary_file const file("staticdb_async_gets_on_file_storage.bin");
+	{
+		staticdb::memory_storage const memory = make_bytes();
+		staticdb::file_storage writable(file.path);
+		staticdb::byte const *const begin = memory.memory.data();
+		writable.write_at(0).append(Si::make_iterator_range(begin, begin + memory.memory.size()));
+	}
+	staticdb::file_storage const storage(file.path);
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	typedef staticdb::suspending_storage<staticdb::file_storage const> suspending;
+	auto planned = Si::to_shared(staticdb::make_plan<suspending>(root_type, gets, sets));
+
+	staticdb::async_getter_executor<staticdb::file_storage const> executor(planned, storage, 2, 4);
+	std::vector<std::future<Si::optional<values::value>>> in_flight;
+	for (unsigned i = 0; i < 64; ++i)
+	{
+		in_flight.emplace_back(
+		    executor.get(0, values::value(values::make_unsigned_integer(static_cast<std::uint8_t>(i * 3)))));
+	}
+	BOOST_CHECK_THROW(executor.get(1, values::value(values::unit())), std::invalid_argument);
+	for (unsigned i = 0; i < in_flight.size(); ++i)
+	{
+		Si::optional<values::value> const found = in_flight[i].get();
+		BOOST_REQUIRE(found);
+		BOOST_CHECK_EQUAL(make_found(static_cast<std::uint8_t>(i * 3)), *found);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(async_getters_suspend_on_reads)
+{
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	staticdb::memory_storage const memory = make_bytes();
+	gated_storage const storage(memory);
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	typedef staticdb::suspending_storage<gated_storage const> suspending;
+	auto planned = Si::to_shared(staticdb::make_plan<suspending>(root_type, gets, sets));
+
+	std::future<Si::optional<values::value>> first;
+	std::future<Si::optional<values::value>> second;
+	{
+		staticdb::async_getter_executor<gated_storage const> executor(planned, storage, 1, 2);
+		first = executor.get(0, values::value(values::make_unsigned_integer<std::uint8_t>(7)));
+		second = executor.get(0, values::value(values::make_unsigned_integer<std::uint8_t>(9)));
+	}
+	BOOST_CHECK(!storage.timed_out);
+	Si::optional<values::value> const first_found = first.get();
+	BOOST_REQUIRE(first_found);
+	BOOST_CHECK_EQUAL(make_found(7), *first_found);
+	Si::optional<values::value> const second_found = second.get();
+	BOOST_REQUIRE(second_found);
+	BOOST_CHECK_EQUAL(make_found(9), *second_found);
+}
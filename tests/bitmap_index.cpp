@@ -0,0 +1,167 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/bulk_loader.hpp>
+#include <staticdb/plan.hpp>
+#include <set>
+#include "test_support.hpp"
+
+namespace
+{
+	staticdb::roaring_bitmap make_bitmap(std::set<staticdb::address> const &indices)
+	{
+		staticdb::roaring_bitmap result;
+		for (staticdb::address index : indices)
+		{
+			result.push_back(index);
+		}
+		result.optimize();
+		return result;
+	}
+
+	std::set<staticdb::address> list_indices(staticdb::roaring_bitmap const &bitmap)
+	{
+		std::set<staticdb::address> result;
+		bitmap.for_each(0, ~staticdb::address(0), [&result](staticdb::address index)
+		                {
+			                result.insert(index);
+			            });
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(roaring_bitmap_chooses_containers)
+{
+	namespace roaring = staticdb::roaring;
+	std::set<staticdb::address> sparse;
+	std::set<staticdb::address> dense;
+	for (staticdb::address i = 0; i < 100; ++i)
+	{
+		sparse.insert(i * 601u);
+	}
+	for (staticdb::address i = 0; i < 3000u; i += 2)
+	{
+		dense.insert(i);
+	}
+	for (staticdb::address i = 0; i < 65536u; i += 3)
+	{
+		dense.insert(65536u + i);
+	}
+	for (staticdb::address i = 0; i < 30000u; ++i)
+	{
+		dense.insert((2u * 65536u) + 1000u + i);
+	}
+	std::set<staticdb::address> all = sparse;
+	all.insert(dense.begin(), dense.end());
+	staticdb::roaring_bitmap const bitmap = make_bitmap(all);
+	BOOST_REQUIRE_EQUAL(3u, bitmap.containers().size());
+	BOOST_CHECK(Si::try_get_ptr<roaring::array_container>(bitmap.containers()[0].second));
+	BOOST_CHECK(Si::try_get_ptr<roaring::bitmap_container>(bitmap.containers()[1].second));
+	BOOST_CHECK(Si::try_get_ptr<roaring::run_container>(bitmap.containers()[2].second));
+	BOOST_CHECK_EQUAL(all.size(), bitmap.cardinality());
+	BOOST_CHECK(bitmap.contains(601u));
+	BOOST_CHECK(!bitmap.contains(602u));
+	BOOST_CHECK(bitmap.contains(65536u + 3u));
+	BOOST_CHECK(!bitmap.contains(65536u + 4u));
+	BOOST_CHECK(bitmap.contains((2u * 65536u) + 1000u));
+	BOOST_CHECK(!bitmap.contains((2u * 65536u) + 999u));
+	BOOST_CHECK(list_indices(bitmap) == all);
+	BOOST_CHECK_LT(bitmap.memory_in_bytes(), all.size() * sizeof(staticdb::address) / 4u);
+
+	staticdb::roaring_bitmap const sparse_bitmap = make_bitmap(sparse);
+	staticdb::roaring_bitmap const dense_bitmap = make_bitmap(dense);
+	std::set<staticdb::address> both;
+	std::set_intersection(sparse.begin(), sparse.end(), dense.begin(), dense.end(),
+	                      std::inserter(both, both.end()));
+	BOOST_CHECK(!both.empty());
+	BOOST_CHECK(list_indices(staticdb::intersect(sparse_bitmap, dense_bitmap)) == both);
+	BOOST_CHECK(list_indices(staticdb::unite(sparse_bitmap, dense_bitmap)) == all);
+}
+
+BOOST_AUTO_TEST_CASE(bitmap_index_built_by_bulk_loader_answers_filters)
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+	staticdb::memory_storage storage;
+	staticdb::array_loader<staticdb::memory_storage> loader(
+	    storage, 0, types::make_unsigned_integer(8), std::make_shared<staticdb::work_stealing_pool>(2), 100);
+	loader.add_bitmap_index({staticdb::execution::bit_range(0, 8)});
+	for (unsigned i = 0; i < 1000; ++i)
+	{
+		loader.add_packed((i % 5u) * 10u);
+	}
+	BOOST_CHECK_EQUAL(1000u, loader.finish());
+	std::vector<staticdb::bitmap_index> built = loader.take_bitmap_indexes();
+	BOOST_REQUIRE_EQUAL(1u, built.size());
+	BOOST_CHECK_EQUAL(5u, built[0].bitmaps.size());
+	BOOST_REQUIRE(built[0].find(20));
+	BOOST_CHECK_EQUAL(200u, built[0].find(20)->cardinality());
+	BOOST_CHECK_GT(built[0].memory_in_bytes(), 0u);
+
+	// an index that lists only some of the matching rows shows that the filter reads the index
+	staticdb::bitmap_index partial(std::vector<staticdb::execution::bit_range>{staticdb::execution::bit_range(0, 8)});
+	partial.bitmaps[30].push_back(3);
+	partial.bitmaps[30].push_back(8);
+	partial.length = 1000;
+	// an index of fewer rows than the array has is not used
+	staticdb::bitmap_index outdated(std::vector<staticdb::execution::bit_range>{staticdb::execution::bit_range(0, 8)});
+	outdated.bitmaps[30].push_back(3);
+	outdated.length = 999;
+	auto const indexes = std::make_shared<staticdb::bitmap_index_set>();
+	indexes->add(0, std::make_shared<staticdb::bitmap_index const>(std::move(built[0])));
+
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::execution::scan_options indexed;
+	indexed.bitmap_indexes = indexes;
+	auto const planned = staticdb::make_plan<staticdb::memory_storage const>(root_type, gets, sets, indexed);
+	for (std::uint8_t key : {0, 20, 30, 40, 7})
+	{
+		Si::optional<values::value> const found =
+		    planned.gets[0](storage, values::value(values::make_unsigned_integer(key)));
+		BOOST_REQUIRE(found);
+		std::vector<values::value> expected;
+		for (unsigned i = 0; i < ((key % 10u) ? 0u : 200u); ++i)
+		{
+			expected.emplace_back(values::make_unsigned_integer(key));
+		}
+		BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *found);
+	}
+
+	auto const partial_indexes = std::make_shared<staticdb::bitmap_index_set>();
+	partial_indexes->add(0, std::make_shared<staticdb::bitmap_index const>(std::move(partial)));
+	staticdb::execution::scan_options partially_indexed;
+	partially_indexed.bitmap_indexes = partial_indexes;
+	auto const partially_planned =
+	    staticdb::make_plan<staticdb::memory_storage const>(root_type, gets, sets, partially_indexed);
+	Si::optional<values::value> const found =
+	    partially_planned.gets[0](storage, values::value(values::make_unsigned_integer<std::uint8_t>(30)));
+	BOOST_REQUIRE(found);
+	std::vector<values::value> expected;
+	expected.emplace_back(values::make_unsigned_integer<std::uint8_t>(30));
+	expected.emplace_back(values::make_unsigned_integer<std::uint8_t>(30));
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *found);
+
+	auto const outdated_indexes = std::make_shared<staticdb::bitmap_index_set>();
+	outdated_indexes->add(0, std::make_shared<staticdb::bitmap_index const>(std::move(outdated)));
+	staticdb::execution::scan_options outdated_options;
+	outdated_options.bitmap_indexes = outdated_indexes;
+	auto const outdated_planned =
+	    staticdb::make_plan<staticdb::memory_storage const>(root_type, gets, sets, outdated_options);
+	Si::optional<values::value> const scanned =
+	    outdated_planned.gets[0](storage, values::value(values::make_unsigned_integer<std::uint8_t>(30)));
+	BOOST_REQUIRE(scanned);
+	values::tuple const *const matches = Si::try_get_ptr<values::tuple>(scanned->as_variant());
+	BOOST_REQUIRE(matches);
+	BOOST_CHECK_EQUAL(200u, matches->elements.size());
+
+	// setters do not update the indexes, so a plan cannot have both
+	expr::expression const set_anything((expr::argument()));
+	Si::iterator_range<staticdb::set_function const *> const one_set(&set_anything, &set_anything + 1);
+	BOOST_CHECK_THROW(staticdb::make_plan<staticdb::memory_storage>(root_type, gets, one_set, indexed),
+	                  std::invalid_argument);
+	BOOST_CHECK_EQUAL(1u, staticdb::make_plan<staticdb::memory_storage>(root_type, gets, one_set,
+	                                                                     staticdb::execution::scan_options())
+	                          .sets.size());
+}
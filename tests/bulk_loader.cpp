@@ -0,0 +1,105 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/bulk_loader.hpp>
+#include <staticdb/file_storage.hpp>
+#include <staticdb/plan.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	using staticdb_tests::make_u13;
+	using staticdb_tests::temporary_file;
+
+	std::vector<staticdb::byte> serialize_serially(std::size_t count)
+	{
+		std::vector<staticdb::byte> expected;
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(expected));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(count)));
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			values::serialize(writer, make_u13(i * 37u % 8192u));
+		}
+		writer.flush();
+		return expected;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(bulk_loader_matches_serialize)
+{
+	auto pool = std::make_shared<staticdb::work_stealing_pool>(2);
+	for (std::size_t count : {0u, 1u, 7u, 100u, 1001u})
+	{
+		staticdb::memory_storage storage;
+		staticdb::array_loader<staticdb::memory_storage> loader(storage, 0, types::make_unsigned_integer(13), pool,
+		                                                        5);
+		BOOST_CHECK_EQUAL(13u, loader.element_bits());
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			std::uint64_t const integer = i * 37u % 8192u;
+			if ((i % 3) == 0)
+			{
+				loader.add_packed(integer);
+			}
+			else
+			{
+				loader.add(make_u13(integer));
+			}
+		}
+		BOOST_CHECK_EQUAL(count, loader.finish());
+		std::vector<staticdb::byte> const expected = serialize_serially(count);
+		BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), storage.memory.begin(),
+		                              storage.memory.end());
+	}
+}
+
+BOOST_AUTO_TEST_CASE(bulk_loader_rejects_invalid_elements)
+{
+	staticdb::memory_storage storage;
+	BOOST_CHECK_THROW(staticdb::array_loader<staticdb::memory_storage>(
+	                      storage, 0, types::array(Si::make_unique<types::type>(types::bit())), nullptr),
+	                  std::invalid_argument);
+	staticdb::array_loader<staticdb::memory_storage> loader(storage, 0, types::make_unsigned_integer(13), nullptr, 2);
+	BOOST_CHECK_THROW(loader.add_packed(8192), std::invalid_argument);
+	loader.add(make_u13(1));
+	BOOST_CHECK_THROW(loader.add(values::value(values::make_unsigned_integer<std::uint8_t>(1))),
+	                  std::invalid_argument);
+	// the wrong element was rejected before it was queued, so the loader can go on
+	loader.add(make_u13(2));
+	loader.add(make_u13(3));
+	BOOST_CHECK_EQUAL(3u, loader.finish());
+}
+
+BOOST_AUTO_TEST_CASE(bulk_loader_into_file_storage)
+{
+	temporary_file const file("staticdb_bulk_loader_into_file_storage.bin");
+	{
+		staticdb::file_storage storage(file.path);
+		staticdb::array_loader<staticdb::file_storage> loader(
+		    storage, 0, types::make_unsigned_integer(8), std::make_shared<staticdb::work_stealing_pool>(3), 16);
+		for (unsigned i = 0; i < 1000; ++i)
+		{
+			loader.add_packed(i % 256u);
+		}
+		BOOST_CHECK_EQUAL(1000u, loader.finish());
+	}
+	staticdb::file_storage const storage(file.path);
+
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	auto const planned = staticdb::make_plan<staticdb::file_storage const>(root_type, gets, sets);
+	Si::optional<values::value> const found =
+	    planned.gets[0](storage, values::value(values::make_unsigned_integer<std::uint8_t>(42)));
+	BOOST_REQUIRE(found);
+	std::vector<values::value> expected;
+	for (unsigned i = 0; i < 4; ++i)
+	{
+		expected.emplace_back(values::make_unsigned_integer<std::uint8_t>(42));
+	}
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *found);
+}
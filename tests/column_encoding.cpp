@@ -0,0 +1,129 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	using staticdb_tests::make_column;
+
+	staticdb::get_function make_equality_filter(std::uint16_t wanted)
+	{
+		namespace expr = staticdb::expressions;
+		namespace values = staticdb::values;
+		return staticdb_tests::make_find_equals(expr::make_tuple_at(expr::expression(expr::argument()), 0),
+		                                        expr::literal(values::make_unsigned_integer(wanted)));
+	}
+
+	staticdb::get_function make_sort()
+	{
+		namespace expr = staticdb::expressions;
+		namespace values = staticdb::values;
+		return expr::order_by(
+		    Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+		    Si::make_unique<expr::expression>(
+		        expr::lambda(Si::make_unique<expr::expression>(expr::argument()),
+		                     Si::make_unique<expr::expression>(expr::literal(values::unit())))));
+	}
+
+	void check_encoded_column(std::vector<std::uint16_t> const &numbers, staticdb::layouts::bitset_encoding expected)
+	{
+		namespace layouts = staticdb::layouts;
+		namespace values = staticdb::values;
+		namespace execution = staticdb::execution;
+		values::value const column = make_column(numbers);
+		layouts::layout const plain(
+		    layouts::array(Si::make_unique<layouts::layout>(layouts::layout(layouts::bitset(16)))));
+		std::shared_ptr<layouts::layout const> const root = Si::to_shared(layouts::choose_encodings(plain, column));
+		layouts::array const *const chosen = Si::try_get_ptr<layouts::array>(root->as_variant());
+		BOOST_REQUIRE(chosen);
+		BOOST_CHECK(chosen->encoding == expected);
+
+		staticdb::bit_buffer encoded;
+		layouts::serialize(encoded, column, *root);
+		staticdb::memory_storage storage;
+		storage.memory = encoded.bytes();
+		std::vector<std::uint64_t> const packed(numbers.begin(), numbers.end());
+		Si::optional<staticdb::address> const encoded_size = layouts::encoded_size_in_bits(packed, 16, expected);
+		BOOST_REQUIRE(encoded_size);
+		BOOST_CHECK_LT(*encoded_size, numbers.size() * 16u);
+
+		execution::storage_pointer<staticdb::memory_storage const> const begin(storage, 0);
+		BOOST_CHECK_EQUAL(64u + *encoded_size, *execution::stored_size_in_bits(begin, *root).value());
+		execution::pseudo_value<staticdb::memory_storage const> const array = execution::access_value(begin, *root);
+		BOOST_CHECK_EQUAL(column, execution::reduce_value(array));
+		execution::basic_array_accessor<staticdb::memory_storage const> const *const accessor =
+		    Si::try_get_ptr<execution::basic_array_accessor<staticdb::memory_storage const>>(array);
+		BOOST_REQUIRE(accessor);
+		for (std::size_t i = 0; i < numbers.size(); i += 37)
+		{
+			Si::optional<execution::pseudo_value<staticdb::memory_storage const>> const found =
+			    execution::get_stored_element(*accessor, i);
+			BOOST_REQUIRE(found);
+			BOOST_CHECK_EQUAL(values::value(values::make_unsigned_integer(numbers[i])),
+			                  execution::reduce_value(*found));
+		}
+
+		std::uint16_t const wanted = numbers[numbers.size() / 2];
+		std::vector<values::value> matching;
+		for (std::uint16_t number : numbers)
+		{
+			if (number == wanted)
+			{
+				matching.emplace_back(values::make_unsigned_integer(number));
+			}
+		}
+		std::vector<staticdb::get_function> gets;
+		gets.emplace_back(make_equality_filter(wanted));
+		gets.emplace_back(make_equality_filter(1));
+		gets.emplace_back(make_sort());
+		Si::iterator_range<staticdb::get_function const *> const get_range(gets.data(), gets.data() + gets.size());
+		Si::iterator_range<staticdb::set_function const *> sets;
+		staticdb::basic_plan<staticdb::memory_storage const> const planned =
+		    staticdb::make_plan<staticdb::memory_storage const>(root, std::vector<staticdb::address>(), get_range,
+		                                                         sets, execution::scan_options());
+		Si::optional<values::value> const found = planned.gets[0](storage, values::value(values::unit()));
+		BOOST_REQUIRE(found);
+		BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(matching))), *found);
+		Si::optional<values::value> const missing = planned.gets[1](storage, values::value(values::unit()));
+		BOOST_REQUIRE(missing);
+		BOOST_CHECK_EQUAL(values::value(values::tuple()), *missing);
+
+		// sorting reads the key of every element in order
+		std::vector<std::uint16_t> ascending = numbers;
+		std::sort(ascending.begin(), ascending.end());
+		Si::optional<values::value> const sorted = planned.gets[2](storage, values::value(values::unit()));
+		BOOST_REQUIRE(sorted);
+		BOOST_CHECK_EQUAL(make_column(ascending), *sorted);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(column_encoding_frame_of_reference)
+{
+	std::vector<std::uint16_t> numbers;
+	for (std::uint16_t i = 0; i < 300; ++i)
+	{
+		numbers.emplace_back(static_cast<std::uint16_t>(50000u + ((i * 7u) % 100u)));
+	}
+	check_encoded_column(numbers, staticdb::layouts::bitset_encoding::frame_of_reference);
+}
+
+BOOST_AUTO_TEST_CASE(column_encoding_delta)
+{
+	std::vector<std::uint16_t> numbers;
+	for (std::uint16_t i = 0; i < 300; ++i)
+	{
+		numbers.emplace_back(static_cast<std::uint16_t>(1000u + (i * 3u)));
+	}
+	check_encoded_column(numbers, staticdb::layouts::bitset_encoding::delta);
+}
+
+BOOST_AUTO_TEST_CASE(column_encoding_dictionary)
+{
+	std::vector<std::uint16_t> numbers;
+	for (std::uint16_t i = 0; i < 300; ++i)
+	{
+		numbers.emplace_back(static_cast<std::uint16_t>(5u + ((i % 3u) * 20000u)));
+	}
+	check_encoded_column(numbers, staticdb::layouts::bitset_encoding::dictionary);
+}
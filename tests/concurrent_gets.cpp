@@ -0,0 +1,61 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include <thread>
+#include "test_support.hpp"
+
+BOOST_AUTO_TEST_CASE(concurrent_gets_share_plan_and_storage)
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+
+	staticdb::memory_storage writable;
+	{
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(writable.memory));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(256)));
+		for (unsigned i = 0; i < 256; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(static_cast<std::uint8_t>(i))));
+		}
+	}
+	staticdb::memory_storage const &storage = writable;
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::basic_plan<staticdb::memory_storage const> const planned =
+	    staticdb::make_plan<staticdb::memory_storage const>(root_type, gets, sets);
+
+	std::vector<std::size_t> wrong_results(4, 0);
+	std::vector<std::thread> threads;
+	for (std::size_t t = 0; t < wrong_results.size(); ++t)
+	{
+		threads.emplace_back([&planned, &storage, &wrong_results, t]()
+		                     {
+			                     for (unsigned i = 0; i < 256; ++i)
+			                     {
+				                     std::uint8_t const key = static_cast<std::uint8_t>(i + t);
+				                     Si::optional<values::value> const found =
+				                         planned.gets[0](storage, values::value(values::make_unsigned_integer(key)));
+				                     std::vector<values::value> expected;
+				                     expected.emplace_back(values::make_unsigned_integer(key));
+				                     if (!found || !(*found == values::value(values::tuple(std::move(expected)))))
+				                     {
+					                     ++wrong_results[t];
+				                     }
+			                     }
+			                 });
+	}
+	for (std::thread &thread : threads)
+	{
+		thread.join();
+	}
+	for (std::size_t wrong : wrong_results)
+	{
+		BOOST_CHECK_EQUAL(0u, wrong);
+	}
+}
@@ -0,0 +1,152 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/delta_store.hpp>
+#include <staticdb/plan.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include <thread>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	typedef staticdb::delta_store<staticdb::memory_storage> store_type;
+
+	staticdb::memory_storage make_stored(std::vector<std::uint8_t> const &elements)
+	{
+		staticdb::memory_storage storage;
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(storage.memory));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(elements.size())));
+		for (std::uint8_t element : elements)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(element)));
+		}
+		return storage;
+	}
+
+	values::value make_uint8(std::uint8_t element)
+	{
+		return values::value(values::make_unsigned_integer(element));
+	}
+
+	types::type make_root_type()
+	{
+		return types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	}
+
+	// gets[0] finds the elements that equal the argument, gets[1] sorts all elements
+	staticdb::basic_plan<store_type::view> make_delta_plan()
+	{
+		std::vector<expr::expression> gets;
+		gets.emplace_back(staticdb_tests::make_find_equals());
+		auto identity = Si::make_unique<expr::expression>(
+		    expr::lambda(Si::make_unique<expr::expression>(expr::argument()),
+		                 Si::make_unique<expr::expression>(expr::literal(values::unit()))));
+		gets.emplace_back(expr::order_by(
+		    Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+		    std::move(identity)));
+		Si::iterator_range<staticdb::get_function const *> const get_range(gets.data(), gets.data() + gets.size());
+		Si::iterator_range<staticdb::set_function const *> sets;
+		return staticdb::make_plan<store_type::view>(make_root_type(), get_range, sets);
+	}
+
+	void check_content(staticdb::basic_plan<store_type::view> const &planned, store_type::view view,
+	                   std::vector<std::uint8_t> expected)
+	{
+		for (std::uint8_t key : {std::uint8_t(0), std::uint8_t(7), std::uint8_t(200), std::uint8_t(201)})
+		{
+			std::vector<values::value> matches;
+			for (std::uint8_t element : expected)
+			{
+				if (element == key)
+				{
+					matches.emplace_back(make_uint8(element));
+				}
+			}
+			Si::optional<values::value> const found = planned.gets[0](view, make_uint8(key));
+			BOOST_REQUIRE(found);
+			BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(matches))), *found);
+		}
+		std::sort(expected.begin(), expected.end());
+		std::vector<values::value> sorted;
+		for (std::uint8_t element : expected)
+		{
+			sorted.emplace_back(make_uint8(element));
+		}
+		Si::optional<values::value> const found = planned.gets[1](view, values::value(values::unit()));
+		BOOST_REQUIRE(found);
+		BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(sorted))), *found);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(delta_store_merges_changes_on_read)
+{
+	std::vector<std::uint8_t> expected;
+	for (std::uint8_t i = 0; i < 50; ++i)
+	{
+		expected.emplace_back(i);
+	}
+	store_type store(make_stored(expected), staticdb::layouts::calculate(make_root_type()));
+	auto const planned = make_delta_plan();
+	check_content(planned, store.read(), expected);
+
+	store.insert(0, 0, make_uint8(200));
+	expected.insert(expected.begin(), 200);
+	store.insert(0, 51, make_uint8(201));
+	expected.emplace_back(201);
+	store.insert(0, 10, make_uint8(7));
+	expected.insert(expected.begin() + 10, 7);
+	store.update(0, 3, make_uint8(200));
+	expected[3] = 200;
+	store.erase(0, 0);
+	expected.erase(expected.begin());
+	store.erase(0, 8);
+	expected.erase(expected.begin() + 8);
+	store.update(0, 9, make_uint8(0));
+	expected[9] = 0;
+	store.insert(0, 9, make_uint8(201));
+	expected.insert(expected.begin() + 9, 201);
+	BOOST_CHECK_EQUAL(expected.size(), store.length(0));
+	BOOST_CHECK_THROW(store.insert(0, expected.size() + 1, make_uint8(1)), std::invalid_argument);
+	BOOST_CHECK_THROW(store.update(0, 0, values::value(values::unit())), std::invalid_argument);
+	BOOST_CHECK_THROW(store.insert(1, 0, make_uint8(1)), std::invalid_argument);
+	BOOST_CHECK_THROW(store.erase(7, 0), std::invalid_argument);
+	check_content(planned, store.read(), expected);
+
+	store_type::view const old = store.read();
+	store.compact(staticdb::memory_storage());
+	BOOST_CHECK_EQUAL(0u, store.delta_size());
+	store_type::view const compacted = store.read();
+	BOOST_CHECK(!compacted.delta(0));
+	staticdb::memory_storage const rewritten = make_stored(expected);
+	BOOST_CHECK_EQUAL_COLLECTIONS(rewritten.memory.begin(), rewritten.memory.end(),
+	                              compacted.stored().memory.begin(), compacted.stored().memory.end());
+	check_content(planned, compacted, expected);
+	check_content(planned, old, expected);
+}
+
+BOOST_AUTO_TEST_CASE(delta_store_changes_during_compaction)
+{
+	std::vector<std::uint8_t> expected(1000, 7);
+	store_type store(make_stored(expected), staticdb::layouts::calculate(make_root_type()));
+	auto const planned = make_delta_plan();
+	for (std::size_t i = 0; i < 100; ++i)
+	{
+		store.update(0, i * 5, make_uint8(static_cast<std::uint8_t>(i)));
+		expected[i * 5] = static_cast<std::uint8_t>(i);
+	}
+	std::future<void> compacted = store.compact_in_background(staticdb::memory_storage());
+	for (std::size_t i = 0; i < 200; ++i)
+	{
+		store.insert(0, i * 3, make_uint8(200));
+		expected.insert(expected.begin() + static_cast<std::ptrdiff_t>(i * 3), 200);
+		store.erase(0, i * 4 + 1);
+		expected.erase(expected.begin() + static_cast<std::ptrdiff_t>(i * 4 + 1));
+	}
+	compacted.get();
+	check_content(planned, store.read(), expected);
+	store.compact(staticdb::memory_storage());
+	BOOST_CHECK_EQUAL(0u, store.delta_size());
+	check_content(planned, store.read(), expected);
+}
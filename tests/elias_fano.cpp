@@ -0,0 +1,100 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	using staticdb_tests::make_column;
+
+	std::vector<std::uint64_t> make_timestamps()
+	{
+		std::vector<std::uint64_t> timestamps;
+		std::uint64_t next = 1000000000000u;
+		for (std::uint64_t i = 0; i < 2000; ++i)
+		{
+			timestamps.emplace_back(next);
+			next += ((i % 100) == 99) ? 1000000u : ((i * 7919u) % 13u);
+		}
+		return timestamps;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(elias_fano_access_and_lower_bound)
+{
+	namespace layouts = staticdb::layouts;
+	namespace values = staticdb::values;
+	namespace execution = staticdb::execution;
+	std::vector<std::uint64_t> const timestamps = make_timestamps();
+	values::value const column = make_column(timestamps);
+	layouts::layout const plain(layouts::array(Si::make_unique<layouts::layout>(layouts::layout(layouts::bitset(64)))));
+	layouts::layout const root = layouts::choose_encodings(plain, column);
+	layouts::array const *const chosen = Si::try_get_ptr<layouts::array>(root.as_variant());
+	BOOST_REQUIRE(chosen);
+	BOOST_CHECK(chosen->encoding == layouts::bitset_encoding::elias_fano);
+
+	staticdb::bit_buffer encoded;
+	layouts::serialize(encoded, column, root);
+	staticdb::memory_storage storage;
+	storage.memory = encoded.bytes();
+	execution::storage_pointer<staticdb::memory_storage const> const begin(storage, 0);
+	BOOST_CHECK_EQUAL(64u + *layouts::encoded_size_in_bits(timestamps, 64, layouts::bitset_encoding::elias_fano),
+	                  *execution::stored_size_in_bits(begin, root).value());
+	execution::pseudo_value<staticdb::memory_storage const> const array = execution::access_value(begin, root);
+	BOOST_CHECK_EQUAL(column, execution::reduce_value(array));
+	execution::basic_array_accessor<staticdb::memory_storage const> const *const accessor =
+	    Si::try_get_ptr<execution::basic_array_accessor<staticdb::memory_storage const>>(array);
+	BOOST_REQUIRE(accessor);
+	Si::optional<execution::encoded_column<staticdb::memory_storage const>> const elias_fano =
+	    execution::find_encoded_column(*accessor);
+	BOOST_REQUIRE(elias_fano);
+	for (std::size_t i = 0; i < timestamps.size(); i += 13)
+	{
+		BOOST_CHECK_EQUAL(timestamps[i], elias_fano->value_at(i));
+		for (std::uint64_t probe : {timestamps[i] - 1u, timestamps[i], timestamps[i] + 1u})
+		{
+			std::size_t const expected = static_cast<std::size_t>(
+			    std::lower_bound(timestamps.begin(), timestamps.end(), probe) - timestamps.begin());
+			BOOST_CHECK_EQUAL(expected, elias_fano->lower_bound(probe));
+		}
+	}
+	BOOST_CHECK_EQUAL(0u, elias_fano->lower_bound(0));
+	BOOST_CHECK_EQUAL(timestamps.size(), elias_fano->lower_bound(timestamps.back() + 1u));
+}
+
+BOOST_AUTO_TEST_CASE(elias_fano_filter_by_equality)
+{
+	namespace layouts = staticdb::layouts;
+	namespace values = staticdb::values;
+	namespace expr = staticdb::expressions;
+	std::vector<std::uint64_t> const timestamps = make_timestamps();
+	values::value const column = make_column(timestamps);
+	std::shared_ptr<layouts::layout const> const root = Si::to_shared(layouts::layout(layouts::array(
+	    Si::make_unique<layouts::layout>(layouts::layout(layouts::bitset(64))), layouts::bitset_encoding::elias_fano)));
+	staticdb::bit_buffer encoded;
+	layouts::serialize(encoded, column, *root);
+	staticdb::memory_storage storage;
+	storage.memory = encoded.bytes();
+
+	std::uint64_t const wanted = timestamps[1234];
+	std::vector<values::value> matching;
+	for (std::uint64_t timestamp : timestamps)
+	{
+		if (timestamp == wanted)
+		{
+			matching.emplace_back(values::make_unsigned_integer(timestamp));
+		}
+	}
+	std::vector<staticdb::get_function> gets;
+	gets.emplace_back(staticdb_tests::make_find_equals(expr::make_tuple_at(expr::expression(expr::argument()), 0),
+	                                                   expr::literal(values::make_unsigned_integer(wanted))));
+	Si::iterator_range<staticdb::get_function const *> const get_range(gets.data(), gets.data() + gets.size());
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::execution::scan_options const small_morsels(std::make_shared<staticdb::work_stealing_pool>(2), 0, 100);
+	staticdb::basic_plan<staticdb::memory_storage const> const planned =
+	    staticdb::make_plan<staticdb::memory_storage const>(root, std::vector<staticdb::address>(), get_range, sets,
+	                                                         small_morsels);
+	Si::optional<values::value> const found = planned.gets[0](storage, values::value(values::unit()));
+	BOOST_REQUIRE(found);
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(matching))), *found);
+}
@@ -0,0 +1,163 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/file_format.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+	namespace file_format = staticdb::file_format;
+
+	types::type make_root_type()
+	{
+		return types::make_tuple(types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8))),
+		                         types::array(Si::make_unique<types::type>(types::make_unsigned_integer(16))));
+	}
+
+	std::vector<staticdb::byte> make_data()
+	{
+		std::vector<staticdb::byte> data;
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(data));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(3)));
+		for (std::uint8_t i = 0; i < 3; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(i)));
+		}
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(100)));
+		for (std::uint16_t i = 0; i < 100; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(static_cast<std::uint16_t>(i * 7))));
+		}
+		return data;
+	}
+
+	std::vector<staticdb::byte> serialized(types::type const &root)
+	{
+		std::vector<staticdb::byte> result;
+		file_format::serialize_type(result, root);
+		return result;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(file_format_round_trip)
+{
+	staticdb::memory_storage storage;
+	std::vector<file_format::index_content> indexes;
+	indexes.push_back(file_format::index_content{42, std::vector<staticdb::byte>{1, 2, 3}});
+	file_format::write_database(storage, make_root_type(), make_data(), indexes);
+
+	file_format::database const opened = file_format::open_database(storage);
+	BOOST_CHECK(serialized(make_root_type()) == serialized(opened.root_type));
+	BOOST_CHECK_EQUAL(staticdb::layouts::calculate(make_root_type()), opened.root_layout);
+	BOOST_REQUIRE_EQUAL(2u, opened.root_member_offsets.size());
+	BOOST_CHECK_EQUAL(0u, opened.root_member_offsets[0]);
+	BOOST_CHECK_EQUAL(64u + 3u * 8u, opened.root_member_offsets[1]);
+	BOOST_CHECK_EQUAL(0u, opened.data.offset % file_format::section_alignment);
+	BOOST_REQUIRE_EQUAL(1u, opened.indexes.size());
+	BOOST_CHECK_EQUAL(42u, opened.indexes[0].tag);
+	BOOST_CHECK(std::vector<staticdb::byte>({1, 2, 3}) ==
+	            file_format::read_bytes(storage, opened.indexes[0].offset, opened.indexes[0].length));
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals(
+	    expr::make_tuple_at(expr::make_tuple_at(expr::expression(expr::argument()), 0), 1),
+	    expr::make_tuple_at(expr::expression(expr::argument()), 1));
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	auto const planned =
+	    file_format::make_plan<staticdb::memory_storage>(opened, gets, sets, staticdb::execution::scan_options());
+	auto data = file_format::open_section(storage, opened.data);
+	Si::optional<values::value> const found =
+	    planned.gets[0](data, values::value(values::make_unsigned_integer(static_cast<std::uint16_t>(693))));
+	BOOST_REQUIRE(found);
+	std::vector<values::value> expected;
+	expected.emplace_back(values::make_unsigned_integer(static_cast<std::uint16_t>(693)));
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *found);
+}
+
+BOOST_AUTO_TEST_CASE(file_format_zone_map_section)
+{
+	// zones of the second array of the root in blocks of 10 elements, the third one claiming to be empty so that the
+	// filter shows whether it used them
+	staticdb::zone_map zones(10, std::vector<staticdb::execution::bit_range>{staticdb::execution::bit_range(0, 16)});
+	for (std::uint64_t i = 0; i < 100; ++i)
+	{
+		std::uint64_t const element = i * 7u;
+		zones.push_back(&element);
+	}
+	zones.zones[2] = staticdb::zone();
+	std::vector<file_format::index_content> indexes;
+	indexes.push_back(file_format::zone_map_content(9, 64u + 3u * 8u, zones));
+	staticdb::memory_storage storage;
+	file_format::write_database(storage, make_root_type(), make_data(), indexes);
+
+	file_format::database const opened = file_format::open_database(storage);
+	staticdb::execution::scan_options options;
+	options.zone_maps = file_format::load_zone_maps(storage, opened, {9});
+	staticdb::zone_map const *const loaded = options.zone_maps->find(64u + 3u * 8u);
+	BOOST_REQUIRE(loaded);
+	BOOST_CHECK_EQUAL(100u, loaded->length);
+	BOOST_CHECK_EQUAL(zones.at(5, 0).minimum, loaded->at(5, 0).minimum);
+	BOOST_CHECK_EQUAL(zones.at(5, 0).maximum, loaded->at(5, 0).maximum);
+	BOOST_CHECK_THROW(file_format::load_zone_maps(storage, opened, {10}), std::invalid_argument);
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals(
+	    expr::make_tuple_at(expr::make_tuple_at(expr::expression(expr::argument()), 0), 1),
+	    expr::make_tuple_at(expr::expression(expr::argument()), 1));
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	auto const planned = file_format::make_plan<staticdb::memory_storage>(opened, gets, sets, options);
+	auto data = file_format::open_section(storage, opened.data);
+	for (std::uint16_t element : {175, 350})
+	{
+		Si::optional<values::value> const found =
+		    planned.gets[0](data, values::value(values::make_unsigned_integer(element)));
+		BOOST_REQUIRE(found);
+		std::vector<values::value> expected;
+		if (element != 175)
+		{
+			expected.emplace_back(values::make_unsigned_integer(element));
+		}
+		BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *found);
+	}
+}
+
+BOOST_AUTO_TEST_CASE(file_format_rejects_damaged_headers)
+{
+	staticdb::memory_storage storage;
+	file_format::write_database(storage, make_root_type(), make_data(), std::vector<file_format::index_content>());
+	file_format::database const opened = file_format::open_database(storage);
+	BOOST_CHECK_EQUAL(0u, opened.indexes.size());
+
+	staticdb::memory_storage damaged_layout;
+	damaged_layout.memory = storage.memory;
+	damaged_layout.memory[static_cast<std::size_t>(file_format::section_alignment * 2u)] ^= 1u;
+	BOOST_CHECK_THROW(file_format::open_database(damaged_layout), std::invalid_argument);
+
+	staticdb::memory_storage damaged_magic;
+	damaged_magic.memory = storage.memory;
+	damaged_magic.memory[0] = 'X';
+	BOOST_CHECK_THROW(file_format::open_database(damaged_magic), std::invalid_argument);
+
+	staticdb::memory_storage truncated;
+	truncated.memory.assign(storage.memory.begin(), storage.memory.begin() + 30);
+	BOOST_CHECK_THROW(file_format::open_database(truncated), std::invalid_argument);
+
+	// sizes from a corrupt header are checked against the file before anything is allocated for them
+	staticdb::memory_storage many_sections;
+	many_sections.memory = storage.memory;
+	std::fill(many_sections.memory.begin() + 12, many_sections.memory.begin() + 16, staticdb::byte(0xff));
+	BOOST_CHECK_THROW(file_format::open_database(many_sections), std::invalid_argument);
+
+	staticdb::memory_storage long_sections;
+	long_sections.memory = storage.memory;
+	for (std::size_t entry = 0; entry < 4; ++entry)
+	{
+		auto const length = long_sections.memory.begin() + 24 + (entry * 24) + 16;
+		std::fill(length, length + 7, staticdb::byte(0x7f));
+	}
+	BOOST_CHECK_THROW(file_format::open_database(long_sections), std::invalid_argument);
+}
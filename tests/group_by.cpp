@@ -0,0 +1,83 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	std::unique_ptr<expr::expression> make_bits_lambda(std::size_t first, std::size_t count)
+	{
+		std::vector<expr::expression> bits;
+		for (std::size_t i = first; i < first + count; ++i)
+		{
+			bits.emplace_back(expr::make_tuple_at(expr::expression(expr::argument()), i));
+		}
+		return Si::make_unique<expr::expression>(
+		    expr::lambda(Si::make_unique<expr::expression>(expr::make_tuple(std::move(bits))),
+		                 Si::make_unique<expr::expression>(expr::literal(values::unit()))));
+	}
+
+	Si::optional<values::value> run_group_by(expr::aggregate_function function)
+	{
+		types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(16)));
+
+		staticdb::memory_storage storage;
+		{
+			auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(storage.memory));
+			std::vector<std::uint16_t> const elements{0x0105, 0x0203, 0x0107, 0x0201, 0x0302};
+			values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(elements.size())));
+			for (std::uint16_t element : elements)
+			{
+				values::serialize(writer, values::value(values::make_unsigned_integer(element)));
+			}
+		}
+
+		expr::expression const grouped(
+		    expr::group_by(Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+		                   make_bits_lambda(0, 8), function, make_bits_lambda(8, 8)));
+		Si::iterator_range<staticdb::get_function const *> gets(&grouped, &grouped + 1);
+		Si::iterator_range<staticdb::set_function const *> sets;
+		staticdb::basic_plan<decltype(storage)> const planned =
+		    staticdb::make_plan<decltype(storage)>(root_type, gets, sets);
+		return planned.gets[0](storage, values::value(values::unit()));
+	}
+
+	values::value make_groups(std::vector<std::pair<std::uint8_t, std::uint64_t>> const &groups)
+	{
+		std::vector<values::value> result;
+		for (auto const &group : groups)
+		{
+			std::vector<values::value> pair;
+			pair.emplace_back(values::make_unsigned_integer(group.first));
+			pair.emplace_back(values::make_unsigned_integer(group.second));
+			result.emplace_back(values::tuple(std::move(pair)));
+		}
+		return values::tuple(std::move(result));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(group_by_sum)
+{
+	Si::optional<values::value> const grouped = run_group_by(expr::aggregate_function::sum);
+	BOOST_REQUIRE(grouped);
+	BOOST_CHECK_EQUAL(make_groups({{1, 12}, {2, 4}, {3, 2}}), *grouped);
+}
+
+BOOST_AUTO_TEST_CASE(group_by_count)
+{
+	Si::optional<values::value> const grouped = run_group_by(expr::aggregate_function::count);
+	BOOST_REQUIRE(grouped);
+	BOOST_CHECK_EQUAL(make_groups({{1, 2}, {2, 2}, {3, 1}}), *grouped);
+}
+
+BOOST_AUTO_TEST_CASE(group_by_max)
+{
+	Si::optional<values::value> const grouped = run_group_by(expr::aggregate_function::max);
+	BOOST_REQUIRE(grouped);
+	BOOST_CHECK_EQUAL(make_groups({{1, 7}, {2, 3}, {3, 2}}), *grouped);
+}
@@ -0,0 +1,102 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	template <class BitSink, class Unsigned>
+	void serialize_array(BitSink &writer, std::vector<Unsigned> const &elements)
+	{
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(elements.size())));
+		for (Unsigned element : elements)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(element)));
+		}
+	}
+
+	expr::expression make_root_array(std::size_t index)
+	{
+		return expr::make_tuple_at(expr::expression(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+		                           index);
+	}
+
+	expr::expression make_key(expr::expression body)
+	{
+		return expr::lambda(Si::make_unique<expr::expression>(std::move(body)),
+		                    Si::make_unique<expr::expression>(expr::literal(values::unit())));
+	}
+
+	expr::expression make_high_byte_key()
+	{
+		std::vector<expr::expression> bits;
+		for (std::size_t i = 0; i < 8; ++i)
+		{
+			bits.emplace_back(expr::make_tuple_at(expr::expression(expr::argument()), i));
+		}
+		return expr::make_tuple(std::move(bits));
+	}
+
+	values::value make_pair(std::uint16_t left, std::uint8_t right)
+	{
+		std::vector<values::value> elements;
+		elements.emplace_back(values::make_unsigned_integer(left));
+		elements.emplace_back(values::make_unsigned_integer(right));
+		return values::tuple(std::move(elements));
+	}
+
+	Si::optional<values::value> run_join(expr::expression right_key)
+	{
+		types::type const root_type =
+		    types::make_tuple(types::array(Si::make_unique<types::type>(types::make_unsigned_integer(16))),
+		                      types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8))));
+
+		staticdb::memory_storage storage;
+		{
+			auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(storage.memory));
+			serialize_array(writer, std::vector<std::uint16_t>{0x010a, 0x0214, 0x0215, 0x031e});
+			serialize_array(writer, std::vector<std::uint8_t>{2, 3, 4});
+		}
+
+		expr::expression const join(expr::join(
+		    Si::make_unique<expr::expression>(make_root_array(0)), Si::make_unique<expr::expression>(make_root_array(1)),
+		    Si::make_unique<expr::expression>(make_key(make_high_byte_key())),
+		    Si::make_unique<expr::expression>(make_key(std::move(right_key)))));
+		Si::iterator_range<staticdb::get_function const *> gets(&join, &join + 1);
+		Si::iterator_range<staticdb::set_function const *> sets;
+		staticdb::basic_plan<decltype(storage)> const planned =
+		    staticdb::make_plan<decltype(storage)>(root_type, gets, sets);
+		return planned.gets[0](storage, values::value(values::unit()));
+	}
+
+	values::value expected_join_result()
+	{
+		std::vector<values::value> pairs;
+		pairs.emplace_back(make_pair(0x0214, 2));
+		pairs.emplace_back(make_pair(0x0215, 2));
+		pairs.emplace_back(make_pair(0x031e, 3));
+		return values::tuple(std::move(pairs));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(join_on_packed_key_bits)
+{
+	Si::optional<values::value> const joined = run_join(expr::argument());
+	BOOST_REQUIRE(joined);
+	BOOST_CHECK_EQUAL(expected_join_result(), *joined);
+}
+
+BOOST_AUTO_TEST_CASE(join_with_evaluated_key)
+{
+	std::vector<expr::expression> key_parts;
+	key_parts.emplace_back(expr::literal(values::tuple()));
+	key_parts.emplace_back(expr::argument());
+	Si::optional<values::value> const joined = run_join(expr::make_tuple(std::move(key_parts)));
+	BOOST_REQUIRE(joined);
+	BOOST_CHECK_EQUAL(expected_join_result(), *joined);
+}
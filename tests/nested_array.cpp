@@ -0,0 +1,56 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/execution.hpp>
+
+namespace
+{
+	staticdb::values::value make_inner(std::uint8_t length)
+	{
+		std::vector<staticdb::values::value> elements;
+		for (std::uint8_t i = 0; i < length; ++i)
+		{
+			elements.emplace_back(staticdb::values::make_unsigned_integer(static_cast<std::uint8_t>(length + i)));
+		}
+		return staticdb::values::tuple(std::move(elements));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(nested_array_offsets)
+{
+	namespace types = staticdb::types;
+	namespace layouts = staticdb::layouts;
+	namespace values = staticdb::values;
+	namespace execution = staticdb::execution;
+	layouts::layout const root = layouts::calculate(types::array(Si::make_unique<types::type>(
+	    types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8))))));
+	BOOST_CHECK(!layouts::has_fixed_size(root));
+
+	std::vector<values::value> outer;
+	for (std::uint8_t i = 0; i < 10; ++i)
+	{
+		outer.emplace_back(make_inner(i));
+	}
+	values::value const expected = values::tuple(staticdb::copy(outer));
+	staticdb::bit_buffer encoded;
+	layouts::serialize(encoded, expected, root);
+	staticdb::memory_storage storage;
+	storage.memory = encoded.bytes();
+
+	// 45 inner elements and 10 inner lengths, so the last offset is 1000 and needs 10 bits
+	staticdb::address const inner_bits = (45u * 8u) + (10u * 64u);
+	execution::storage_pointer<staticdb::memory_storage const> const begin(storage, 0);
+	BOOST_CHECK_EQUAL(64u + 8u + (11u * 10u) + inner_bits, *execution::stored_size_in_bits(begin, root).value());
+
+	layouts::layout const &inner = *Si::try_get_ptr<layouts::array>(root.as_variant())->element;
+	for (std::uint8_t i = 0; i < 10; ++i)
+	{
+		Si::optional<execution::pseudo_value<staticdb::memory_storage const>> const found =
+		    execution::array_get(begin, i, inner);
+		BOOST_REQUIRE(found);
+		execution::basic_array_accessor<staticdb::memory_storage const> const *const child =
+		    Si::try_get_ptr<execution::basic_array_accessor<staticdb::memory_storage const>>(*found);
+		BOOST_REQUIRE(child);
+		BOOST_CHECK_EQUAL(i, execution::array_length(child->begin));
+		BOOST_CHECK_EQUAL(make_inner(i), execution::reduce_value(*found));
+	}
+	BOOST_CHECK_EQUAL(expected, execution::reduce_value(execution::access_value(begin, root)));
+}
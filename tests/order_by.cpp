@@ -0,0 +1,76 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	using staticdb_tests::make_uint8_tuple;
+
+	Si::optional<values::value> run_order_by(std::unique_ptr<expr::expression> limit)
+	{
+		types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+
+		staticdb::memory_storage storage;
+		{
+			auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(storage.memory));
+			std::vector<std::uint8_t> const elements{5, 3, 200, 1, 3};
+			values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(elements.size())));
+			for (std::uint8_t element : elements)
+			{
+				values::serialize(writer, values::value(values::make_unsigned_integer(element)));
+			}
+		}
+
+		auto input = Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0));
+		auto key = Si::make_unique<expr::expression>(
+		    expr::lambda(Si::make_unique<expr::expression>(expr::argument()),
+		                 Si::make_unique<expr::expression>(expr::literal(values::unit()))));
+		expr::expression const sorted =
+		    limit ? expr::order_by(std::move(input), std::move(key), std::move(limit))
+		          : expr::order_by(std::move(input), std::move(key));
+		Si::iterator_range<staticdb::get_function const *> gets(&sorted, &sorted + 1);
+		Si::iterator_range<staticdb::set_function const *> sets;
+		staticdb::basic_plan<decltype(storage)> const planned =
+		    staticdb::make_plan<decltype(storage)>(root_type, gets, sets);
+		return planned.gets[0](storage, values::value(values::unit()));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(order_by_radix_sort)
+{
+	Si::optional<values::value> const sorted = run_order_by(nullptr);
+	BOOST_REQUIRE(sorted);
+	BOOST_CHECK_EQUAL(make_uint8_tuple({1, 3, 3, 5, 200}), *sorted);
+}
+
+BOOST_AUTO_TEST_CASE(order_by_top_k)
+{
+	Si::optional<values::value> const sorted = run_order_by(
+	    Si::make_unique<expr::expression>(expr::literal(values::make_unsigned_integer<std::uint8_t>(3))));
+	BOOST_REQUIRE(sorted);
+	BOOST_CHECK_EQUAL(make_uint8_tuple({1, 3, 3}), *sorted);
+}
+
+BOOST_AUTO_TEST_CASE(radix_sort_is_stable)
+{
+	std::vector<staticdb::execution::sort_entry> entries;
+	entries.emplace_back(0x1234, 0);
+	entries.emplace_back(0x0034, 1);
+	entries.emplace_back(0x1200, 2);
+	entries.emplace_back(0x0034, 3);
+	staticdb::execution::radix_sort(entries, 16);
+	std::vector<staticdb::address> indices;
+	for (staticdb::execution::sort_entry const &entry : entries)
+	{
+		indices.emplace_back(entry.index);
+	}
+	std::vector<staticdb::address> const expected{1, 3, 2, 0};
+	BOOST_CHECK_EQUAL_COLLECTIONS(expected.begin(), expected.end(), indices.begin(), indices.end());
+}
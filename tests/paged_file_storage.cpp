@@ -0,0 +1,151 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/paged_file_storage.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include <atomic>
+#include <thread>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	using staticdb_tests::temporary_file;
+
+	void write_file(char const *path, std::vector<staticdb::byte> const &content)
+	{
+		staticdb::file_storage file(path);
+		staticdb::byte const *const begin = content.data();
+		file.write_at(0).append(Si::make_iterator_range(begin, begin + content.size()));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(paged_file_storage_reads_and_evicts)
+{
+	temporary_file const file("staticdb_paged_file_storage_reads_and_evicts.bin");
+	std::vector<staticdb::byte> content(1000);
+	for (std::size_t i = 0; i < content.size(); ++i)
+	{
+		content[i] = static_cast<staticdb::byte>(i * 13);
+	}
+	write_file(file.path, content);
+	staticdb::paged_file_storage storage(file.path, 16, 4, 2);
+	auto reader = storage.read_at(5);
+	for (std::size_t i = 5; i < content.size(); ++i)
+	{
+		Si::optional<staticdb::byte> const read = Si::get(reader);
+		BOOST_REQUIRE(read);
+		BOOST_REQUIRE_EQUAL(content[i], *read);
+	}
+	BOOST_CHECK(!Si::get(reader));
+	BOOST_CHECK_GT(storage.pages_read_ahead(), 0u);
+	BOOST_CHECK_LT(storage.misses(), 63u);
+
+	std::array<staticdb::byte, 40> scratch;
+	Si::iterator_range<staticdb::byte const *> const span = storage.read_span(10, scratch.size(), scratch.data());
+	BOOST_REQUIRE_EQUAL(scratch.size(), static_cast<std::size_t>(span.size()));
+	BOOST_CHECK(std::equal(span.begin(), span.end(), content.begin() + 10));
+	BOOST_CHECK_EQUAL(3, storage.read_span(997, 10, scratch.data()).size());
+}
+
+BOOST_AUTO_TEST_CASE(paged_file_storage_pins_pages)
+{
+	temporary_file const file("staticdb_paged_file_storage_pins_pages.bin");
+	write_file(file.path, std::vector<staticdb::byte>(64, 7));
+	staticdb::paged_file_storage storage(file.path, 16, 2, 0);
+	{
+		staticdb::paged_file_storage::page_handle const first = storage.pin(0);
+		staticdb::paged_file_storage::page_handle const second = storage.pin(3);
+		BOOST_CHECK_THROW(storage.pin(1), std::runtime_error);
+		BOOST_CHECK_EQUAL(16, first.bytes().size());
+	}
+	staticdb::paged_file_storage::page_handle const again = storage.pin(0);
+	BOOST_CHECK_EQUAL(1u, storage.hits());
+	BOOST_CHECK_EQUAL(3u, storage.misses());
+}
+
+BOOST_AUTO_TEST_CASE(paged_file_storage_concurrent_misses)
+{
+	temporary_file const file("staticdb_paged_file_storage_concurrent_misses.bin");
+	std::vector<staticdb::byte> content(4096);
+	for (std::size_t i = 0; i < content.size(); ++i)
+	{
+		content[i] = static_cast<staticdb::byte>(i * 31);
+	}
+	write_file(file.path, content);
+	staticdb::paged_file_storage const storage(file.path, 16, 8, 2);
+	std::atomic<std::size_t> mismatches(0);
+	std::vector<std::thread> readers;
+	for (std::size_t t = 0; t < 4; ++t)
+	{
+		readers.emplace_back([&storage, &content, &mismatches, t]()
+		                     {
+			                     std::array<staticdb::byte, 24> scratch;
+			                     for (std::size_t where = t * 7; (where + scratch.size()) <= content.size(); where += 5)
+			                     {
+				                     Si::iterator_range<staticdb::byte const *> const span =
+				                         storage.read_span(where, scratch.size(), scratch.data());
+				                     if ((static_cast<std::size_t>(span.size()) != scratch.size()) ||
+				                         !std::equal(span.begin(), span.end(), content.begin() + where))
+				                     {
+					                     ++mismatches;
+				                     }
+			                     }
+			                 });
+	}
+	for (std::thread &reader : readers)
+	{
+		reader.join();
+	}
+	BOOST_CHECK_EQUAL(0u, mismatches.load());
+}
+
+BOOST_AUTO_TEST_CASE(paged_file_storage_writes_through_cached_pages)
+{
+	temporary_file const file("staticdb_paged_file_storage_writes_through_cached_pages.bin");
+	write_file(file.path, std::vector<staticdb::byte>(20, 1));
+	staticdb::paged_file_storage storage(file.path, 16, 4);
+	std::array<staticdb::byte, 8> scratch;
+	BOOST_CHECK_EQUAL(4, storage.read_span(16, scratch.size(), scratch.data()).size());
+	std::array<staticdb::byte, 6> const written = {{2, 3, 4, 5, 6, 7}};
+	storage.write_at(18).append(Si::make_iterator_range(written.data(), written.data() + written.size()));
+	Si::iterator_range<staticdb::byte const *> const span = storage.read_span(16, scratch.size(), scratch.data());
+	std::array<staticdb::byte, 8> const expected = {{1, 1, 2, 3, 4, 5, 6, 7}};
+	BOOST_REQUIRE_EQUAL(expected.size(), static_cast<std::size_t>(span.size()));
+	BOOST_CHECK(std::equal(span.begin(), span.end(), expected.begin()));
+}
+
+BOOST_AUTO_TEST_CASE(paged_file_storage_runs_plan)
+{
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	temporary_file const file("staticdb_paged_file_storage_runs_plan.bin");
+	{
+		std::vector<staticdb::byte> content;
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(content));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(256)));
+		for (unsigned i = 0; i < 256; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(static_cast<std::uint8_t>(i))));
+		}
+		write_file(file.path, content);
+	}
+	staticdb::paged_file_storage const storage(file.path, 32, 3);
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::basic_plan<staticdb::paged_file_storage const> const planned =
+	    staticdb::make_plan<staticdb::paged_file_storage const>(root_type, gets, sets);
+	Si::optional<values::value> const found = planned.gets[0](storage, values::value(values::make_unsigned_integer(
+	                                                                        static_cast<std::uint8_t>(200))));
+	BOOST_REQUIRE(found);
+	std::vector<values::value> expected;
+	expected.emplace_back(values::make_unsigned_integer(static_cast<std::uint8_t>(200)));
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *found);
+	BOOST_CHECK_GT(storage.hits(), 0u);
+	BOOST_CHECK_GT(storage.pages_read_ahead(), 0u);
+}
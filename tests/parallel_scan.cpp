@@ -0,0 +1,71 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include <atomic>
+
+BOOST_AUTO_TEST_CASE(work_stealing_pool_runs_every_task_once)
+{
+	staticdb::work_stealing_pool pool(3);
+	std::vector<std::atomic<int>> runs(1000);
+	for (std::atomic<int> &run : runs)
+	{
+		run = 0;
+	}
+	BOOST_REQUIRE(pool.try_run(runs.size(), [&runs](std::size_t i)
+	                           {
+		                           ++runs[i];
+		                       }));
+	for (std::atomic<int> const &run : runs)
+	{
+		BOOST_CHECK_EQUAL(1, run.load());
+	}
+	BOOST_CHECK_THROW(pool.try_run(10,
+	                               [](std::size_t i)
+	                               {
+		                               if (i == 7)
+		                               {
+			                               throw std::runtime_error("task failed");
+		                               }
+		                           }),
+	                  std::runtime_error);
+}
+
+BOOST_AUTO_TEST_CASE(parallel_filter_keeps_index_order)
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+
+	staticdb::memory_storage storage;
+	{
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(storage.memory));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(100)));
+		for (std::uint8_t i = 0; i < 100; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(i)));
+		}
+	}
+
+	expr::lambda always(Si::make_unique<expr::expression>(expr::literal(values::bit(true))),
+	                    Si::make_unique<expr::expression>(expr::literal(values::unit())));
+	expr::expression const everything(
+	    expr::filter(Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+	                 Si::make_unique<expr::expression>(std::move(always))));
+	Si::iterator_range<staticdb::get_function const *> gets(&everything, &everything + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::execution::scan_options const options(std::make_shared<staticdb::work_stealing_pool>(3), 0, 7);
+	staticdb::basic_plan<decltype(storage)> const planned =
+	    staticdb::make_plan<decltype(storage)>(root_type, gets, sets, options);
+
+	Si::optional<values::value> const found = planned.gets[0](storage, values::value(values::unit()));
+	BOOST_REQUIRE(found);
+	std::vector<values::value> expected;
+	for (std::uint8_t i = 0; i < 100; ++i)
+	{
+		expected.emplace_back(values::make_unsigned_integer(i));
+	}
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *found);
+}
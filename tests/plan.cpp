@@ -3,6 +3,7 @@
 #include <staticdb/expressions.hpp>
 #include <staticdb/bit_sink.hpp>
 #include <silicium/sink/iterator_sink.hpp>
+#include "test_support.hpp"
 
 BOOST_AUTO_TEST_CASE(trivial_plan)
 {
@@ -64,3 +65,74 @@ BOOST_AUTO_TEST_CASE(find_uint_in_array_plan)
 	result_set.emplace_back(staticdb::values::make_unsigned_integer<std::uint8_t>(2));
 	BOOST_CHECK_EQUAL(staticdb::values::value(staticdb::values::tuple(std::move(result_set))), *found);
 }
+
+namespace
+{
+	using staticdb_tests::make_u13;
+
+	std::vector<staticdb::byte> serialize_u13_array(std::vector<std::uint64_t> const &elements)
+	{
+		std::vector<staticdb::byte> result;
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(result));
+		staticdb::values::serialize(
+		    writer, staticdb::values::value(staticdb::values::make_unsigned_integer<std::uint64_t>(elements.size())));
+		for (std::uint64_t element : elements)
+		{
+			staticdb::values::serialize(writer, make_u13(element));
+		}
+		writer.flush();
+		return result;
+	}
+
+	staticdb::values::value make_assignment(std::uint32_t index, std::uint64_t element)
+	{
+		std::vector<staticdb::values::value> parts;
+		parts.emplace_back(staticdb::values::make_unsigned_integer(index));
+		parts.emplace_back(make_u13(element));
+		return staticdb::values::value(staticdb::values::tuple(std::move(parts)));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(set_array_element_in_place)
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(13)));
+
+	std::vector<std::uint64_t> elements;
+	for (std::uint64_t i = 0; i < 20; ++i)
+	{
+		elements.emplace_back((i * 1009u) % 8192u);
+	}
+	staticdb::memory_storage storage;
+	storage.memory = serialize_u13_array(elements);
+
+	std::vector<expr::expression> assignment;
+	assignment.emplace_back(expr::make_tuple_at(expr::expression(expr::argument()), 0));
+	assignment.emplace_back(expr::make_tuple_at(expr::make_tuple_at(expr::expression(expr::argument()), 1), 0));
+	assignment.emplace_back(expr::make_tuple_at(expr::make_tuple_at(expr::expression(expr::argument()), 1), 1));
+	expr::expression const set_element((expr::make_tuple(std::move(assignment))));
+	Si::iterator_range<staticdb::get_function const *> gets;
+	Si::iterator_range<staticdb::set_function const *> sets(&set_element, &set_element + 1);
+	auto const planned = staticdb::make_plan<staticdb::memory_storage>(root_type, gets, sets);
+	BOOST_REQUIRE_EQUAL(1u, planned.sets.size());
+
+	for (std::uint32_t i = 0; i < elements.size(); ++i)
+	{
+		std::uint64_t const new_element = 8191u - i;
+		BOOST_CHECK_EQUAL(make_u13(elements[i]), planned.sets[0](storage, make_assignment(i, new_element)));
+		elements[i] = new_element;
+		std::vector<staticdb::byte> const expected = serialize_u13_array(elements);
+		BOOST_REQUIRE_EQUAL_COLLECTIONS(expected.begin(), expected.end(), storage.memory.begin(),
+		                                storage.memory.end());
+	}
+
+	BOOST_CHECK_THROW(planned.sets[0](storage, make_assignment(20, 0)), std::invalid_argument);
+	std::vector<staticdb::values::value> too_short;
+	too_short.emplace_back(staticdb::values::make_unsigned_integer<std::uint32_t>(0));
+	too_short.emplace_back(staticdb::values::make_unsigned_integer<std::uint8_t>(0));
+	BOOST_CHECK_THROW(planned.sets[0](storage, staticdb::values::value(staticdb::values::tuple(std::move(too_short)))),
+	                  std::invalid_argument);
+	BOOST_CHECK_THROW(staticdb::make_plan<staticdb::memory_storage const>(root_type, gets, sets),
+	                  std::invalid_argument);
+}
@@ -0,0 +1,194 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan_file.hpp>
+#include <staticdb/file_storage.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+	namespace file_format = staticdb::file_format;
+
+	types::type make_root_type(std::size_t element_bits)
+	{
+		return types::array(Si::make_unique<types::type>(types::make_unsigned_integer(element_bits)));
+	}
+
+	std::vector<staticdb::byte> make_data()
+	{
+		std::vector<staticdb::byte> data;
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(data));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(50)));
+		for (std::uint8_t i = 0; i < 50; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(static_cast<std::uint8_t>(i % 5))));
+		}
+		return data;
+	}
+
+	std::vector<expr::expression> make_gets()
+	{
+		std::vector<expr::expression> gets;
+		gets.emplace_back(staticdb_tests::make_find_equals());
+		gets.emplace_back(expr::group_by(
+		    Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+		    Si::make_unique<expr::expression>(
+		        expr::lambda(Si::make_unique<expr::expression>(expr::argument()),
+		                     Si::make_unique<expr::expression>(expr::literal(values::unit())))),
+		    expr::aggregate_function::count));
+		return gets;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(stored_plan_runs_like_a_fresh_one)
+{
+	std::vector<expr::expression> const gets = make_gets();
+	Si::iterator_range<staticdb::get_function const *> get_range(gets.data(), gets.data() + gets.size());
+	Si::iterator_range<staticdb::set_function const *> sets;
+	std::vector<file_format::index_content> plans;
+	plans.emplace_back(file_format::plan_content(7, make_root_type(8), get_range, sets, {}));
+	staticdb::memory_storage storage;
+	file_format::write_database(storage, make_root_type(8), make_data(), std::vector<file_format::index_content>(),
+	                            plans);
+
+	file_format::database const opened = file_format::open_database(storage);
+	auto const loaded = file_format::load_plan(storage, opened, 7, staticdb::execution::scan_options());
+	BOOST_REQUIRE_EQUAL(2u, loaded.gets.size());
+	auto data = file_format::open_section(storage, opened.data);
+	staticdb::memory_storage fresh_storage;
+	fresh_storage.memory = make_data();
+	auto const fresh = staticdb::make_plan<staticdb::memory_storage>(make_root_type(8), get_range, sets);
+	for (std::uint8_t key = 0; key < 6; ++key)
+	{
+		values::value const argument(values::make_unsigned_integer(key));
+		BOOST_CHECK_EQUAL(*fresh.gets[0](fresh_storage, argument), *loaded.gets[0](data, argument));
+	}
+	BOOST_CHECK_EQUAL(*fresh.gets[1](fresh_storage, values::value(values::unit())),
+	                  *loaded.gets[1](data, values::value(values::unit())));
+	BOOST_CHECK_THROW(file_format::load_plan(storage, opened, 8, staticdb::execution::scan_options()),
+	                  std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(stored_plan_loads_from_a_read_only_file)
+{
+	std::vector<expr::expression> const gets = make_gets();
+	Si::iterator_range<staticdb::get_function const *> get_range(gets.data(), gets.data() + gets.size());
+	Si::iterator_range<staticdb::set_function const *> sets;
+	std::vector<file_format::index_content> plans;
+	plans.emplace_back(file_format::plan_content(7, make_root_type(8), get_range, sets, {}));
+	staticdb_tests::temporary_file const file("staticdb_stored_plan_loads_from_a_read_only_file.bin");
+	{
+		staticdb::file_storage writable(file.path);
+		file_format::write_database(writable, make_root_type(8), make_data(),
+		                            std::vector<file_format::index_content>(), plans);
+	}
+	staticdb::file_storage const storage(file.path);
+	typedef file_format::section_storage<staticdb::file_storage const> read_only_section;
+	BOOST_STATIC_ASSERT(!staticdb::is_writable_storage<read_only_section>::value);
+
+	file_format::database const opened = file_format::open_database(storage);
+	auto const loaded = file_format::load_plan(storage, opened, 7, staticdb::execution::scan_options());
+	auto data = file_format::open_section(storage, opened.data);
+	std::vector<values::value> found;
+	for (std::uint8_t i = 0; i < 10; ++i)
+	{
+		found.emplace_back(values::make_unsigned_integer<std::uint8_t>(3));
+	}
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(found))),
+	                  *loaded.gets[0](data, values::value(values::make_unsigned_integer<std::uint8_t>(3))));
+}
+
+BOOST_AUTO_TEST_CASE(stored_plan_checks_schema_and_indexes)
+{
+	std::vector<expr::expression> const gets = make_gets();
+	Si::iterator_range<staticdb::get_function const *> get_range(gets.data(), gets.data() + gets.size());
+	Si::iterator_range<staticdb::set_function const *> sets;
+	std::vector<file_format::index_content> plans;
+	plans.emplace_back(file_format::plan_content(1, make_root_type(16), get_range, sets, {}));
+	plans.emplace_back(file_format::plan_content(2, make_root_type(8), get_range, sets, {99}));
+	plans.emplace_back(file_format::plan_content(3, make_root_type(8), get_range, sets, {}));
+	// a plan from before variant values stored their possibility
+	plans.back().content[3] = 1;
+	staticdb::memory_storage storage;
+	file_format::write_database(storage, make_root_type(8), make_data(), std::vector<file_format::index_content>(),
+	                            plans);
+	file_format::database const opened = file_format::open_database(storage);
+	BOOST_CHECK_THROW(file_format::load_plan(storage, opened, 1, staticdb::execution::scan_options()),
+	                  std::invalid_argument);
+	BOOST_CHECK_THROW(file_format::load_plan(storage, opened, 2, staticdb::execution::scan_options()),
+	                  std::invalid_argument);
+	BOOST_CHECK_THROW(file_format::load_plan(storage, opened, 3, staticdb::execution::scan_options()),
+	                  std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(stored_plan_hashes_the_written_layout)
+{
+	namespace layouts = staticdb::layouts;
+	std::vector<values::value> elements;
+	for (std::uint8_t i = 0; i < 50; ++i)
+	{
+		elements.emplace_back(values::make_unsigned_integer(static_cast<std::uint8_t>(i % 5)));
+	}
+	layouts::layout const root_layout(
+	    layouts::array(Si::make_unique<layouts::layout>(layouts::layout(layouts::bitset(8))),
+	                   layouts::bitset_encoding::frame_of_reference));
+	staticdb::bit_buffer encoded;
+	layouts::serialize(encoded, values::value(values::tuple(std::move(elements))), root_layout);
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> get_range(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	std::vector<file_format::index_content> plans;
+	plans.emplace_back(file_format::plan_content(1, make_root_type(8), root_layout, get_range, sets, {}));
+	plans.emplace_back(file_format::plan_content(2, make_root_type(8), get_range, sets, {}));
+	staticdb::memory_storage storage;
+	file_format::write_database(storage, make_root_type(8), root_layout, encoded.bytes(),
+	                            std::vector<file_format::index_content>(), plans);
+
+	file_format::database const opened = file_format::open_database(storage);
+	auto const loaded = file_format::load_plan(storage, opened, 1, staticdb::execution::scan_options());
+	auto data = file_format::open_section(storage, opened.data);
+	Si::optional<values::value> const found =
+	    loaded.gets[0](data, values::value(values::make_unsigned_integer(static_cast<std::uint8_t>(3))));
+	BOOST_REQUIRE(found);
+	values::tuple const *const matches = Si::try_get_ptr<values::tuple>(found->as_variant());
+	BOOST_REQUIRE(matches);
+	BOOST_CHECK_EQUAL(10u, matches->elements.size());
+	// a plan for the calculated layout does not match the file
+	BOOST_CHECK_THROW(file_format::load_plan(storage, opened, 2, staticdb::execution::scan_options()),
+	                  std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(expression_serialization_round_trip)
+{
+	std::vector<expr::expression> originals;
+	originals.emplace_back(expr::literal(values::value(values::make_unsigned_integer(std::uint8_t(42)))));
+	originals.emplace_back(expr::order_by(Si::make_unique<expr::expression>(expr::argument()),
+	                                      Si::make_unique<expr::expression>(expr::bound()),
+	                                      Si::make_unique<expr::expression>(expr::argument())));
+	originals.emplace_back(expr::branch(Si::make_unique<expr::expression>(expr::argument()),
+	                                    Si::make_unique<expr::expression>(expr::bound()),
+	                                    Si::make_unique<expr::expression>(expr::argument())));
+	for (expr::expression const &original : originals)
+	{
+		std::vector<staticdb::byte> first;
+		file_format::serialize_expression(first, original);
+		staticdb::byte const *const begin = first.data();
+		file_format::byte_reader input(Si::make_iterator_range(begin, begin + first.size()));
+		expr::expression const restored = file_format::deserialize_expression(input);
+		BOOST_CHECK(input.empty());
+		std::vector<staticdb::byte> second;
+		file_format::serialize_expression(second, restored);
+		BOOST_CHECK(first == second);
+	}
+	std::vector<staticdb::byte> truncated;
+	file_format::serialize_expression(truncated, originals[1]);
+	truncated.pop_back();
+	staticdb::byte const *const begin = truncated.data();
+	file_format::byte_reader input(Si::make_iterator_range(begin, begin + truncated.size()));
+	BOOST_CHECK_THROW(file_format::deserialize_expression(input), std::invalid_argument);
+}
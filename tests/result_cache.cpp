@@ -0,0 +1,107 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/result_cache.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <silicium/sink/iterator_sink.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	using staticdb_tests::make_uint8_tuple;
+
+	void fill_storage(staticdb::memory_storage &storage, std::vector<std::uint8_t> const &elements)
+	{
+		storage.memory.clear();
+		auto writer = staticdb::make_bits_to_byte_sink(Si::make_container_sink(storage.memory));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(elements.size())));
+		for (std::uint8_t element : elements)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(element)));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(result_cache_hit_and_invalidate)
+{
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	staticdb::memory_storage storage;
+	fill_storage(storage, {1, 2, 2, 3});
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::basic_plan<decltype(storage)> planned = staticdb::make_plan<decltype(storage)>(root_type, gets, sets);
+	auto cache = std::make_shared<staticdb::result_cache>(64);
+	staticdb::cache_results(planned, cache);
+
+	values::value const key = values::make_unsigned_integer<std::uint8_t>(2);
+	Si::optional<values::value> const first = planned.gets[0](storage, key);
+	BOOST_REQUIRE(first);
+	BOOST_CHECK_EQUAL(make_uint8_tuple({2, 2}), *first);
+	BOOST_CHECK_EQUAL(0u, cache->hits());
+	BOOST_CHECK_EQUAL(1u, cache->misses());
+
+	fill_storage(storage, {2, 3});
+	Si::optional<values::value> const second = planned.gets[0](storage, key);
+	BOOST_REQUIRE(second);
+	BOOST_CHECK_EQUAL(make_uint8_tuple({2, 2}), *second);
+	BOOST_CHECK_EQUAL(1u, cache->hits());
+
+	cache->invalidate();
+	Si::optional<values::value> const third = planned.gets[0](storage, key);
+	BOOST_REQUIRE(third);
+	BOOST_CHECK_EQUAL(make_uint8_tuple({2}), *third);
+	BOOST_CHECK_EQUAL(2u, cache->misses());
+}
+
+BOOST_AUTO_TEST_CASE(result_cache_evicts_least_recently_used)
+{
+	staticdb::result_cache cache(2, 1);
+	for (std::uint8_t i = 0; i < 3; ++i)
+	{
+		cache.insert(staticdb::make_result_cache_key(0, values::make_unsigned_integer(i)),
+		             values::value(values::make_unsigned_integer(i)), cache.generation());
+		if (i == 1)
+		{
+			BOOST_CHECK(cache.find(staticdb::make_result_cache_key(0, values::make_unsigned_integer<std::uint8_t>(0))));
+		}
+	}
+	BOOST_CHECK(cache.find(staticdb::make_result_cache_key(0, values::make_unsigned_integer<std::uint8_t>(0))));
+	BOOST_CHECK(!cache.find(staticdb::make_result_cache_key(0, values::make_unsigned_integer<std::uint8_t>(1))));
+	BOOST_CHECK(cache.find(staticdb::make_result_cache_key(0, values::make_unsigned_integer<std::uint8_t>(2))));
+	BOOST_CHECK(!cache.find(staticdb::make_result_cache_key(1, values::make_unsigned_integer<std::uint8_t>(2))));
+}
+
+BOOST_AUTO_TEST_CASE(result_cache_rejects_zero_shards)
+{
+	BOOST_CHECK_THROW(staticdb::result_cache(10, 0), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(result_cache_keys_keep_the_shape_of_arguments)
+{
+	// Each pair serializes to the same bits, but the arguments differ.
+	auto const check_distinct = [](values::value const &cached, values::value const &other)
+	{
+		staticdb::result_cache cache(4, 1);
+		cache.insert(staticdb::make_result_cache_key(0, cached), values::value(values::unit()), cache.generation());
+		BOOST_CHECK(cache.find(staticdb::make_result_cache_key(0, cached)));
+		BOOST_CHECK(!cache.find(staticdb::make_result_cache_key(0, other)));
+	};
+	check_distinct(values::value(values::make_none()), values::value(values::make_some(values::value(values::unit()))));
+	check_distinct(values::value(values::unit()), values::value(values::tuple()));
+	std::vector<values::value> left_inner;
+	left_inner.emplace_back(values::bit(true));
+	std::vector<values::value> left;
+	left.emplace_back(values::bit(false));
+	left.emplace_back(values::tuple(std::move(left_inner)));
+	std::vector<values::value> right_inner;
+	right_inner.emplace_back(values::bit(false));
+	std::vector<values::value> right;
+	right.emplace_back(values::tuple(std::move(right_inner)));
+	right.emplace_back(values::bit(true));
+	check_distinct(values::value(values::tuple(std::move(left))), values::value(values::tuple(std::move(right))));
+}
@@ -0,0 +1,74 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/segmented_memory_storage.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include "test_support.hpp"
+
+BOOST_AUTO_TEST_CASE(segmented_memory_storage_spans_segments)
+{
+	staticdb::segmented_memory_storage storage(16);
+	std::vector<staticdb::byte> written(100);
+	for (std::size_t i = 0; i < written.size(); ++i)
+	{
+		written[i] = static_cast<staticdb::byte>(i + 1);
+	}
+	staticdb::byte const *const begin = written.data();
+	storage.write_at(0).append(Si::make_iterator_range(begin, begin + 50));
+	storage.write_at(50).append(Si::make_iterator_range(begin + 50, begin + written.size()));
+	BOOST_CHECK_EQUAL(100u, storage.size());
+
+	std::array<staticdb::byte, 20> scratch;
+	Si::iterator_range<staticdb::byte const *> const inside = storage.read_span(33, 10, scratch.data());
+	BOOST_CHECK(inside.begin() != scratch.data());
+	BOOST_CHECK(std::equal(inside.begin(), inside.end(), written.begin() + 33));
+	Si::iterator_range<staticdb::byte const *> const across = storage.read_span(40, 20, scratch.data());
+	BOOST_CHECK(across.begin() == scratch.data());
+	BOOST_REQUIRE_EQUAL(20, across.size());
+	BOOST_CHECK(std::equal(across.begin(), across.end(), written.begin() + 40));
+	BOOST_CHECK_EQUAL(5, storage.read_span(95, 20, scratch.data()).size());
+
+	auto reader = storage.read_at(7);
+	for (std::size_t i = 7; i < written.size(); ++i)
+	{
+		Si::optional<staticdb::byte> const read = Si::get(reader);
+		BOOST_REQUIRE(read);
+		BOOST_REQUIRE_EQUAL(written[i], *read);
+	}
+	BOOST_CHECK(!Si::get(reader));
+
+	storage.write_at(120);
+	BOOST_CHECK_EQUAL(120u, storage.size());
+	auto gap = storage.read_at(110);
+	BOOST_CHECK_EQUAL(0, *Si::get(gap));
+}
+
+BOOST_AUTO_TEST_CASE(segmented_memory_storage_runs_plan)
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(16)));
+
+	staticdb::segmented_memory_storage storage(32);
+	{
+		auto writer = staticdb::make_bits_to_byte_sink(storage.write_at(0));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(300)));
+		for (std::uint16_t i = 0; i < 300; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(static_cast<std::uint16_t>(i * 3))));
+		}
+	}
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::basic_plan<staticdb::segmented_memory_storage> const planned =
+	    staticdb::make_plan<staticdb::segmented_memory_storage>(root_type, gets, sets);
+	Si::optional<values::value> const found =
+	    planned.gets[0](storage, values::value(values::make_unsigned_integer(static_cast<std::uint16_t>(597))));
+	BOOST_REQUIRE(found);
+	std::vector<values::value> expected;
+	expected.emplace_back(values::make_unsigned_integer(static_cast<std::uint16_t>(597)));
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *found);
+}
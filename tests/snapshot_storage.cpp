@@ -0,0 +1,105 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/snapshot_storage.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include <staticdb/bit_sink.hpp>
+#include <thread>
+#include "test_support.hpp"
+
+namespace
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+
+	void write_uniform_array(staticdb::snapshot_storage::writer &destination, std::size_t length, std::uint8_t element)
+	{
+		auto writer = staticdb::make_bits_to_byte_sink(destination.write_at(0));
+		values::serialize(writer, values::value(values::make_unsigned_integer<std::uint64_t>(length)));
+		for (std::size_t i = 0; i < length; ++i)
+		{
+			values::serialize(writer, values::value(values::make_unsigned_integer(element)));
+		}
+	}
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_keeps_its_version)
+{
+	staticdb::snapshot_storage storage(16);
+	{
+		staticdb::snapshot_storage::writer writing = storage.write();
+		write_uniform_array(writing, 40, 1);
+		writing.commit();
+	}
+	std::array<staticdb::byte, 4> scratch;
+	{
+		staticdb::snapshot_storage::snapshot const before = storage.read();
+		{
+			staticdb::snapshot_storage::writer writing = storage.write();
+			std::array<staticdb::byte, 2> const changed = {{7, 7}};
+			writing.write_at(20).append(Si::make_iterator_range(changed.data(), changed.data() + changed.size()));
+			writing.commit();
+		}
+		staticdb::snapshot_storage::snapshot const after = storage.read();
+		BOOST_CHECK_EQUAL(1, *before.read_span(20, 1, scratch.data()).begin());
+		BOOST_CHECK_EQUAL(7, *after.read_span(20, 1, scratch.data()).begin());
+		BOOST_CHECK_EQUAL(1, *after.read_span(22, 1, scratch.data()).begin());
+		BOOST_CHECK_EQUAL(48u, after.size());
+		BOOST_CHECK_EQUAL(1u, storage.retired_versions());
+	}
+	storage.collect();
+	BOOST_CHECK_EQUAL(0u, storage.retired_versions());
+
+	{
+		staticdb::snapshot_storage::writer discarded = storage.write();
+		write_uniform_array(discarded, 40, 9);
+	}
+	BOOST_CHECK_EQUAL(7, *storage.read().read_span(20, 1, scratch.data()).begin());
+}
+
+BOOST_AUTO_TEST_CASE(snapshot_readers_run_plans_during_writes)
+{
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	std::size_t const length = 100;
+	staticdb::snapshot_storage storage(16);
+	{
+		staticdb::snapshot_storage::writer writing = storage.write();
+		write_uniform_array(writing, length, 0);
+		writing.commit();
+	}
+
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	Si::iterator_range<staticdb::set_function const *> sets;
+	typedef staticdb::snapshot_storage::snapshot const snapshot;
+	staticdb::basic_plan<snapshot> const planned = staticdb::make_plan<snapshot>(root_type, gets, sets);
+
+	std::size_t inconsistent = 0;
+	std::thread reader([&]()
+	                   {
+		                   for (unsigned i = 0; i < 200; ++i)
+		                   {
+			                   snapshot current = storage.read();
+			                   std::array<staticdb::byte, 1> scratch;
+			                   std::uint8_t const element = *current.read_span(8, 1, scratch.data()).begin();
+			                   Si::optional<values::value> const found =
+			                       planned.gets[0](current, values::value(values::make_unsigned_integer(element)));
+			                   values::tuple const *const matches =
+			                       found ? Si::try_get_ptr<values::tuple>(found->as_variant()) : nullptr;
+			                   if (!matches || (matches->elements.size() != length))
+			                   {
+				                   ++inconsistent;
+			                   }
+		                   }
+		               });
+	for (unsigned i = 1; i <= 200; ++i)
+	{
+		staticdb::snapshot_storage::writer writing = storage.write();
+		write_uniform_array(writing, length, static_cast<std::uint8_t>(i));
+		writing.commit();
+	}
+	reader.join();
+	BOOST_CHECK_EQUAL(0u, inconsistent);
+	storage.collect();
+	BOOST_CHECK_EQUAL(0u, storage.retired_versions());
+}
@@ -101,8 +101,15 @@ BOOST_AUTO_TEST_CASE(one_tuple_conforms_to_type)
 BOOST_AUTO_TEST_CASE(variant_conforms_to_type)
 {
 	staticdb::values::value value =
-	    staticdb::values::variant(Si::to_unique(staticdb::values::value(staticdb::values::unit())));
+	    staticdb::values::variant(1, Si::to_unique(staticdb::values::value(staticdb::values::unit())));
 	BOOST_CHECK(staticdb::values::conforms_to_type(value, variant_bit_unit));
+	// the content has to match the possibility that which selects
+	BOOST_CHECK(!staticdb::values::conforms_to_type(
+	    staticdb::values::variant(0, Si::to_unique(staticdb::values::value(staticdb::values::unit()))),
+	    variant_bit_unit));
+	BOOST_CHECK(!staticdb::values::conforms_to_type(
+	    staticdb::values::variant(2, Si::to_unique(staticdb::values::value(staticdb::values::unit()))),
+	    variant_bit_unit));
 	BOOST_CHECK(!staticdb::values::conforms_to_type(value, unit_type));
 	BOOST_CHECK(!staticdb::values::conforms_to_type(value, bit_type));
 	BOOST_CHECK(!staticdb::values::conforms_to_type(value, empty_tuple_type));
@@ -0,0 +1,47 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/execution.hpp>
+#include <staticdb/file_storage.hpp>
+#include "test_support.hpp"
+
+BOOST_AUTO_TEST_CASE(memory_storage_read_span_points_into_memory)
+{
+	staticdb::memory_storage storage;
+	storage.memory = {1, 2, 3, 4, 5};
+	Si::iterator_range<staticdb::byte const *> const span = storage.read_span(1, 3, nullptr);
+	BOOST_CHECK_EQUAL(storage.memory.data() + 1, span.begin());
+	BOOST_CHECK_EQUAL(3, span.size());
+	BOOST_CHECK_EQUAL(2, storage.read_span(3, 10, nullptr).size());
+	BOOST_CHECK_EQUAL(0, storage.read_span(7, 10, nullptr).size());
+}
+
+BOOST_AUTO_TEST_CASE(read_packed_bits_at_any_offset)
+{
+	staticdb::memory_storage memory;
+	memory.memory = {0x12, 0x34, 0x56, 0x78, 0x9a, 0xbc, 0xde, 0xf0, 0x0f, 0xed};
+	staticdb_tests::temporary_file const temporary("staticdb_read_packed_bits_at_any_offset.bin");
+	staticdb::file_storage file(temporary.path);
+	staticdb::byte const *const begin = memory.memory.data();
+	file.write_at(0).append(Si::make_iterator_range(begin, begin + memory.memory.size()));
+	for (staticdb::address offset = 0; offset <= 16; ++offset)
+	{
+		for (staticdb::address length = 0; (length <= 64) && (offset + length <= 80); ++length)
+		{
+			std::uint64_t expected = 0;
+			for (staticdb::address i = offset; i < offset + length; ++i)
+			{
+				expected = (expected << 1u) | ((memory.memory[i / 8u] >> (7u - (i % 8u))) & 1u);
+			}
+			BOOST_REQUIRE_EQUAL(expected, staticdb::execution::read_packed_bits(
+			                                  staticdb::execution::storage_pointer<staticdb::memory_storage>(
+			                                      memory, offset),
+			                                  length));
+			BOOST_REQUIRE_EQUAL(expected, staticdb::execution::read_packed_bits(
+			                                  staticdb::execution::storage_pointer<staticdb::file_storage>(
+			                                      file, offset),
+			                                  length));
+		}
+	}
+	BOOST_CHECK_THROW(staticdb::execution::read_packed_bits(
+	                      staticdb::execution::storage_pointer<staticdb::memory_storage>(memory, 20), 64),
+	                  std::invalid_argument);
+}
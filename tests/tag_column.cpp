@@ -0,0 +1,168 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	using staticdb_tests::make_optional_element;
+
+	staticdb::layouts::layout make_array_layout(staticdb::layouts::variant_tags tags)
+	{
+		namespace layouts = staticdb::layouts;
+		namespace types = staticdb::types;
+		return layouts::layout(layouts::array(
+		    Si::make_unique<layouts::layout>(layouts::calculate(types::make_optional(types::make_unsigned_integer(8)))),
+		    tags));
+	}
+
+	staticdb::memory_storage store_array(staticdb::layouts::layout const &root, std::uint8_t length)
+	{
+		std::vector<staticdb::values::value> elements;
+		for (std::uint8_t i = 0; i < length; ++i)
+		{
+			elements.emplace_back(make_optional_element(i));
+		}
+		staticdb::bit_buffer encoded;
+		staticdb::values::value const array = staticdb::values::tuple(std::move(elements));
+		staticdb::layouts::serialize(encoded, array, root);
+		staticdb::memory_storage storage;
+		storage.memory = encoded.bytes();
+		return storage;
+	}
+
+	staticdb::get_function make_is_some_filter()
+	{
+		namespace expr = staticdb::expressions;
+		namespace values = staticdb::values;
+		expr::lambda is_some(
+		    Si::make_unique<expr::expression>(
+		        expr::equals(Si::make_unique<expr::expression>(
+		                         expr::variant_index(Si::make_unique<expr::expression>(expr::argument()))),
+		                     Si::make_unique<expr::expression>(expr::bound()))),
+		    Si::make_unique<expr::expression>(expr::literal(values::make_unsigned_integer<std::uint64_t>(1))));
+		return expr::filter(
+		    Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+		    Si::make_unique<expr::expression>(std::move(is_some)));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(tag_column_stores_tags_in_front_of_contents)
+{
+	namespace layouts = staticdb::layouts;
+	namespace execution = staticdb::execution;
+	layouts::layout const root = make_array_layout(layouts::variant_tags::column);
+	staticdb::memory_storage const storage = store_array(root, 20);
+	BOOST_CHECK_EQUAL(8u + ((20u * 9u) + 7u) / 8u, storage.memory.size());
+
+	execution::storage_pointer<staticdb::memory_storage const> const begin(storage, 0);
+	BOOST_CHECK_EQUAL(64u + (20u * 9u), *execution::stored_size_in_bits(begin, root).value());
+	execution::pseudo_value<staticdb::memory_storage const> const array = execution::access_value(begin, root);
+	execution::basic_array_accessor<staticdb::memory_storage const> const *const accessor =
+	    Si::try_get_ptr<execution::basic_array_accessor<staticdb::memory_storage const>>(array);
+	BOOST_REQUIRE(accessor);
+	for (std::uint8_t i = 0; i < 20; ++i)
+	{
+		Si::optional<execution::pseudo_value<staticdb::memory_storage const>> const found =
+		    execution::get_stored_element(*accessor, i);
+		BOOST_REQUIRE(found);
+		BOOST_CHECK_EQUAL(make_optional_element(i), execution::reduce_value(*found));
+	}
+
+	layouts::layout const indexed = make_array_layout(layouts::variant_tags::indexed_column);
+	staticdb::memory_storage const indexed_storage = store_array(indexed, 20);
+	execution::storage_pointer<staticdb::memory_storage const> const indexed_begin(indexed_storage, 0);
+	BOOST_CHECK_EQUAL(64u + (20u * 9u) + (3u * 64u) + (20u * 64u),
+	                  *execution::stored_size_in_bits(indexed_begin, indexed).value());
+}
+
+BOOST_AUTO_TEST_CASE(tag_column_filter_by_variant_index)
+{
+	namespace layouts = staticdb::layouts;
+	namespace values = staticdb::values;
+	std::vector<values::value> expected;
+	for (std::uint8_t i = 0; i < 100; ++i)
+	{
+		if ((i % 3) != 0)
+		{
+			expected.emplace_back(make_optional_element(i));
+		}
+	}
+	values::value const expected_tuple = values::tuple(std::move(expected));
+	for (layouts::variant_tags tags : {layouts::variant_tags::column, layouts::variant_tags::indexed_column})
+	{
+		std::shared_ptr<layouts::layout const> const root = Si::to_shared(make_array_layout(tags));
+		staticdb::memory_storage const storage = store_array(*root, 100);
+		std::vector<staticdb::get_function> gets;
+		gets.emplace_back(make_is_some_filter());
+		Si::iterator_range<staticdb::get_function const *> const get_range(gets.data(), gets.data() + gets.size());
+		Si::iterator_range<staticdb::set_function const *> sets;
+		staticdb::basic_plan<staticdb::memory_storage const> const planned =
+		    staticdb::make_plan<staticdb::memory_storage const>(root, std::vector<staticdb::address>(), get_range,
+		                                                         sets, staticdb::execution::scan_options());
+		Si::optional<values::value> const some = planned.gets[0](storage, values::value(values::unit()));
+		BOOST_REQUIRE(some);
+		BOOST_CHECK_EQUAL(expected_tuple, *some);
+	}
+}
+
+namespace
+{
+	staticdb::values::value make_sparse_element(std::size_t index)
+	{
+		namespace values = staticdb::values;
+		if ((index % 20) != 7)
+		{
+			return values::make_none();
+		}
+		return values::make_some(values::make_unsigned_integer(static_cast<std::uint8_t>(index)));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(sparse_tag_column_stores_only_present_contents)
+{
+	namespace layouts = staticdb::layouts;
+	namespace values = staticdb::values;
+	namespace execution = staticdb::execution;
+	std::shared_ptr<layouts::layout const> const root =
+	    Si::to_shared(make_array_layout(layouts::variant_tags::sparse_column));
+	std::vector<values::value> elements;
+	std::vector<values::value> expected;
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		elements.emplace_back(make_sparse_element(i));
+		if ((i % 20) == 7)
+		{
+			expected.emplace_back(make_sparse_element(i));
+		}
+	}
+	staticdb::bit_buffer encoded;
+	layouts::serialize(encoded, values::value(values::tuple(std::move(elements))), *root);
+	staticdb::memory_storage storage;
+	storage.memory = encoded.bytes();
+
+	execution::storage_pointer<staticdb::memory_storage const> const begin(storage, 0);
+	BOOST_CHECK_EQUAL(64u + 1000u + (2u * 64u) + (50u * 8u), *execution::stored_size_in_bits(begin, *root).value());
+	execution::pseudo_value<staticdb::memory_storage const> const array = execution::access_value(begin, *root);
+	execution::basic_array_accessor<staticdb::memory_storage const> const *const accessor =
+	    Si::try_get_ptr<execution::basic_array_accessor<staticdb::memory_storage const>>(array);
+	BOOST_REQUIRE(accessor);
+	for (std::size_t i = 0; i < 1000; ++i)
+	{
+		Si::optional<execution::pseudo_value<staticdb::memory_storage const>> const found =
+		    execution::get_stored_element(*accessor, i);
+		BOOST_REQUIRE(found);
+		BOOST_CHECK_EQUAL(make_sparse_element(i), execution::reduce_value(*found));
+	}
+
+	std::vector<staticdb::get_function> gets;
+	gets.emplace_back(make_is_some_filter());
+	Si::iterator_range<staticdb::get_function const *> const get_range(gets.data(), gets.data() + gets.size());
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::basic_plan<staticdb::memory_storage const> const planned =
+	    staticdb::make_plan<staticdb::memory_storage const>(root, std::vector<staticdb::address>(), get_range, sets,
+	                                                         execution::scan_options());
+	Si::optional<values::value> const some = planned.gets[0](storage, values::value(values::unit()));
+	BOOST_REQUIRE(some);
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *some);
+}
@@ -0,0 +1,88 @@
+#ifndef STATICDB_TESTS_TEST_SUPPORT_HPP
+#define STATICDB_TESTS_TEST_SUPPORT_HPP
+
+#include <staticdb/expressions.hpp>
+#include <staticdb/values.hpp>
+#include <cstdio>
+
+namespace staticdb_tests
+{
+	// Removes the file before and after a test.
+	struct temporary_file
+	{
+		char const *path;
+
+		explicit temporary_file(char const *path)
+		    : path(path)
+		{
+			std::remove(path);
+		}
+
+		~temporary_file()
+		{
+			std::remove(path);
+		}
+	};
+
+	// A 13 bit unsigned integer as a tuple of bits, most significant bit first.
+	inline staticdb::values::value make_u13(std::uint64_t integer)
+	{
+		staticdb::values::tuple result;
+		for (std::size_t i = 0; i < 13; ++i)
+		{
+			result.elements.emplace_back(staticdb::values::bit(((integer >> (12 - i)) & 1u) != 0));
+		}
+		return staticdb::values::value(std::move(result));
+	}
+
+	// An optional 8 bit integer that is none for every third index.
+	inline staticdb::values::value make_optional_element(std::uint8_t index)
+	{
+		namespace values = staticdb::values;
+		if ((index % 3) == 0)
+		{
+			return values::make_none();
+		}
+		return values::make_some(values::make_unsigned_integer(index));
+	}
+
+	// A tuple of unsigned integers like the value of an array of them.
+	template <class Unsigned>
+	staticdb::values::value make_column(std::vector<Unsigned> const &numbers)
+	{
+		std::vector<staticdb::values::value> elements;
+		for (Unsigned number : numbers)
+		{
+			elements.emplace_back(staticdb::values::make_unsigned_integer(number));
+		}
+		return staticdb::values::tuple(std::move(elements));
+	}
+
+	inline staticdb::values::value make_uint8_tuple(std::vector<std::uint8_t> const &elements)
+	{
+		return make_column(elements);
+	}
+
+	// Filters the elements of the array that are equal to the key.
+	inline staticdb::expressions::expression make_find_equals(staticdb::expressions::expression array,
+	                                                          staticdb::expressions::expression key)
+	{
+		namespace expr = staticdb::expressions;
+		expr::lambda element_equals_key(
+		    Si::make_unique<expr::expression>(expr::equals(Si::make_unique<expr::expression>(expr::argument()),
+		                                                   Si::make_unique<expr::expression>(expr::bound()))),
+		    Si::make_unique<expr::expression>(std::move(key)));
+		return expr::filter(Si::make_unique<expr::expression>(std::move(array)),
+		                    Si::make_unique<expr::expression>(std::move(element_equals_key)));
+	}
+
+	// A getter that takes a tuple of the root array and a key and filters the elements equal to the key.
+	inline staticdb::expressions::expression make_find_equals()
+	{
+		namespace expr = staticdb::expressions;
+		return make_find_equals(expr::make_tuple_at(expr::expression(expr::argument()), 0),
+		                        expr::make_tuple_at(expr::expression(expr::argument()), 1));
+	}
+}
+
+#endif
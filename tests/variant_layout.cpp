@@ -0,0 +1,175 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/plan.hpp>
+#include <staticdb/expressions.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	using staticdb_tests::make_optional_element;
+
+	staticdb::types::type make_optional_u8()
+	{
+		return staticdb::types::make_optional(staticdb::types::make_unsigned_integer(8));
+	}
+
+	staticdb::memory_storage store_optional_array(std::uint8_t length)
+	{
+		namespace layouts = staticdb::layouts;
+		layouts::layout const element = layouts::calculate(make_optional_u8());
+		staticdb::bit_buffer encoded;
+		encoded.append_bits(length, 64);
+		for (std::uint8_t i = 0; i < length; ++i)
+		{
+			layouts::serialize(encoded, make_optional_element(i), element);
+		}
+		staticdb::memory_storage storage;
+		storage.memory = encoded.bytes();
+		return storage;
+	}
+}
+
+BOOST_AUTO_TEST_CASE(variant_layout_pads_to_largest_possibility)
+{
+	namespace types = staticdb::types;
+	namespace layouts = staticdb::layouts;
+	layouts::layout const optional = layouts::calculate(make_optional_u8());
+	BOOST_CHECK(layouts::has_fixed_size(optional));
+	BOOST_CHECK_EQUAL(9u, *layouts::layout_size_in_bits(optional).value());
+
+	types::variant three;
+	three.possibilities.emplace_back(types::unit());
+	three.possibilities.emplace_back(types::make_unsigned_integer(8));
+	three.possibilities.emplace_back(types::make_unsigned_integer(3));
+	BOOST_CHECK_EQUAL(10u, *layouts::layout_size_in_bits(layouts::calculate(three)).value());
+
+	types::variant with_array;
+	with_array.possibilities.emplace_back(types::unit());
+	with_array.possibilities.emplace_back(types::array(Si::make_unique<types::type>(types::bit())));
+	BOOST_CHECK(!layouts::has_fixed_size(layouts::calculate(with_array)));
+}
+
+BOOST_AUTO_TEST_CASE(nested_variants_share_one_tag)
+{
+	namespace types = staticdb::types;
+	namespace layouts = staticdb::layouts;
+	namespace values = staticdb::values;
+	namespace execution = staticdb::execution;
+	auto const make_three = []
+	{
+		types::variant three;
+		three.possibilities.emplace_back(types::unit());
+		three.possibilities.emplace_back(types::make_unsigned_integer(4));
+		three.possibilities.emplace_back(types::make_unsigned_integer(3));
+		return three;
+	};
+	BOOST_CHECK_EQUAL(6u, *layouts::layout_size_in_bits(layouts::calculate(make_three())).value());
+
+	layouts::layout const optional = layouts::calculate(types::make_optional(make_three()));
+	BOOST_CHECK_EQUAL(6u, *layouts::layout_size_in_bits(optional).value());
+
+	std::vector<values::value> elements;
+	elements.emplace_back(values::make_none());
+	elements.emplace_back(values::make_some(values::variant(0, Si::make_unique<values::value>(values::unit()))));
+	std::vector<values::value> nine;
+	nine.emplace_back(values::bit(true));
+	nine.emplace_back(values::bit(false));
+	nine.emplace_back(values::bit(false));
+	nine.emplace_back(values::bit(true));
+	elements.emplace_back(values::make_some(
+	    values::variant(1, Si::make_unique<values::value>(values::tuple(std::move(nine))))));
+	std::vector<values::value> five;
+	five.emplace_back(values::bit(true));
+	five.emplace_back(values::bit(false));
+	five.emplace_back(values::bit(true));
+	elements.emplace_back(values::make_some(
+	    values::variant(2, Si::make_unique<values::value>(values::tuple(std::move(five))))));
+	staticdb::bit_buffer encoded;
+	encoded.append_bits(elements.size(), 64);
+	for (values::value const &element : elements)
+	{
+		layouts::serialize(encoded, element, optional);
+	}
+	staticdb::memory_storage storage;
+	storage.memory = encoded.bytes();
+	BOOST_CHECK_EQUAL(8u + 3u, storage.memory.size());
+	execution::storage_pointer<staticdb::memory_storage const> const begin(storage, 0);
+	for (std::size_t i = 0; i < elements.size(); ++i)
+	{
+		Si::optional<execution::pseudo_value<staticdb::memory_storage const>> const found =
+		    execution::array_get(begin, i, optional);
+		BOOST_REQUIRE(found);
+		BOOST_CHECK_EQUAL(elements[i], execution::reduce_value(*found));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(variant_array_element_access)
+{
+	namespace layouts = staticdb::layouts;
+	namespace values = staticdb::values;
+	namespace execution = staticdb::execution;
+	staticdb::memory_storage const storage = store_optional_array(20);
+	BOOST_CHECK_EQUAL(8u + ((20u * 9u) + 7u) / 8u, storage.memory.size());
+
+	layouts::layout const element = layouts::calculate(make_optional_u8());
+	execution::storage_pointer<staticdb::memory_storage const> const begin(storage, 0);
+	for (std::uint8_t i = 0; i < 20; ++i)
+	{
+		Si::optional<execution::pseudo_value<staticdb::memory_storage const>> const found =
+		    execution::array_get(begin, i, element);
+		BOOST_REQUIRE(found);
+		BOOST_CHECK_EQUAL(make_optional_element(i), execution::reduce_value(*found));
+	}
+
+	staticdb::bit_buffer ignored;
+	values::value const invalid = values::variant(2, Si::make_unique<values::value>(values::unit()));
+	BOOST_CHECK_THROW(layouts::serialize(ignored, invalid, element), std::invalid_argument);
+}
+
+BOOST_AUTO_TEST_CASE(filter_by_variant_index)
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+	types::type const root_type = types::array(Si::make_unique<types::type>(make_optional_u8()));
+	staticdb::memory_storage const storage = store_optional_array(30);
+
+	expr::lambda is_some(
+	    Si::make_unique<expr::expression>(
+	        expr::equals(Si::make_unique<expr::expression>(
+	                         expr::variant_index(Si::make_unique<expr::expression>(expr::argument()))),
+	                     Si::make_unique<expr::expression>(expr::bound()))),
+	    Si::make_unique<expr::expression>(expr::literal(values::make_unsigned_integer<std::uint64_t>(1))));
+	expr::lambda is_four(Si::make_unique<expr::expression>(
+	                         expr::equals(Si::make_unique<expr::expression>(expr::argument()),
+	                                      Si::make_unique<expr::expression>(expr::literal(make_optional_element(4))))),
+	                     Si::make_unique<expr::expression>(expr::literal(values::unit())));
+	std::vector<staticdb::get_function> gets;
+	gets.emplace_back(
+	    expr::filter(Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+	                 Si::make_unique<expr::expression>(std::move(is_some))));
+	gets.emplace_back(
+	    expr::filter(Si::make_unique<expr::expression>(expr::make_tuple_at(expr::expression(expr::argument()), 0)),
+	                 Si::make_unique<expr::expression>(std::move(is_four))));
+	Si::iterator_range<staticdb::get_function const *> const get_range(gets.data(), gets.data() + gets.size());
+	Si::iterator_range<staticdb::set_function const *> sets;
+	staticdb::basic_plan<staticdb::memory_storage const> const planned =
+	    staticdb::make_plan<staticdb::memory_storage const>(root_type, get_range, sets);
+
+	Si::optional<values::value> const some = planned.gets[0](storage, values::value(values::unit()));
+	BOOST_REQUIRE(some);
+	std::vector<values::value> expected;
+	for (std::uint8_t i = 0; i < 30; ++i)
+	{
+		if ((i % 3) != 0)
+		{
+			expected.emplace_back(make_optional_element(i));
+		}
+	}
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected))), *some);
+
+	Si::optional<values::value> const four = planned.gets[1](storage, values::value(values::unit()));
+	BOOST_REQUIRE(four);
+	std::vector<values::value> expected_four;
+	expected_four.emplace_back(make_optional_element(4));
+	BOOST_CHECK_EQUAL(values::value(values::tuple(std::move(expected_four))), *four);
+}
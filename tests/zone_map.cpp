@@ -0,0 +1,177 @@
+#include <boost/test/unit_test.hpp>
+#include <staticdb/bulk_loader.hpp>
+#include <staticdb/plan.hpp>
+#include "test_support.hpp"
+
+namespace
+{
+	staticdb::basic_plan<staticdb::memory_storage const>
+	plan_find_equals(std::shared_ptr<staticdb::zone_map_set> zone_maps,
+	                 staticdb::execution::scan_options options = staticdb::execution::scan_options())
+	{
+		namespace expr = staticdb::expressions;
+		namespace types = staticdb::types;
+		types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+		expr::expression const find_equals = staticdb_tests::make_find_equals();
+		Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+		Si::iterator_range<staticdb::set_function const *> sets;
+		options.zone_maps = std::move(zone_maps);
+		return staticdb::make_plan<staticdb::memory_storage const>(root_type, gets, sets, options);
+	}
+
+	staticdb::values::value find(staticdb::basic_plan<staticdb::memory_storage const> const &planned,
+	                             staticdb::memory_storage const &storage, std::uint8_t key)
+	{
+		namespace values = staticdb::values;
+		Si::optional<values::value> found = planned.gets[0](storage, values::value(values::make_unsigned_integer(key)));
+		BOOST_REQUIRE(found);
+		return std::move(*found);
+	}
+
+	staticdb::values::value repeat(std::uint8_t element, std::size_t count)
+	{
+		std::vector<staticdb::values::value> elements;
+		for (std::size_t i = 0; i < count; ++i)
+		{
+			elements.emplace_back(staticdb::values::make_unsigned_integer(element));
+		}
+		return staticdb::values::tuple(std::move(elements));
+	}
+}
+
+BOOST_AUTO_TEST_CASE(zone_bounds_and_bloom_filter)
+{
+	staticdb::zone block;
+	BOOST_CHECK(!block.may_contain(0));
+	BOOST_CHECK(!block.may_overlap(0, ~std::uint64_t(0)));
+	for (std::uint64_t value = 100; value < 200; value += 10)
+	{
+		block.add(value);
+	}
+	BOOST_CHECK_EQUAL(100u, block.minimum);
+	BOOST_CHECK_EQUAL(190u, block.maximum);
+	BOOST_CHECK(block.may_contain(150));
+	BOOST_CHECK(!block.may_contain(99));
+	BOOST_CHECK(!block.may_contain(191));
+	BOOST_CHECK(block.may_overlap(0, 100));
+	BOOST_CHECK(block.may_overlap(190, 1000));
+	BOOST_CHECK(!block.may_overlap(191, 1000));
+	std::size_t passed = 0;
+	for (std::uint64_t value = 101; value < 190; value += 10)
+	{
+		passed += block.may_contain(value) ? 1u : 0u;
+	}
+	BOOST_CHECK_LT(passed, 3u);
+}
+
+BOOST_AUTO_TEST_CASE(zone_map_built_by_bulk_loader_skips_blocks)
+{
+	namespace types = staticdb::types;
+	staticdb::memory_storage storage;
+	staticdb::array_loader<staticdb::memory_storage> loader(
+	    storage, 0, types::make_unsigned_integer(8), std::make_shared<staticdb::work_stealing_pool>(2), 64);
+	loader.add_zone_map(100);
+	for (unsigned i = 0; i < 1000; ++i)
+	{
+		loader.add_packed(i / 4u);
+	}
+	BOOST_CHECK_EQUAL(1000u, loader.finish());
+	Si::optional<staticdb::address> const written = loader.zone_map_address();
+	BOOST_REQUIRE(written);
+	BOOST_CHECK_EQUAL(8u + 1000u, *written);
+
+	staticdb::zone_map zones = staticdb::execution::read_zone_map(
+	    staticdb::execution::storage_pointer<staticdb::memory_storage const>(storage, *written * 8u));
+	BOOST_CHECK_EQUAL(100u, zones.block_length);
+	BOOST_CHECK_EQUAL(1000u, zones.length);
+	BOOST_REQUIRE_EQUAL(1u, zones.fields.size());
+	BOOST_CHECK(zones.fields[0] == staticdb::execution::bit_range(0, 8));
+	BOOST_REQUIRE_EQUAL(10u, zones.block_count());
+	BOOST_CHECK_EQUAL(25u, zones.at(1, 0).minimum);
+	BOOST_CHECK_EQUAL(49u, zones.at(1, 0).maximum);
+	BOOST_CHECK(zones.at(1, 0).may_contain(30));
+	BOOST_CHECK(!zones.at(2, 0).may_contain(30));
+
+	// corrupt counts must not cause huge allocations
+	typedef staticdb::execution::storage_pointer<staticdb::memory_storage const> pointer;
+	staticdb::memory_storage truncated;
+	truncated.memory.assign(storage.memory.begin(), storage.memory.end() - 1);
+	BOOST_CHECK_THROW(staticdb::execution::read_zone_map(pointer(truncated, *written * 8u)), std::invalid_argument);
+	staticdb::memory_storage many_fields;
+	many_fields.memory = storage.memory;
+	std::fill(many_fields.memory.begin() + static_cast<std::ptrdiff_t>(*written + 16u),
+	          many_fields.memory.begin() + static_cast<std::ptrdiff_t>(*written + 20u), staticdb::byte(0x7f));
+	BOOST_CHECK_THROW(staticdb::execution::read_zone_map(pointer(many_fields, *written * 8u)), std::invalid_argument);
+
+	auto const exact = std::make_shared<staticdb::zone_map_set>();
+	exact->add(0, std::make_shared<staticdb::zone_map>(zones));
+	auto const planned = plan_find_equals(exact);
+	BOOST_CHECK_EQUAL(repeat(30, 4), find(planned, storage, 30));
+	BOOST_CHECK_EQUAL(repeat(249, 4), find(planned, storage, 249));
+	BOOST_CHECK_EQUAL(repeat(250, 0), find(planned, storage, 250));
+
+	// a zone that claims to be empty shows that the filter skips its block
+	zones.zones[1] = staticdb::zone();
+	auto const lying = std::make_shared<staticdb::zone_map_set>();
+	lying->add(0, std::make_shared<staticdb::zone_map>(std::move(zones)));
+	auto const skipping = plan_find_equals(lying);
+	BOOST_CHECK_EQUAL(repeat(30, 0), find(skipping, storage, 30));
+	BOOST_CHECK_EQUAL(repeat(60, 4), find(skipping, storage, 60));
+
+	// the blocks that are not skipped are split into morsels for the pool
+	auto const parallel = plan_find_equals(
+	    lying, staticdb::execution::scan_options(std::make_shared<staticdb::work_stealing_pool>(3), 0, 7));
+	BOOST_CHECK_EQUAL(repeat(30, 0), find(parallel, storage, 30));
+	BOOST_CHECK_EQUAL(repeat(60, 4), find(parallel, storage, 60));
+	BOOST_CHECK_EQUAL(repeat(249, 4), find(parallel, storage, 249));
+}
+
+BOOST_AUTO_TEST_CASE(zone_map_widened_by_setters)
+{
+	namespace expr = staticdb::expressions;
+	namespace types = staticdb::types;
+	namespace values = staticdb::values;
+	staticdb::memory_storage storage;
+	staticdb::array_loader<staticdb::memory_storage> loader(storage, 0, types::make_unsigned_integer(8), nullptr, 64);
+	loader.add_zone_map(100);
+	for (unsigned i = 0; i < 1000; ++i)
+	{
+		loader.add_packed(i / 4u);
+	}
+	BOOST_CHECK_EQUAL(1000u, loader.finish());
+	auto const maps = std::make_shared<staticdb::zone_map_set>();
+	maps->add(0, std::make_shared<staticdb::zone_map>(staticdb::execution::read_zone_map(
+	                 staticdb::execution::storage_pointer<staticdb::memory_storage const>(
+	                     storage, *loader.zone_map_address() * 8u))));
+
+	types::type const root_type = types::array(Si::make_unique<types::type>(types::make_unsigned_integer(8)));
+	expr::expression const find_equals = staticdb_tests::make_find_equals();
+	Si::iterator_range<staticdb::get_function const *> gets(&find_equals, &find_equals + 1);
+	std::vector<expr::expression> assignment;
+	assignment.emplace_back(expr::make_tuple_at(expr::expression(expr::argument()), 0));
+	assignment.emplace_back(expr::make_tuple_at(expr::make_tuple_at(expr::expression(expr::argument()), 1), 0));
+	assignment.emplace_back(expr::make_tuple_at(expr::make_tuple_at(expr::expression(expr::argument()), 1), 1));
+	expr::expression const set_element((expr::make_tuple(std::move(assignment))));
+	Si::iterator_range<staticdb::set_function const *> sets(&set_element, &set_element + 1);
+	staticdb::execution::scan_options options;
+	options.zone_maps = maps;
+	auto const planned = staticdb::make_plan<staticdb::memory_storage>(root_type, gets, sets, options);
+
+	auto const find_in_storage = [&planned, &storage](std::uint8_t key) -> values::value
+	{
+		Si::optional<values::value> found =
+		    planned.gets[0](storage, values::value(values::make_unsigned_integer(key)));
+		BOOST_REQUIRE(found);
+		return std::move(*found);
+	};
+	BOOST_CHECK_EQUAL(repeat(250, 0), find_in_storage(250));
+	std::vector<values::value> parts;
+	parts.emplace_back(values::make_unsigned_integer<std::uint32_t>(150));
+	parts.emplace_back(values::make_unsigned_integer<std::uint8_t>(250));
+	BOOST_CHECK_EQUAL(values::value(values::make_unsigned_integer<std::uint8_t>(37)),
+	                  planned.sets[0](storage, values::value(values::tuple(std::move(parts)))));
+	// the zones of the block of element 150 excluded 250 before the setter widened them
+	BOOST_CHECK_EQUAL(repeat(250, 1), find_in_storage(250));
+	BOOST_CHECK_EQUAL(repeat(37, 3), find_in_storage(37));
+	BOOST_CHECK(maps->find(0)->at(1, 0).may_contain(250));
+}